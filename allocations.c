@@ -0,0 +1,49 @@
+#include <stdlib.h>
+#include "allocations.h"
+#include "trace.h"
+
+#if defined(PC_COUNT_ALLOCATIONS) && defined(__GLIBC__)
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+static THREAD_LOCAL size_t allocation_count;
+
+// glibc lets the program replace its allocation functions, also for the calls made inside the library. This clashes
+// with the allocators of the sanitizers, so it is only done in the instrumented build
+
+void *malloc(const size_t size) {
+    allocation_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(const size_t count, const size_t size) {
+    allocation_count++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, const size_t size) {
+    allocation_count++;
+    return __libc_realloc(pointer, size);
+}
+
+size_t heap_allocations(void) {
+    return allocation_count;
+}
+
+int heap_allocations_counted(void) {
+    return 1;
+}
+
+#else
+
+size_t heap_allocations(void) {
+    return 0;
+}
+
+int heap_allocations_counted(void) {
+    return 0;
+}
+
+#endif
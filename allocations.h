@@ -0,0 +1,28 @@
+#ifndef ALLOCATIONS_H
+#define ALLOCATIONS_H
+
+#include <stddef.h>
+
+/**
+ * @brief Counts the calls of `malloc()`, `calloc()` and `realloc()` made by the calling thread.
+ *
+ * The count includes the allocations of the C library itself, e.g. of `fopen()`. Comparing two readings shows
+ * how many allocations the work between them made, which the long-running mode reports per request.
+ *
+ * The allocation functions are counted by replacing them with functions that count the call and forward it to
+ * the allocator of glibc. Replacing the allocator is only done in the instrumented build, compiled with
+ * PC_COUNT_ALLOCATIONS defined and with glibc, so the production build keeps the allocator untouched and can be
+ * built with sanitizers.
+ *
+ * @return The number of allocations of the calling thread so far, 0 if they are not counted in this build.
+ */
+size_t heap_allocations(void);
+
+/**
+ * @brief Checks whether `heap_allocations()` counts the allocations in this build.
+ *
+ * @return 1 if the allocations are counted, 0 otherwise.
+ */
+int heap_allocations_counted(void);
+
+#endif //ALLOCATIONS_H
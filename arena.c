@@ -0,0 +1,67 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/**
+ * @brief Size of the header of a block, rounded up so that the bytes following it are aligned.
+ */
+#define BLOCK_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1))
+
+/**
+ * @brief Allocates a block that becomes the current one.
+ */
+static void add_block(Arena *arena, const size_t size) {
+    ArenaBlock *block = malloc(BLOCK_HEADER + size);
+    block->next = arena->current;
+    block->size = size;
+    block->used = 0;
+    arena->current = block;
+}
+
+void initialize_arena(Arena *arena, const size_t block_size) {
+    arena->current = NULL;
+    arena->block_size = block_size ? block_size : DEFAULT_ARENA_BLOCK;
+}
+
+void *arena_allocate(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1);
+    if (!arena->current || arena->current->size - arena->current->used < size) {
+        // Every block at least doubles the memory of the arena
+        size_t block_size = arena->block_size;
+        for (const ArenaBlock *block = arena->current; block; block = block->next) {
+            block_size += block->size;
+        }
+        add_block(arena, block_size > size ? block_size : size);
+    }
+    void *memory = (char *) arena->current + BLOCK_HEADER + arena->current->used;
+    arena->current->used += size;
+    return memory;
+}
+
+char *arena_copy(Arena *arena, const char *text, const size_t length) {
+    char *copy = arena_allocate(arena, length + 1);
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+void reset_arena(Arena *arena) {
+    if (arena->current && arena->current->next) {
+        size_t total = 0;
+        for (const ArenaBlock *block = arena->current; block; block = block->next) {
+            total += block->size;
+        }
+        free_arena(arena);
+        add_block(arena, total);
+    } else if (arena->current) {
+        arena->current->used = 0;
+    }
+}
+
+void free_arena(Arena *arena) {
+    while (arena->current) {
+        ArenaBlock *next = arena->current->next;
+        free(arena->current);
+        arena->current = next;
+    }
+}
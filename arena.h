@@ -0,0 +1,88 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * @brief Alignment of every allocation of an arena, enough for any scalar type.
+ */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * @brief Default size of the first block of an arena in bytes.
+ */
+#define DEFAULT_ARENA_BLOCK 16384
+
+/**
+ * @brief A block of memory of an arena, followed by its bytes.
+ *
+ * @struct ArenaBlock
+ * @member next The block allocated before this one, NULL for the first block.
+ * @member size The number of bytes of the block.
+ * @member used The number of bytes handed out.
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+/**
+ * @brief Scratch memory handed out by bumping a pointer and released all at once.
+ *
+ * An arena serves short-lived allocations that all end together, e.g. the abstract syntax trees of one
+ * compilation. When the current block is full, a further block is allocated. `reset_arena()` replaces several
+ * blocks by one block of their total size, so an arena that is reset after every job allocates nothing once it
+ * has grown to the largest job.
+ *
+ * @struct Arena
+ * @member current The block allocations are taken from, its `next` chain holds the full blocks.
+ * @member block_size The size of the first block.
+ */
+typedef struct Arena {
+    ArenaBlock *current;
+    size_t block_size;
+} Arena;
+
+/**
+ * @brief Initializes an empty arena, the first block is allocated on the first allocation.
+ *
+ * @param arena      The arena.
+ * @param block_size The size of the first block in bytes, 0 for DEFAULT_ARENA_BLOCK.
+ */
+void initialize_arena(Arena *arena, size_t block_size);
+
+/**
+ * @brief Allocates memory that stays valid until the arena is reset or freed.
+ *
+ * @param arena The arena.
+ * @param size  The number of bytes.
+ * @return The memory, aligned to ARENA_ALIGNMENT and not initialised.
+ */
+void *arena_allocate(Arena *arena, size_t size);
+
+/**
+ * @brief Copies a string into an arena.
+ *
+ * @param arena  The arena.
+ * @param text   The string, which need not be terminated.
+ * @param length The number of characters to copy.
+ * @return The terminated copy.
+ */
+char *arena_copy(Arena *arena, const char *text, size_t length);
+
+/**
+ * @brief Releases every allocation of the arena at once and keeps its memory for the next ones.
+ *
+ * @param arena The arena.
+ */
+void reset_arena(Arena *arena);
+
+/**
+ * @brief Frees the memory of an arena.
+ *
+ * @param arena The arena, empty afterwards.
+ */
+void free_arena(Arena *arena);
+
+#endif //ARENA_H
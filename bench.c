@@ -0,0 +1,667 @@
+#include "draw_utils.h"
+#include "timer.h"
+#include "perf_counters.h"
+#include "sample_codec.h"
+
+/**
+ * @brief Benchmark suite for the lexer, parser, compiler, evaluators and PostScript emitters.
+ *
+ * Every expression of the corpus is measured under every limits scenario. Each stage of the pipeline is timed on its
+ * own and the whole render is timed end-to-end. After a number of warmup runs, every stage is repeated and the
+ * per-run times are summarized with robust statistics (minimum, median, median absolute deviation, 90th percentile),
+ * which are written as JSON so results can be compared across versions.
+ *
+ * With --perf-counters, the hardware performance counters are read around the measured repetitions and their
+ * per-run averages are added to every result (null where a counter is not available).
+ *
+ * Usage: pc_bench [--repetitions=<n>] [--warmup=<n>] [--min-time=<seconds>] [--filter=<text>] [--output=<file>]
+ *                 [--perf-counters]
+ */
+
+/**
+ * @brief Default number of measured repetitions of every stage.
+ */
+#define DEFAULT_REPETITIONS 15
+
+/**
+ * @brief Default number of unmeasured warmup runs of every stage.
+ */
+#define DEFAULT_WARMUP 3
+
+/**
+ * @brief Default minimum duration of one measured repetition in seconds.
+ *
+ * Fast stages are run several times within one repetition until this time is reached, so the timer resolution
+ * does not dominate the result. The reported times are per single run.
+ */
+#define DEFAULT_MIN_TIME 0.002
+
+/**
+ * @brief Number of terms of the generated sums in the corpus.
+ */
+#define GENERATED_SUM_TERMS 400
+
+/**
+ * @brief Device discarding everything written to it, used as the output of the emitter stages.
+ */
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+/**
+ * @brief One expression of the benchmark corpus.
+ *
+ * @struct BenchExpression
+ * @member name The name of the expression in the results.
+ * @member text The expression. Generated expressions have it set to NULL until the corpus is prepared.
+ */
+typedef struct BenchExpression {
+    const char *name;
+    const char *text;
+} BenchExpression;
+
+/**
+ * @brief One limits scenario of the benchmark corpus.
+ *
+ * @struct BenchLimits
+ * @member name The name of the scenario in the results.
+ * @member text The limits in the format accepted by `parse_limits()`.
+ */
+typedef struct BenchLimits {
+    const char *name;
+    const char *text;
+} BenchLimits;
+
+/**
+ * @brief The curated expression corpus: polynomials, deep trigonometric compositions, pole-heavy functions
+ *        and huge generated sums.
+ */
+static BenchExpression corpus[] = {
+    {"linear", "2*x+1"},
+    {"polynomial", "x^5-3*x^4+2*x^3-x^2+7*x-5"},
+    {"horner", "((((x-3)*x+2)*x-1)*x+7)*x-5"},
+    {"trig_simple", "sin(x)"},
+    {"trig_deep", "sin(cos(sin(cos(sin(cos(x))))))"},
+    {"trig_mixed", "sin(x)*cos(2*x)+tan(x/3)-atan(x)^2"},
+    {"hyperbolic", "sinh(x/4)-cosh(x/5)+tanh(x)"},
+    {"pole_tan", "tan(x)"},
+    {"pole_reciprocal", "1/sin(x)+1/(x^2-4)"},
+    {"pole_log", "ln(abs(x))+log(x)"},
+    {"domain_inverse", "asin(x/2)+acos(x/3)"},
+    {"gaussian_wave", "exp(-x^2/8)*sin(5*x)"},
+    {"shared_subexpressions", "sin(x)^2+sin(x)*cos(x)+cos(x)^2+sin(x)"},
+    {"generated_sum", NULL},
+    {"generated_trig_sum", NULL},
+};
+
+/**
+ * @brief The limits scenarios every expression is measured with.
+ */
+static const BenchLimits scenarios[] = {
+    {"default", "-10:10:-10:10"},
+    {"narrow", "-1:1:-1:1"},
+    {"wide", "-100:100:-10:10"},
+    {"tall", "-10:10:-200:200"},
+};
+
+/**
+ * @brief Number of expressions in the corpus.
+ */
+#define CORPUS_SIZE (sizeof(corpus) / sizeof(corpus[0]))
+
+/**
+ * @brief Number of limits scenarios.
+ */
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+/**
+ * @brief Everything a stage needs, prepared once per expression and scenario.
+ *
+ * Stages that measure a later part of the pipeline take the results of the earlier parts from here,
+ * so that every stage measures only its own work.
+ */
+typedef struct BenchContext {
+    const char *expression; /**< The expression text */
+    Limits limits; /**< The parsed limits */
+    Node *abstract_syntax_tree; /**< The parsed expression */
+    Program *program; /**< The compiled expression */
+    Program *recurrent_program; /**< The compiled expression with recurrences enabled */
+    Program *narrow_program; /**< The compiled expression with the narrow sin and cos kernels */
+    Program *patchable_program; /**< The compiled expression with patchable literals */
+    double *xs; /**< The sampling grid */
+    double *ys; /**< The values of the expression over the grid */
+    size_t count; /**< Number of samples */
+    double *registers; /**< Scratch memory of the block evaluator */
+    unsigned char *stored; /**< The samples of the grid in the lossless sample format */
+    size_t stored_size; /**< Size of the stored samples in bytes */
+    double *decoded; /**< Scratch memory for the x values, values and flags of one decoded block */
+    FILE *sink; /**< Output of the emitter stages */
+    double checksum; /**< Accumulates results, so that no stage can be optimized away */
+} BenchContext;
+
+/**
+ * @brief A measured stage of the pipeline.
+ */
+typedef void (*BenchStage)(BenchContext *context);
+
+/**
+ * @brief Lexes the whole expression into tokens.
+ */
+static void stage_lex(BenchContext *context) {
+    Lexer *lexer = initialize_lexer(context->expression);
+    size_t tokens = 0;
+    while (lexer->current_char != END_OF_FILE) {
+        get_next_token(lexer);
+        tokens++;
+    }
+    context->checksum += (double) tokens;
+    free(lexer);
+}
+
+/**
+ * @brief Lexes and parses the expression into an abstract syntax tree.
+ */
+static void stage_parse(BenchContext *context) {
+    Lexer *lexer = initialize_lexer(context->expression);
+    Node *tree = parse(lexer);
+    context->checksum += tree->type;
+    free_node(tree);
+    free(lexer);
+}
+
+/**
+ * @brief Compiles the abstract syntax tree into a program.
+ */
+static void stage_compile(BenchContext *context) {
+    Program *program = compile(context->abstract_syntax_tree);
+    context->checksum += (double) program->length;
+    free_program(program);
+}
+
+/**
+ * @brief Changes the first literal of the patchable program and specialises it to the limits again, the work
+ * a slider update does before sampling, compared to lexing, parsing and compiling the expression again.
+ */
+static void stage_patch_constant(BenchContext *context) {
+    Program *program = context->patchable_program;
+    if (program->pool->count) {
+        context->checksum += (double) patch_constant(program, 0, program->pool->values[0]);
+    }
+    specialise_ranges(program, &context->limits, 0);
+}
+
+/**
+ * @brief Evaluates the abstract syntax tree over the grid with the recursive reference evaluator.
+ */
+static void stage_evaluate_reference(BenchContext *context) {
+    for (size_t i = 0; i < context->count; i++) {
+        context->ys[i] = evaluate(context->abstract_syntax_tree, context->xs[i]);
+    }
+    context->checksum += context->ys[context->count / 2];
+}
+
+/**
+ * @brief Evaluates the compiled program over the grid, one block at a time.
+ */
+static void stage_evaluate(BenchContext *context) {
+    for (size_t offset = 0; offset < context->count; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t count = context->count - offset < SAMPLE_BLOCK_SIZE ? context->count - offset : SAMPLE_BLOCK_SIZE;
+        double *ys = context->ys + offset;
+        execute_block(context->program, context->xs + offset, count, NULL, context->registers, &ys);
+    }
+    context->checksum += context->ys[context->count / 2];
+}
+
+/**
+ * @brief Evaluates the compiled program over the grid with sin, cos and exp of affine arguments by recurrence.
+ */
+static void stage_evaluate_recurrence(BenchContext *context) {
+    for (size_t offset = 0; offset < context->count; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t count = context->count - offset < SAMPLE_BLOCK_SIZE ? context->count - offset : SAMPLE_BLOCK_SIZE;
+        double *ys = context->ys + offset;
+        execute_block(context->recurrent_program, context->xs + offset, count, NULL, context->registers, &ys);
+    }
+    context->checksum += context->ys[context->count / 2];
+}
+
+/**
+ * @brief Evaluates the compiled program over the grid with sin and cos of arguments inside [-pi, pi] evaluated
+ * by the narrow kernels.
+ */
+static void stage_evaluate_narrow(BenchContext *context) {
+    for (size_t offset = 0; offset < context->count; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t count = context->count - offset < SAMPLE_BLOCK_SIZE ? context->count - offset : SAMPLE_BLOCK_SIZE;
+        double *ys = context->ys + offset;
+        execute_block(context->narrow_program, context->xs + offset, count, NULL, context->registers, &ys);
+    }
+    context->checksum += context->ys[context->count / 2];
+}
+
+/**
+ * @brief Encodes the evaluated grid into the sample format, losslessly or as page coordinates.
+ */
+static void store_samples(BenchContext *context, const SampleEncoding encoding, FILE *file) {
+    SampleWriter writer;
+    begin_sample_file(&writer, file, &context->limits, 1, encoding);
+    write_samples(&writer, context->xs, context->ys, context->count, context->count);
+    context->checksum += (double) end_sample_file(&writer);
+}
+
+/**
+ * @brief Writes the evaluated grid as a lossless sample file.
+ */
+static void stage_store_samples(BenchContext *context) {
+    store_samples(context, SAMPLE_ENCODING_XOR, context->sink);
+}
+
+/**
+ * @brief Writes the evaluated grid as a sample file of quantised page coordinates.
+ */
+static void stage_store_samples_quantised(BenchContext *context) {
+    store_samples(context, SAMPLE_ENCODING_QUANTISED, context->sink);
+}
+
+/**
+ * @brief Decodes every block of the lossless sample file of the grid.
+ */
+static void stage_load_samples(BenchContext *context) {
+    SampleReader reader;
+    if (open_sample_file(&reader, context->stored, context->stored_size)) return;
+
+    double *xs = context->decoded;
+    double *ys = xs + SAMPLE_FILE_BLOCK;
+    unsigned char *flags = (unsigned char *) (ys + SAMPLE_FILE_BLOCK);
+    for (size_t block = 0; block < reader.block_count; block++) {
+        context->checksum += (double) decode_sample_block(&reader, block, xs, ys, flags);
+    }
+}
+
+/**
+ * @brief Emits the page setup, axes, limits and grid lines.
+ */
+static void stage_emit_background(BenchContext *context) {
+    const Limits *limits = &context->limits;
+    const double scale_x = (PAGE_WIDTH - PAGE_MARGIN) / (limits->x_max - limits->x_min);
+    const double scale_y = (PAGE_HEIGHT - PAGE_MARGIN) / (limits->y_max - limits->y_min);
+    const double axis = 0.0;
+
+    prepare_graph(limits, context->sink, &scale_x, &scale_y);
+    draw_axes(limits, context->sink, &scale_x, &scale_y, &axis, &axis);
+    draw_limits(limits, context->sink, &scale_x, &scale_y);
+    draw_support_lines(limits, context->sink, &scale_x, &scale_y, &axis, &axis);
+}
+
+/**
+ * @brief Emits the path of the already evaluated curve.
+ */
+static void stage_emit_curve(BenchContext *context) {
+    const Limits *limits = &context->limits;
+    const double scale_x = (PAGE_WIDTH - PAGE_MARGIN) / (limits->x_max - limits->x_min);
+    const double scale_y = (PAGE_HEIGHT - PAGE_MARGIN) / (limits->y_max - limits->y_min);
+
+    const int proven = proven_inside(context->program, 0, limits);
+
+    draw_series(limits, context->sink, &scale_x, &scale_y, context->xs, &context->ys, context->count, 1, &proven);
+    finish(context->sink);
+}
+
+/**
+ * @brief Emits the path of the already evaluated curve as PostScript Level 2 binary tokens.
+ */
+static void stage_emit_curve_binary(BenchContext *context) {
+    set_path_encoding(PATH_ENCODING_BINARY);
+    stage_emit_curve(context);
+    set_path_encoding(PATH_ENCODING_TEXT);
+}
+
+/**
+ * @brief Runs the whole render: lexing, parsing, compiling, evaluating and emitting the page.
+ */
+static void stage_end_to_end(BenchContext *context) {
+    Lexer *lexer = initialize_lexer(context->expression);
+    Node *tree = parse(lexer);
+    Program *program = compile(tree);
+    specialise_ranges(program, &context->limits, 0);
+    draw_graph(&context->limits, context->sink, program);
+    free_program(program);
+    free_node(tree);
+    free(lexer);
+}
+
+/**
+ * @brief A named stage of the pipeline.
+ */
+typedef struct BenchStageEntry {
+    const char *name;
+    BenchStage run;
+} BenchStageEntry;
+
+/**
+ * @brief All measured stages, in pipeline order.
+ */
+static const BenchStageEntry stages[] = {
+    {"lex", stage_lex},
+    {"parse", stage_parse},
+    {"compile", stage_compile},
+    {"patch_constant", stage_patch_constant},
+    {"evaluate_reference", stage_evaluate_reference},
+    {"evaluate", stage_evaluate},
+    {"evaluate_recurrence", stage_evaluate_recurrence},
+    {"evaluate_narrow", stage_evaluate_narrow},
+    {"store_samples", stage_store_samples},
+    {"store_samples_quantised", stage_store_samples_quantised},
+    {"load_samples", stage_load_samples},
+    {"emit_background", stage_emit_background},
+    {"emit_curve", stage_emit_curve},
+    {"emit_curve_binary", stage_emit_curve_binary},
+    {"end_to_end", stage_end_to_end},
+};
+
+/**
+ * @brief Number of measured stages.
+ */
+#define STAGE_COUNT (sizeof(stages) / sizeof(stages[0]))
+
+/**
+ * @brief Summary of the repeated measurements of one stage.
+ */
+typedef struct BenchStatistics {
+    double min; /**< Fastest run in seconds */
+    double median; /**< Median run in seconds */
+    double mad; /**< Median absolute deviation from the median in seconds */
+    double p90; /**< 90th percentile in seconds */
+    double mean; /**< Arithmetic mean in seconds */
+    size_t iterations; /**< Runs per repetition used to reach the minimum repetition time */
+    double counters[PERF_EVENT_COUNT]; /**< Per-run averages of the hardware counters, negative if not available */
+} BenchStatistics;
+
+/**
+ * @brief Hardware counters read around the measured repetitions, if requested.
+ */
+static PerfCounters perf_counters;
+
+/**
+ * @brief Ascending comparison of doubles for `qsort()`.
+ */
+static int compare_doubles(const void *a, const void *b) {
+    const double x = *(const double *) a;
+    const double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Returns the value at the given quantile of a sorted array, interpolating between neighbours.
+ */
+static double quantile(const double *sorted, const size_t count, const double q) {
+    const double position = q * (double) (count - 1);
+    const size_t lower = (size_t) position;
+    if (lower + 1 >= count) return sorted[count - 1];
+    return sorted[lower] + (sorted[lower + 1] - sorted[lower]) * (position - (double) lower);
+}
+
+/**
+ * @brief Runs one stage with warmup and repetitions and summarizes the per-run times.
+ *
+ * @param stage       The stage to be measured.
+ * @param context     The prepared context.
+ * @param warmup      Number of unmeasured runs.
+ * @param repetitions Number of measured repetitions.
+ * @param min_time    Minimum duration of one repetition in seconds.
+ * @return The statistics of the per-run times.
+ */
+static BenchStatistics measure(const BenchStage stage, BenchContext *context, const int warmup, const int repetitions,
+                               const double min_time) {
+    BenchStatistics statistics;
+    double *times = malloc(repetitions * sizeof(double));
+    double *deviations = malloc(repetitions * sizeof(double));
+
+    for (int i = 0; i < warmup; i++) {
+        stage(context);
+    }
+
+    // Calibrate how many runs one repetition needs to last at least min_time
+    size_t iterations = 1;
+    for (;;) {
+        const double start = monotonic_seconds();
+        for (size_t i = 0; i < iterations; i++) {
+            stage(context);
+        }
+        const double elapsed = monotonic_seconds() - start;
+        if (elapsed >= min_time || iterations >= ((size_t) 1 << 24)) break;
+        iterations *= elapsed > 0 && min_time / elapsed < 16 ? 2 : 16;
+    }
+
+    long long counters_before[PERF_EVENT_COUNT];
+    long long counters_after[PERF_EVENT_COUNT];
+    read_perf_counters(&perf_counters, counters_before);
+
+    for (int r = 0; r < repetitions; r++) {
+        const double start = monotonic_seconds();
+        for (size_t i = 0; i < iterations; i++) {
+            stage(context);
+        }
+        times[r] = (monotonic_seconds() - start) / (double) iterations;
+    }
+
+    read_perf_counters(&perf_counters, counters_after);
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (counters_before[i] == PERF_UNAVAILABLE || counters_after[i] == PERF_UNAVAILABLE) {
+            statistics.counters[i] = -1.0;
+        } else {
+            statistics.counters[i] = (double) (counters_after[i] - counters_before[i]) /
+                                     ((double) iterations * repetitions);
+        }
+    }
+
+    qsort(times, repetitions, sizeof(double), compare_doubles);
+    statistics.min = times[0];
+    statistics.median = quantile(times, repetitions, 0.5);
+    statistics.p90 = quantile(times, repetitions, 0.9);
+    statistics.mean = 0.0;
+    for (int r = 0; r < repetitions; r++) {
+        statistics.mean += times[r] / repetitions;
+        deviations[r] = fabs(times[r] - statistics.median);
+    }
+    qsort(deviations, repetitions, sizeof(double), compare_doubles);
+    statistics.mad = quantile(deviations, repetitions, 0.5);
+    statistics.iterations = iterations;
+
+    free(deviations);
+    free(times);
+    return statistics;
+}
+
+/**
+ * @brief Builds a sum of `terms` generated terms, with `format` receiving the term index twice.
+ */
+static char *generate_sum(const char *format, const int terms) {
+    char term[64];
+    size_t length = 1;
+    char *text = malloc(length);
+    text[0] = '\0';
+
+    for (int k = 1; k <= terms; k++) {
+        const int written = snprintf(term, sizeof(term), format, k, k);
+        text = realloc(text, length + written + 1);
+        if (k > 1) {
+            strcat(text, "+");
+            length++;
+        }
+        strcat(text, term);
+        length += written;
+    }
+    return text;
+}
+
+/**
+ * @brief Writes a string as a JSON string literal.
+ */
+static void write_json_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const char *c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if ((unsigned char) *c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+int main(const int argc, char *argv[]) {
+    int repetitions = DEFAULT_REPETITIONS;
+    int warmup = DEFAULT_WARMUP;
+    double min_time = DEFAULT_MIN_TIME;
+    const char *filter = NULL;
+    const char *output_name = NULL;
+    int first_result = 1;
+    int use_perf_counters = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--repetitions=", 14) == 0) {
+            repetitions = atoi(argv[i] + 14);
+        } else if (strncmp(argv[i], "--warmup=", 9) == 0) {
+            warmup = atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--min-time=", 11) == 0) {
+            min_time = atof(argv[i] + 11);
+        } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else if (strncmp(argv[i], "--output=", 9) == 0) {
+            output_name = argv[i] + 9;
+        } else if (strcmp(argv[i], "--perf-counters") == 0) {
+            use_perf_counters = 1;
+        } else {
+            error_exit("invalid input. Correct usage: pc_bench [--repetitions=<n>] [--warmup=<n>] "
+                       "[--min-time=<seconds>] [--filter=<text>] [--output=<file>] [--perf-counters]", ERROR_ARGS);
+        }
+    }
+    if (repetitions < 1 || warmup < 0) {
+        error_exit(ERROR_ARGS_TEXT, ERROR_ARGS);
+    }
+
+    FILE *output = output_name ? fopen(output_name, "w") : stdout;
+    FILE *sink = fopen(NULL_DEVICE, "w");
+    if (!output || !sink) {
+        error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+    }
+
+    open_perf_counters(&perf_counters);
+    if (!use_perf_counters) {
+        close_perf_counters(&perf_counters);
+    } else if (perf_counters.available == 0) {
+        print_warning(WARNING_PERF_COUNTERS_TEXT);
+    }
+
+    char *generated_sum = generate_sum("%d*x^2/(%d+x^2)", GENERATED_SUM_TERMS);
+    char *generated_trig_sum = generate_sum("sin(%d*x)/%d", GENERATED_SUM_TERMS);
+    for (size_t e = 0; e < CORPUS_SIZE; e++) {
+        if (strcmp(corpus[e].name, "generated_sum") == 0) corpus[e].text = generated_sum;
+        if (strcmp(corpus[e].name, "generated_trig_sum") == 0) corpus[e].text = generated_trig_sum;
+    }
+
+    fprintf(output, "{\n  \"benchmark\": \"pc_bench\",\n  \"version\": 1,\n");
+    fprintf(output, "  \"repetitions\": %d,\n  \"warmup\": %d,\n  \"sample_block_size\": %d,\n",
+            repetitions, warmup, SAMPLE_BLOCK_SIZE);
+    fprintf(output, "  \"results\": [");
+
+    for (size_t e = 0; e < CORPUS_SIZE; e++) {
+        for (size_t s = 0; s < SCENARIO_COUNT; s++) {
+            BenchContext context;
+            context.expression = corpus[e].text;
+            if (parse_limits(scenarios[s].text, &context.limits) == 1) {
+                error_exit(ERROR_LIMITS_TEXT, ERROR_LIMITS);
+            }
+
+            Lexer *lexer = initialize_lexer(context.expression);
+            context.abstract_syntax_tree = parse(lexer);
+            free(lexer);
+            context.program = compile(context.abstract_syntax_tree);
+            context.recurrent_program = compile(context.abstract_syntax_tree);
+            enable_recurrences(context.recurrent_program, X_EVALUATION_STEP);
+            specialise_ranges(context.program, &context.limits, 0);
+            context.narrow_program = compile(context.abstract_syntax_tree);
+            specialise_ranges(context.narrow_program, &context.limits, 1);
+            context.patchable_program = compile_patchable(&context.abstract_syntax_tree, 1);
+            context.count = count_samples(&context.limits);
+            context.xs = malloc(context.count * sizeof(double));
+            context.ys = malloc(context.count * sizeof(double));
+            context.registers = malloc(context.program->length * SAMPLE_BLOCK_SIZE * sizeof(double));
+            context.sink = sink;
+            context.checksum = 0.0;
+
+            double cursor = context.limits.x_min;
+            next_sample_block(&context.limits, &cursor, context.xs, context.count);
+            stage_evaluate(&context);
+
+            FILE *stored = tmpfile();
+            if (!stored) {
+                error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+            }
+            store_samples(&context, SAMPLE_ENCODING_XOR, stored);
+            context.stored_size = (size_t) ftell(stored);
+            context.stored = malloc(context.stored_size);
+            rewind(stored);
+            context.stored_size = fread(context.stored, 1, context.stored_size, stored);
+            fclose(stored);
+            context.decoded = malloc(SAMPLE_FILE_BLOCK * (2 * sizeof(double) + 1));
+
+            for (size_t t = 0; t < STAGE_COUNT; t++) {
+                char label[256];
+                snprintf(label, sizeof(label), "%s/%s/%s", corpus[e].name, scenarios[s].name, stages[t].name);
+                if (filter && !strstr(label, filter)) continue;
+
+                const BenchStatistics statistics = measure(stages[t].run, &context, warmup, repetitions, min_time);
+
+                fprintf(output, "%s\n    {\"expression\": \"%s\", \"scenario\": \"%s\", \"limits\": \"%s\", "
+                        "\"stage\": \"%s\", \"text\": ", first_result ? "" : ",", corpus[e].name, scenarios[s].name,
+                        scenarios[s].text, stages[t].name);
+                write_json_string(output, strlen(context.expression) > 80 ? "<generated>" : context.expression);
+                fprintf(output, ", \"samples\": %lu, \"instructions\": %lu, \"iterations\": %lu, "
+                        "\"min_ns\": %.1f, \"median_ns\": %.1f, \"mad_ns\": %.1f, \"p90_ns\": %.1f, \"mean_ns\": %.1f",
+                        (unsigned long) context.count, (unsigned long) context.program->length,
+                        (unsigned long) statistics.iterations, statistics.min * 1e9, statistics.median * 1e9,
+                        statistics.mad * 1e9, statistics.p90 * 1e9, statistics.mean * 1e9);
+                if (use_perf_counters) {
+                    fprintf(output, ", \"counters\": {");
+                    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+                        fprintf(output, "%s\"%s\": ", i ? ", " : "", perf_event_name(i));
+                        if (statistics.counters[i] < 0) {
+                            fprintf(output, "null");
+                        } else {
+                            fprintf(output, "%.1f", statistics.counters[i]);
+                        }
+                    }
+                    fprintf(output, "}");
+                }
+                fprintf(output, "}");
+                first_result = 0;
+                fflush(output);
+            }
+
+            free(context.decoded);
+            free(context.stored);
+            free(context.registers);
+            free(context.ys);
+            free(context.xs);
+            free_program(context.narrow_program);
+            free_program(context.patchable_program);
+            free_program(context.recurrent_program);
+            free_program(context.program);
+            free_node(context.abstract_syntax_tree);
+        }
+    }
+    fprintf(output, "\n  ]\n}\n");
+
+    free(generated_trig_sum);
+    free(generated_sum);
+    close_perf_counters(&perf_counters);
+    fclose(sink);
+    if (output != stdout) {
+        fclose(output);
+    }
+    return 0;
+}
@@ -0,0 +1,754 @@
+#include <float.h>
+#include <stdint.h>
+#include "double_double.h"
+#include "draw_utils.h"
+#include "generator.h"
+#include "sampler.h"
+#include "sample_codec.h"
+
+/**
+ * @brief Differential validation of the evaluation engines against the reference evaluator.
+ *
+ * Random expressions from the generator are evaluated over several sampling grids by the recursive
+ * `evaluate_with_parameters()` and by every optimised engine. Every value has to match the reference within
+ * the budget of the engine, measured in units in the last place (ULP). NaN matches NaN regardless of its payload,
+ * infinities have to match exactly. Approximating engines, and the more accurate double-double engine, are checked
+ * against their own error bound instead. A failing expression is shrunk to a minimal reproducer before it is
+ * reported.
+ *
+ * Usage: pc_check [--seed=<n>] [--count=<n>] [--nodes=<n>] [--poles=<fraction>] [--duplicates=<fraction>]
+ *                 [--verbose]
+ *
+ * The exit code is 0 if all engines agree with the reference, CHECK_MISMATCH otherwise.
+ */
+
+/**
+ * @brief Exit code of a run that found a mismatch.
+ */
+#define CHECK_MISMATCH 6
+
+/**
+ * @brief Text of the error printed for invalid arguments.
+ */
+#define CHECK_USAGE_TEXT "invalid input. Correct usage: pc_check [--seed=<n>] [--count=<n>] [--nodes=<n>] " \
+                         "[--poles=<fraction>] [--duplicates=<fraction>] [--verbose]"
+
+/**
+ * @brief Values of the parameters passed to every engine.
+ */
+static const double CHECK_PARAMETERS[PARAMETER_COUNT] = {0.5, -1.25, 2.0};
+
+/**
+ * @brief The sampling grids every expression is checked on.
+ *
+ * The last grid starts at a subnormal x, where the remainders of the double-double arithmetic underflow.
+ */
+static const char *CHECK_LIMITS[] = {"-10:10:-10:10", "-1:1:-1:1", "-100:100:-10:10", "0.37:2.5:-1:1",
+                                     "1e-310:0.5:-1:1"};
+
+/**
+ * @brief Number of sampling grids.
+ */
+#define CHECK_LIMITS_COUNT (sizeof(CHECK_LIMITS) / sizeof(CHECK_LIMITS[0]))
+
+/**
+ * @brief Everything an engine needs to evaluate an expression over a grid.
+ */
+typedef struct EngineInput {
+    const Node *tree; /**< The expression under test */
+    const Node *companion; /**< Another expression, fused with the one under test by engines that share code */
+    const Limits *limits; /**< The limits defining the grid */
+    const double *xs; /**< The x values of the grid */
+    size_t count; /**< Number of samples */
+} EngineInput;
+
+/**
+ * @brief Evaluates the expression under test over the whole grid.
+ *
+ * @param input The expression and the grid.
+ * @param ys    Output array of `input->count` values.
+ */
+typedef void (*EngineRun)(const EngineInput *input, double *ys);
+
+/**
+ * @brief Checks an engine whose results may differ from the reference, instruction by instruction.
+ *
+ * Approximations are checked where they are made instead of at the results, because the functions applied to
+ * an approximated value may amplify its error arbitrarily (e.g. tan(exp(x)) for large x).
+ *
+ * @param input    The expression and the grid.
+ * @param x        Set to the x value of the first sample out of the bound.
+ * @param expected Set to the exact value of the approximated instruction at that sample.
+ * @param actual   Set to the approximated value.
+ * @return 1 if a value is out of the bound, 0 otherwise.
+ */
+typedef int (*EngineValidate)(const EngineInput *input, double *x, double *expected, double *actual);
+
+/**
+ * @brief An evaluation engine and the largest difference to the reference it may have.
+ */
+typedef struct Engine {
+    const char *name; /**< The name of the engine in reports */
+    EngineRun run; /**< Evaluates an expression with the engine */
+    uint64_t ulp_budget; /**< Allowed distance to the reference in units in the last place */
+    EngineValidate validate; /**< Checks an approximating engine against its own error bound, NULL for exact engines */
+} Engine;
+
+/**
+ * @brief Evaluates a compiled program block by block.
+ */
+static void run_program(const Program *program, const EngineInput *input, double *ys) {
+    double *registers = malloc(program->length * SAMPLE_BLOCK_SIZE * sizeof(double));
+    double *block_ys[2];
+
+    for (size_t offset = 0; offset < input->count; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t block = input->count - offset < SAMPLE_BLOCK_SIZE ? input->count - offset : SAMPLE_BLOCK_SIZE;
+        double scratch[SAMPLE_BLOCK_SIZE];
+        block_ys[0] = ys + offset;
+        block_ys[1] = scratch;
+        execute_block(program, input->xs + offset, block, CHECK_PARAMETERS, registers, block_ys);
+    }
+    free(registers);
+}
+
+/**
+ * @brief The compiled program of a single expression, evaluated in blocks.
+ */
+static void run_compiled(const EngineInput *input, double *ys) {
+    Program *program = compile(input->tree);
+    run_program(program, input, ys);
+    free_program(program);
+}
+
+/**
+ * @brief The expression fused with its companion into one program with shared subexpressions.
+ */
+static void run_fused(const EngineInput *input, double *ys) {
+    Node *trees[2] = {(Node *) input->tree, (Node *) input->companion};
+    Program *program = compile_expressions(trees, 2);
+    run_program(program, input, ys);
+    free_program(program);
+}
+
+/**
+ * @brief The sweep evaluator with x-only subexpressions cached over the grid and parameter-only ones hoisted.
+ */
+static void run_sweep(const EngineInput *input, double *ys) {
+    Program *program = compile(input->tree);
+    SweepCache *cache = prepare_sweep(program, input->limits);
+    double *const outputs[1] = {ys};
+    evaluate_sweep_frame(cache, CHECK_PARAMETERS, outputs);
+    free_sweep_cache(cache);
+    free_program(program);
+}
+
+/**
+ * @brief The program with patchable literals, every literal patched to another value and back.
+ *
+ * Restoring a literal recomputes every folded constant depending on it, so the result only matches if the
+ * constant pool replays the folding of the compiler exactly.
+ */
+static void run_patched(const EngineInput *input, double *ys) {
+    Node *trees[1] = {(Node *) input->tree};
+    Program *program = compile_patchable(trees, 1);
+    for (size_t slot = 0; slot < program->pool->count; slot++) {
+        const double value = program->pool->values[slot];
+        patch_constant(program, slot, 2.0 * value + 1.0);
+        patch_constant(program, slot, value);
+    }
+    run_program(program, input, ys);
+    free_program(program);
+}
+
+/**
+ * @brief Capacity of the blocks pulled from the sampler, not a multiple of SAMPLE_BLOCK_SIZE so that its blocks
+ * are split and continued across pulls.
+ */
+#define CHECK_PULL_CAPACITY 100
+
+/**
+ * @brief The sampler iterator specialised to the grid, pulled in blocks of CHECK_PULL_CAPACITY samples.
+ */
+static void run_sampler(const EngineInput *input, double *ys) {
+    SamplerOptions options = {{0}, 0, 0};
+    memcpy(options.parameters, CHECK_PARAMETERS, sizeof(CHECK_PARAMETERS));
+    Sampler *sampler = sampler_open_program(compile(input->tree), input->limits, &options);
+    double xs[CHECK_PULL_CAPACITY];
+    unsigned char flags[CHECK_PULL_CAPACITY];
+    size_t offset = 0;
+    size_t block;
+
+    while (offset < input->count &&
+           (block = sampler_next_block(sampler, xs, ys + offset, flags, input->count - offset < CHECK_PULL_CAPACITY
+                                                                        ? input->count - offset
+                                                                        : CHECK_PULL_CAPACITY))) {
+        offset += block;
+    }
+    for (; offset < input->count; offset++) {
+        ys[offset] = NAN; // Not produced, the grid ended early
+    }
+    sampler_close(sampler);
+}
+
+/**
+ * @brief The compiled program, written into a lossless sample file and decoded from it block by block.
+ *
+ * A sample whose x value does not survive the round trip is reported as NaN, so it shows up as a mismatch.
+ */
+static void run_stored(const EngineInput *input, double *ys) {
+    FILE *file = tmpfile();
+    if (!file) {
+        error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+    }
+    run_compiled(input, ys);
+    SampleWriter writer;
+    begin_sample_file(&writer, file, input->limits, 1, SAMPLE_ENCODING_XOR);
+    write_samples(&writer, input->xs, ys, input->count, input->count);
+    const size_t size = (size_t) end_sample_file(&writer);
+
+    unsigned char *data = malloc(size);
+    rewind(file);
+    const size_t read = fread(data, 1, size, file);
+    fclose(file);
+    for (size_t i = 0; i < input->count; i++) {
+        ys[i] = NAN;
+    }
+
+    SampleReader reader;
+    if (open_sample_file(&reader, data, read) == 0) {
+        double *xs = malloc(reader.block_samples * sizeof(double));
+        double *values = malloc(reader.block_samples * sizeof(double));
+        unsigned char *flags = malloc(reader.block_samples);
+        size_t offset = 0;
+        for (size_t block = 0; block < reader.block_count; block++) {
+            const size_t count = decode_sample_block(&reader, block, xs, values, flags);
+            for (size_t i = 0; i < count && offset < input->count; i++, offset++) {
+                ys[offset] = memcmp(&xs[i], &input->xs[offset], sizeof(double)) == 0 ? values[i] : NAN;
+            }
+        }
+        free(xs);
+        free(values);
+        free(flags);
+    }
+    free(data);
+}
+
+/**
+ * @brief Maps a double to an integer whose order matches the order of the doubles.
+ */
+static int64_t ordered_bits(const double value) {
+    int64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits < 0 ? INT64_MIN - bits : bits;
+}
+
+/**
+ * @brief Checks whether a value matches the reference within a budget.
+ *
+ * @param expected   The value of the reference.
+ * @param actual     The value of the engine.
+ * @param ulp_budget The allowed distance in units in the last place.
+ * @return 1 if the values match, 0 otherwise.
+ */
+static int values_match(const double expected, const double actual, const uint64_t ulp_budget) {
+    if (isnan(expected) || isnan(actual)) return isnan(expected) && isnan(actual);
+    if (isinf(expected) || isinf(actual)) return expected == actual;
+
+    const int64_t a = ordered_bits(expected);
+    const int64_t b = ordered_bits(actual);
+    const uint64_t distance = a > b ? (uint64_t) a - (uint64_t) b : (uint64_t) b - (uint64_t) a;
+    return distance <= ulp_budget;
+}
+
+/**
+ * @brief The compiled program with sin, cos and exp of affine arguments advanced by recurrences along the grid.
+ *
+ * Every recurrent instruction has to stay within `recurrence_drift_bound()` of libm applied to its argument,
+ * absolutely for sin and cos, relatively for exp.
+ */
+static int validate_recurrence(const EngineInput *input, double *x, double *expected, double *actual) {
+    Program *program = compile(input->tree);
+    double *registers = malloc(program->length * SAMPLE_BLOCK_SIZE * sizeof(double));
+    const double max_abs_x = fmax(fabs(input->limits->x_min), fabs(input->limits->x_max));
+    double scratch[SAMPLE_BLOCK_SIZE];
+    double *block_ys[1] = {scratch};
+    int found = 0;
+
+    enable_recurrences(program, X_EVALUATION_STEP);
+    for (size_t offset = 0; offset < input->count && !found; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t block = input->count - offset < SAMPLE_BLOCK_SIZE ? input->count - offset : SAMPLE_BLOCK_SIZE;
+        execute_block(program, input->xs + offset, block, CHECK_PARAMETERS, registers, block_ys);
+
+        for (size_t i = 0; i < program->length && !found; i++) {
+            const Recurrence *recurrence = &program->recurrences[i];
+            if (recurrence->kind == RECURRENCE_NONE) continue;
+
+            const double bound = recurrence_drift_bound(recurrence, X_EVALUATION_STEP, max_abs_x);
+            const double *arguments = registers + program->code[i].left * block;
+            const double *values = registers + i * block;
+            for (size_t j = 0; j < block; j++) {
+                double exact;
+                int inside;
+                if (program->code[i].code == OP_EXP) {
+                    exact = exp(arguments[j]);
+                    inside = isinf(exact) || isinf(values[j]) ? exact == values[j]
+                                                              : fabs(values[j] - exact) <= bound * exact + DBL_MIN;
+                } else {
+                    exact = program->code[i].code == OP_SIN ? sin(arguments[j]) : cos(arguments[j]);
+                    inside = fabs(values[j] - exact) <= bound;
+                }
+                inside |= isnan(exact) && isnan(values[j]);
+                if (!inside) {
+                    *x = input->xs[offset + j];
+                    *expected = exact;
+                    *actual = values[j];
+                    found = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    free(registers);
+    free_program(program);
+    return found;
+}
+
+/**
+ * @brief Largest distance of the narrow sin and cos kernels to libm, in units in the last place.
+ */
+#define NARROW_ULP_BUDGET 4
+
+/**
+ * @brief The compiled program specialised to the proven ranges of its instructions over the grid.
+ *
+ * Every value of every instruction has to lie inside of its proven interval, and may only be NaN where the
+ * analysis allows it. The narrow sin and cos kernels have to stay within NARROW_ULP_BUDGET of libm applied
+ * to their argument.
+ */
+static int validate_ranges(const EngineInput *input, double *x, double *expected, double *actual) {
+    Program *program = compile(input->tree);
+    double *registers = malloc(program->length * SAMPLE_BLOCK_SIZE * sizeof(double));
+    double scratch[SAMPLE_BLOCK_SIZE];
+    double *block_ys[1] = {scratch};
+    int found = 0;
+
+    specialise_ranges(program, input->limits, 1);
+    for (size_t offset = 0; offset < input->count && !found; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t block = input->count - offset < SAMPLE_BLOCK_SIZE ? input->count - offset : SAMPLE_BLOCK_SIZE;
+        execute_block(program, input->xs + offset, block, CHECK_PARAMETERS, registers, block_ys);
+
+        for (size_t i = 0; i < program->length && !found; i++) {
+            const Interval range = program->ranges[i];
+            const OpCode code = program->code[i].code;
+            const double *arguments = registers + program->code[i].left * block;
+            const double *values = registers + i * block;
+            for (size_t j = 0; j < block; j++) {
+                // A value outside of its interval is reported with the violated bound as the expected value
+                double bound = isnan(values[j]) ? NAN : values[j] < range.lo ? range.lo : range.hi;
+                int inside = isnan(values[j]) ? range.nan : range.lo <= values[j] && values[j] <= range.hi;
+                if (inside && (code == OP_SIN_NARROW || code == OP_COS_NARROW)) {
+                    bound = code == OP_SIN_NARROW ? sin(arguments[j]) : cos(arguments[j]);
+                    inside = values_match(bound, values[j], NARROW_ULP_BUDGET);
+                }
+                if (!inside) {
+                    *x = input->xs[offset + j];
+                    *expected = bound;
+                    *actual = values[j];
+                    found = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    free(registers);
+    free_program(program);
+    return found;
+}
+
+/**
+ * @brief Largest distance of the double-double operations, rounded to double, to libm, in units in the last place.
+ */
+#define DOUBLE_DOUBLE_ULP_BUDGET 4
+
+/**
+ * @brief The compiled program evaluated in double-double precision, as deep zooms do.
+ *
+ * Its results are more accurate than the reference, so they are checked instruction by instruction instead. Every
+ * operation applied to the double operands of the plain program has to stay within DOUBLE_DOUBLE_ULP_BUDGET of
+ * libm, and the vectorised lanes of `execute_block_dd()` have to give exactly what `dd_apply()` gives for their
+ * operands.
+ */
+static int validate_double_double(const EngineInput *input, double *x, double *expected, double *actual) {
+    Program *program = compile(input->tree);
+    double *registers = malloc(program->length * SAMPLE_BLOCK_SIZE * sizeof(double));
+    double *dd_registers = malloc(2 * program->length * SAMPLE_BLOCK_SIZE * sizeof(double));
+    const double zeros[SAMPLE_BLOCK_SIZE] = {0.0};
+    double scratch[SAMPLE_BLOCK_SIZE];
+    double *block_ys[1] = {scratch};
+    int found = 0;
+
+    for (size_t offset = 0; offset < input->count && !found; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t block = input->count - offset < SAMPLE_BLOCK_SIZE ? input->count - offset : SAMPLE_BLOCK_SIZE;
+        const double *hi = dd_registers;
+        const double *lo = dd_registers + program->length * block;
+        execute_block(program, input->xs + offset, block, CHECK_PARAMETERS, registers, block_ys);
+        execute_block_dd(program, input->xs + offset, zeros, block, CHECK_PARAMETERS, dd_registers, block_ys);
+
+        for (size_t i = 0; i < program->length && !found; i++) {
+            const Instruction *instruction = &program->code[i];
+            const int operands = operand_count(instruction->code);
+            if (operands == 0) continue;
+
+            const size_t left = instruction->left * block;
+            const size_t right = operands == 2 ? instruction->right * block : left;
+            for (size_t j = 0; j < block; j++) {
+                const DoubleDouble rounded = dd_apply(instruction->code, (DoubleDouble){registers[left + j], 0.0},
+                                                      (DoubleDouble){registers[right + j], 0.0});
+                const DoubleDouble lane = dd_apply(instruction->code, (DoubleDouble){hi[left + j], lo[left + j]},
+                                                   (DoubleDouble){hi[right + j], lo[right + j]});
+                const double value = hi[i * block + j] + lo[i * block + j];
+                if (!values_match(registers[i * block + j], rounded.hi + rounded.lo, DOUBLE_DOUBLE_ULP_BUDGET)) {
+                    *expected = registers[i * block + j];
+                    *actual = rounded.hi + rounded.lo;
+                } else if (!values_match(lane.hi + lane.lo, value, 0)) {
+                    *expected = lane.hi + lane.lo;
+                    *actual = value;
+                } else {
+                    continue;
+                }
+                *x = input->xs[offset + j];
+                found = 1;
+                break;
+            }
+        }
+    }
+
+    free(dd_registers);
+    free(registers);
+    free_program(program);
+    return found;
+}
+
+/**
+ * @brief The engines checked against the reference.
+ */
+static const Engine engines[] = {
+    {"compiled", run_compiled, 0, NULL},
+    {"fused", run_fused, 0, NULL},
+    {"sweep", run_sweep, 0, NULL},
+    {"sampler", run_sampler, 0, NULL},
+    {"patched", run_patched, 0, NULL},
+    {"stored", run_stored, 0, NULL},
+    {"recurrence", NULL, 0, validate_recurrence},
+    {"ranges", NULL, 0, validate_ranges},
+    {"double_double", NULL, 0, validate_double_double},
+};
+
+/**
+ * @brief Number of checked engines.
+ */
+#define ENGINE_COUNT (sizeof(engines) / sizeof(engines[0]))
+
+/**
+ * @brief A value that differs from the reference by more than the budget of its engine.
+ */
+typedef struct Mismatch {
+    size_t engine; /**< Index of the engine */
+    size_t limits; /**< Index of the grid */
+    double x; /**< The x value of the sample */
+    double expected; /**< The value of the reference */
+    double actual; /**< The value of the engine */
+} Mismatch;
+
+/**
+ * @brief Parses an expression.
+ */
+static Node *parse_text(const char *text) {
+    Lexer *lexer = initialize_lexer(text);
+    Node *tree = parse(lexer);
+    free(lexer);
+    return tree;
+}
+
+/**
+ * @brief Evaluates an expression with every engine on every grid and looks for the first mismatch.
+ *
+ * @param tree      The expression under test.
+ * @param companion The expression fused with it.
+ * @param mismatch  Set to the first mismatch if there is one.
+ * @return 1 if a mismatch was found, 0 if all engines agree with the reference.
+ */
+static int find_mismatch(const Node *tree, const Node *companion, Mismatch *mismatch) {
+    for (size_t l = 0; l < CHECK_LIMITS_COUNT; l++) {
+        Limits limits;
+        parse_limits(CHECK_LIMITS[l], &limits);
+
+        EngineInput input = {tree, companion, &limits, NULL, count_samples(&limits)};
+        double *xs = malloc((input.count ? input.count : 1) * sizeof(double));
+        double *expected = malloc((input.count ? input.count : 1) * sizeof(double));
+        double *actual = malloc((input.count ? input.count : 1) * sizeof(double));
+        double cursor = limits.x_min;
+        int found = 0;
+
+        next_sample_block(&limits, &cursor, xs, input.count);
+        input.xs = xs;
+        for (size_t i = 0; i < input.count; i++) {
+            expected[i] = evaluate_with_parameters(tree, xs[i], CHECK_PARAMETERS);
+        }
+
+        for (size_t e = 0; e < ENGINE_COUNT && !found; e++) {
+            if (engines[e].validate) {
+                Mismatch candidate = {e, l, 0.0, 0.0, 0.0};
+                found = engines[e].validate(&input, &candidate.x, &candidate.expected, &candidate.actual);
+                if (found) {
+                    *mismatch = candidate;
+                }
+                continue;
+            }
+            engines[e].run(&input, actual);
+            for (size_t i = 0; i < input.count; i++) {
+                if (!values_match(expected[i], actual[i], engines[e].ulp_budget)) {
+                    *mismatch = (Mismatch){e, l, xs[i], expected[i], actual[i]};
+                    found = 1;
+                    break;
+                }
+            }
+        }
+
+        free(actual);
+        free(expected);
+        free(xs);
+        if (found) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief A growing string an expression is formatted into.
+ */
+typedef struct Text {
+    char *data;
+    size_t length;
+    size_t capacity;
+} Text;
+
+/**
+ * @brief Appends a string to a text.
+ */
+static void append(Text *text, const char *string) {
+    const size_t length = strlen(string);
+    while (text->length + length + 1 > text->capacity) {
+        text->capacity = text->capacity ? text->capacity * 2 : 64;
+        text->data = realloc(text->data, text->capacity);
+    }
+    memcpy(text->data + text->length, string, length + 1);
+    text->length += length;
+}
+
+/**
+ * @brief Formats a tree as an expression, replacing one node by another subtree or by a literal.
+ *
+ * Binary operators and unary minus are always parenthesised, so the formatted expression parses into the same tree.
+ *
+ * @param node        The tree to be formatted.
+ * @param target      The node to be replaced, NULL to format the tree unchanged.
+ * @param replacement The subtree written instead of `target`, or NULL to write `literal`.
+ * @param literal     The text written instead of `target` if `replacement` is NULL.
+ * @param text        The text the expression is appended to.
+ */
+static void format_node(const Node *node, const Node *target, const Node *replacement, const char *literal,
+                        Text *text) {
+    char number[32];
+
+    if (node == target) {
+        if (replacement == NULL) {
+            append(text, literal);
+            return;
+        }
+        node = replacement;
+    }
+    switch (node->type) {
+        case NODE_NUM:
+            snprintf(number, sizeof(number), "%.17g", node->num);
+            append(text, number);
+            break;
+        case NODE_ID:
+            append(text, node->id);
+            break;
+        case NODE_FUNC:
+            append(text, node->func.func);
+            append(text, "(");
+            format_node(node->func.arg, target, replacement, literal, text);
+            append(text, ")");
+            break;
+        case NODE_OP: {
+            const char operator[2] = {node->op.op, END_OF_FILE};
+            append(text, "(");
+            if (node->op.left) {
+                format_node(node->op.left, target, replacement, literal, text);
+            }
+            append(text, operator);
+            format_node(node->op.right, target, replacement, literal, text);
+            append(text, ")");
+            break;
+        }
+        default:
+            error_exit(ERROR_UNKNOWN_NODE_TEXT, ERROR_FUNCTION);
+    }
+}
+
+/**
+ * @brief Collects the nodes of a tree in pre-order.
+ */
+static void collect_nodes(const Node *node, const Node **nodes, size_t *count) {
+    if (node == NULL) return;
+    nodes[(*count)++] = node;
+    if (node->type == NODE_OP) {
+        collect_nodes(node->op.left, nodes, count);
+        collect_nodes(node->op.right, nodes, count);
+    } else if (node->type == NODE_FUNC) {
+        collect_nodes(node->func.arg, nodes, count);
+    }
+}
+
+/**
+ * @brief Tries one smaller variant of a failing expression.
+ *
+ * @param tree      The failing expression.
+ * @param target    The node to be replaced.
+ * @param replacement The subtree written instead of `target`, or NULL to write `literal`.
+ * @param literal   The text written instead of `target` if `replacement` is NULL.
+ * @param companion The expression fused with it.
+ * @param mismatch  Set to the mismatch of the variant if it still fails.
+ * @return The parsed variant if it still fails, NULL otherwise.
+ */
+static Node *try_variant(const Node *tree, const Node *target, const Node *replacement, const char *literal,
+                         const Node *companion, Mismatch *mismatch) {
+    Text text = {NULL, 0, 0};
+    format_node(tree, target, replacement, literal, &text);
+    Node *variant = parse_text(text.data);
+    free(text.data);
+
+    if (count_nodes(variant) < count_nodes(tree) && find_mismatch(variant, companion, mismatch)) {
+        return variant;
+    }
+    free_node(variant);
+    return NULL;
+}
+
+/**
+ * @brief Shrinks a failing expression to a minimal reproducer.
+ *
+ * Nodes are greedily replaced by one of their operands, by 'x' or by a constant as long as the expression keeps
+ * failing, until no single replacement fails any more.
+ *
+ * @param tree      The failing expression, it is released.
+ * @param companion The expression fused with it.
+ * @param mismatch  Updated to the mismatch of the reproducer.
+ * @return The reproducer.
+ */
+static Node *shrink(Node *tree, const Node *companion, Mismatch *mismatch) {
+    int shrunk = 1;
+
+    while (shrunk) {
+        const size_t count = count_nodes(tree);
+        const Node **nodes = malloc(count * sizeof(Node *));
+        size_t collected = 0;
+        Node *variant = NULL;
+
+        collect_nodes(tree, nodes, &collected);
+        for (size_t i = 0; i < collected && !variant; i++) {
+            const Node *node = nodes[i];
+            if (node->type == NODE_OP) {
+                if (node->op.left) variant = try_variant(tree, node, node->op.left, NULL, companion, mismatch);
+                if (!variant) variant = try_variant(tree, node, node->op.right, NULL, companion, mismatch);
+            } else if (node->type == NODE_FUNC) {
+                variant = try_variant(tree, node, node->func.arg, NULL, companion, mismatch);
+            }
+            if (!variant && node->type != NODE_ID && node->type != NODE_NUM) {
+                variant = try_variant(tree, node, NULL, X, companion, mismatch);
+            }
+            if (!variant && node->type != NODE_ID && node->type != NODE_NUM) {
+                variant = try_variant(tree, node, NULL, "1", companion, mismatch);
+            }
+        }
+        free(nodes);
+
+        shrunk = variant != NULL;
+        if (variant) {
+            free_node(tree);
+            tree = variant;
+        }
+    }
+    return tree;
+}
+
+int main(const int argc, char *argv[]) {
+    GeneratorOptions options;
+    Generator generator;
+    unsigned long long seed = 1;
+    unsigned long long count = 200;
+    unsigned long long failures = 0;
+    int verbose = 0;
+
+    initialize_generator_options(&options);
+    options.nodes = 40;
+    options.poles = 0.1;
+    options.duplicates = 0.2;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--count=", 8) == 0) {
+            count = strtoull(argv[i] + 8, NULL, 10);
+        } else if (strncmp(argv[i], "--nodes=", 8) == 0) {
+            options.nodes = (size_t) strtoull(argv[i] + 8, NULL, 10);
+        } else if (strncmp(argv[i], "--poles=", 8) == 0) {
+            options.poles = atof(argv[i] + 8);
+        } else if (strncmp(argv[i], "--duplicates=", 13) == 0) {
+            options.duplicates = atof(argv[i] + 13);
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = 1;
+        } else {
+            error_exit(CHECK_USAGE_TEXT, ERROR_ARGS);
+        }
+    }
+    if (options.nodes < 1) {
+        error_exit(CHECK_USAGE_TEXT, ERROR_ARGS);
+    }
+
+    initialize_generator(&generator, &options, seed);
+    Node *companion = parse_text("sin(x)*x+cos(x)");
+    for (unsigned long long i = 0; i < count; i++) {
+        Mismatch mismatch;
+        char *expression = generate_expression(&generator, NULL);
+        Node *tree = parse_text(expression);
+
+        if (verbose) {
+            fprintf(stderr, "%llu: %s\n", i, expression);
+        }
+        if (find_mismatch(tree, companion, &mismatch)) {
+            Text reproducer = {NULL, 0, 0};
+            tree = shrink(tree, companion, &mismatch);
+            format_node(tree, NULL, NULL, NULL, &reproducer);
+            printf("mismatch in engine %s on limits %s at x = %.17g: expected %.17g, got %.17g\n",
+                   engines[mismatch.engine].name, CHECK_LIMITS[mismatch.limits], mismatch.x, mismatch.expected,
+                   mismatch.actual);
+            printf("  expression: %s\n  reproducer: %s\n", expression, reproducer.data);
+            free(reproducer.data);
+            failures++;
+        }
+
+        // The next expression is fused with this one, so shared subexpressions get exercised across expressions
+        free_node(companion);
+        companion = tree;
+        free(expression);
+    }
+    free_node(companion);
+    free_generator(&generator);
+
+    printf("checked %llu expressions on %lu grids with %lu engines: %llu mismatches\n", count,
+           (unsigned long) CHECK_LIMITS_COUNT, (unsigned long) ENGINE_COUNT, failures);
+    return failures ? CHECK_MISMATCH : 0;
+}
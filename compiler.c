@@ -0,0 +1,685 @@
+#include "compiler.h"
+#include <float.h>
+
+/**
+ * @brief Marks an empty entry of the instruction hash table.
+ */
+#define EMPTY_ENTRY ((size_t) -1)
+
+/**
+ * @brief State of a running compilation.
+ *
+ * Every emitted instruction is also entered into an open-addressing hash table, so that emitting an
+ * instruction identical to an existing one returns the existing slot instead.
+ */
+typedef struct Compilation {
+    Program *program; /**< The program being compiled */
+    ConstantPool *pool; /**< The constant pool of a patchable program, NULL otherwise */
+    size_t expression; /**< The expression being compiled */
+    size_t *table; /**< Hash table of instruction slots, EMPTY_ENTRY for free entries */
+    size_t table_size; /**< Number of entries of the hash table, always a power of two */
+} Compilation;
+
+/**
+ * @brief Value of a compiled subtree, either a folded constant or the slot of an instruction.
+ *
+ * Constants are only emitted once they are used as an operand of something that is not constant,
+ * so folding never has to remove instructions from the program.
+ */
+typedef struct Operand {
+    int constant; /**< 1 if the subtree was folded into `value` */
+    double value; /**< The value of a folded subtree */
+    size_t slot; /**< The slot of a subtree that was not folded */
+    size_t fold; /**< The fold of a folded subtree of a patchable program */
+} Operand;
+
+/**
+ * @brief Marks a fold that no instruction holds.
+ */
+#define NO_HOLDER ((size_t) -1)
+
+/**
+ * @brief Computes the hash of an instruction from the fields that define its value.
+ *
+ * @param instruction The instruction.
+ * @return The hash value.
+ */
+static size_t hash_instruction(const Instruction *instruction) {
+    unsigned long long bits;
+    memcpy(&bits, &instruction->value, sizeof(bits));
+
+    unsigned long long hash = (unsigned long long) instruction->code * 0x9E3779B97F4A7C15ULL;
+    hash ^= (instruction->left + 0x632BE59BD9B4E019ULL) * 0xBF58476D1CE4E5B9ULL;
+    hash ^= (instruction->right + 0x85157AF5ULL) * 0x94D049BB133111EBULL;
+    hash ^= (bits ^ (unsigned long long) (instruction->parameter + 1)) * 0xD6E8FEB86659FD93ULL;
+    hash ^= hash >> 31;
+
+    return (size_t) hash;
+}
+
+/**
+ * @brief Checks whether two instructions always produce the same value.
+ *
+ * @param a The first instruction.
+ * @param b The second instruction.
+ * @return 1 if the instructions are identical, 0 otherwise.
+ */
+static int same_instruction(const Instruction *a, const Instruction *b) {
+    return a->code == b->code && a->left == b->left && a->right == b->right &&
+           memcmp(&a->value, &b->value, sizeof(double)) == 0 && a->parameter == b->parameter;
+}
+
+/**
+ * @brief Inserts a slot into the hash table without checking for duplicates.
+ *
+ * @param compilation The running compilation.
+ * @param slot        The slot to be inserted.
+ */
+static void insert_entry(Compilation *compilation, const size_t slot) {
+    size_t entry = hash_instruction(&compilation->program->code[slot]) & (compilation->table_size - 1);
+    while (compilation->table[entry] != EMPTY_ENTRY) {
+        entry = (entry + 1) & (compilation->table_size - 1);
+    }
+    compilation->table[entry] = slot;
+}
+
+/**
+ * @brief Appends an instruction to the program unless an identical instruction already exists.
+ *
+ * @param compilation The running compilation.
+ * @param instruction The instruction to be appended.
+ * @return The slot holding the value of the instruction.
+ */
+static size_t emit(Compilation *compilation, const Instruction instruction) {
+    Program *program = compilation->program;
+
+    size_t entry = hash_instruction(&instruction) & (compilation->table_size - 1);
+    while (compilation->table[entry] != EMPTY_ENTRY) {
+        if (same_instruction(&program->code[compilation->table[entry]], &instruction)) {
+            return compilation->table[entry];
+        }
+        entry = (entry + 1) & (compilation->table_size - 1);
+    }
+
+    if (program->length == program->capacity) {
+        program->capacity = program->capacity ? program->capacity * 2 : 16;
+        program->code = realloc(program->code, program->capacity * sizeof(Instruction));
+    }
+    program->code[program->length] = instruction;
+    compilation->table[entry] = program->length;
+
+    // Keep the hash table at most half full
+    if (2 * (program->length + 1) > compilation->table_size) {
+        free(compilation->table);
+        compilation->table_size *= 2;
+        compilation->table = malloc(compilation->table_size * sizeof(size_t));
+        for (size_t i = 0; i < compilation->table_size; i++) {
+            compilation->table[i] = EMPTY_ENTRY;
+        }
+        for (size_t i = 0; i <= program->length; i++) {
+            insert_entry(compilation, i);
+        }
+    }
+    return program->length++;
+}
+
+/**
+ * @brief Returns the slot of an operand, emitting its constant if it was folded.
+ *
+ * @param compilation The running compilation.
+ * @param operand     The compiled operand.
+ * @return The slot holding the value of the operand.
+ */
+static size_t materialize(Compilation *compilation, const Operand operand) {
+    if (operand.constant && compilation->pool) {
+        // The fold is part of the identity, so constants from different literals are never merged
+        const size_t slot = emit(compilation, (Instruction){OP_CONST, 0, 0, 0, operand.value, (int) operand.fold});
+        compilation->pool->holders[operand.fold] = slot;
+        return slot;
+    }
+    if (operand.constant) {
+        return emit(compilation, (Instruction){OP_CONST, 0, 0, 0, operand.value, -1});
+    }
+    return operand.slot;
+}
+
+/**
+ * @brief Records a folded constant of a patchable program.
+ *
+ * @param pool        The constant pool.
+ * @param instruction The fold, a literal or an operation on earlier folds.
+ * @param value       Its value.
+ * @return The index of the fold.
+ */
+static size_t add_fold(ConstantPool *pool, const Instruction instruction, const double value) {
+    if (pool->fold_count == pool->fold_capacity) {
+        pool->fold_capacity = pool->fold_capacity ? pool->fold_capacity * 2 : 16;
+        pool->folds = realloc(pool->folds, pool->fold_capacity * sizeof(Instruction));
+        pool->folded = realloc(pool->folded, pool->fold_capacity * sizeof(double));
+        pool->holders = realloc(pool->holders, pool->fold_capacity * sizeof(size_t));
+    }
+    pool->folds[pool->fold_count] = instruction;
+    pool->folded[pool->fold_count] = value;
+    pool->holders[pool->fold_count] = NO_HOLDER;
+    return pool->fold_count++;
+}
+
+/**
+ * @brief Compiles a numeric literal, giving it a slot of the constant pool of a patchable program.
+ *
+ * @param compilation The running compilation.
+ * @param node        The NODE_NUM node.
+ * @return The folded literal.
+ */
+static Operand compile_literal(Compilation *compilation, const Node *node) {
+    ConstantPool *pool = compilation->pool;
+    if (!pool) {
+        return (Operand){1, node->num, 0, 0};
+    }
+
+    if (pool->count == pool->slot_capacity) {
+        pool->slot_capacity = pool->slot_capacity ? pool->slot_capacity * 2 : 16;
+        pool->values = realloc(pool->values, pool->slot_capacity * sizeof(double));
+        pool->spans = realloc(pool->spans, pool->slot_capacity * sizeof(ConstantSpan));
+    }
+    const size_t slot = pool->count++;
+    pool->values[slot] = node->num;
+    pool->spans[slot] = (ConstantSpan){compilation->expression, node->start, node->end};
+    const Instruction literal = {OP_CONST, 0, 0, 0, 0.0, (int) slot};
+    return (Operand){1, node->num, 0, add_fold(pool, literal, node->num)};
+}
+
+/**
+ * @brief Maps a function name of the abstract syntax tree to its operation code.
+ *
+ * @param name The function name stored in a NODE_FUNC node.
+ * @return The operation code of the function.
+ */
+static OpCode function_code(const char *name) {
+    if (strcmp(name, SIN) == 0) return OP_SIN;
+    if (strcmp(name, COS) == 0) return OP_COS;
+    if (strcmp(name, TAN) == 0) return OP_TAN;
+    if (strcmp(name, ABS) == 0) return OP_ABS;
+    if (strcmp(name, LN) == 0) return OP_LN;
+    if (strcmp(name, LOG) == 0) return OP_LOG;
+    if (strcmp(name, ASIN) == 0) return OP_ASIN;
+    if (strcmp(name, ACOS) == 0) return OP_ACOS;
+    if (strcmp(name, ATAN) == 0) return OP_ATAN;
+    if (strcmp(name, SINH) == 0) return OP_SINH;
+    if (strcmp(name, COSH) == 0) return OP_COSH;
+    if (strcmp(name, TANH) == 0) return OP_TANH;
+    if (strcmp(name, EXP) == 0) return OP_EXP;
+
+    error_exit(ERROR_UNKNOWN_FUNCTION_TEXT, ERROR_FUNCTION);
+    return OP_CONST; // never reached
+}
+
+/**
+ * @brief Maps a binary operator of the abstract syntax tree to its operation code.
+ *
+ * @param op The operator character stored in a NODE_OP node.
+ * @return The operation code of the operator.
+ */
+static OpCode operator_code(const char op) {
+    switch (op) {
+        case PLUS: return OP_ADD;
+        case MINUS: return OP_SUB;
+        case MULT: return OP_MUL;
+        case DIVISION: return OP_DIV;
+        case POWER: return OP_POW;
+        default: error_exit(ERROR_UNKNOWN_OPERATOR_TEXT, ERROR_FUNCTION);
+    }
+    return OP_CONST; // never reached
+}
+
+/**
+ * @brief Compiles an operation, folding it into a constant when all of its operands are constant.
+ *
+ * @param compilation The running compilation.
+ * @param code        The operation code.
+ * @param left        The first operand.
+ * @param right       The second operand (ignored by unary operations).
+ * @return The compiled operation.
+ */
+static Operand compile_operation(Compilation *compilation, const OpCode code, const Operand left, const Operand right) {
+    const int binary = operand_count(code) == 2;
+
+    if (left.constant && (!binary || right.constant)) {
+        const Instruction instruction = {code, 0, 0, 0, 0.0, -1};
+        const double right_value = binary ? right.value : 0.0;
+        double value;
+        execute_instruction(&instruction, &value, &left.value, &right_value, NULL, NULL, 1);
+        if (compilation->pool) {
+            const Instruction fold = {code, 0, left.fold, binary ? right.fold : 0, 0.0, -1};
+            return (Operand){1, value, 0, add_fold(compilation->pool, fold, value)};
+        }
+        return (Operand){1, value, 0, 0};
+    }
+
+    Instruction instruction = {code, 0, materialize(compilation, left), 0, 0.0, -1};
+    if (binary) {
+        instruction.right = materialize(compilation, right);
+    }
+    instruction.dependency = compilation->program->code[instruction.left].dependency;
+    if (binary) {
+        instruction.dependency |= compilation->program->code[instruction.right].dependency;
+    }
+    return (Operand){0, 0.0, emit(compilation, instruction), 0};
+}
+
+/**
+ * @brief Compiles a subtree in post-order.
+ *
+ * @param compilation The running compilation.
+ * @param node        The root of the subtree.
+ * @return The compiled subtree.
+ */
+static Operand compile_node(Compilation *compilation, const Node *node) {
+    const Operand none = {1, 0.0, 0, 0};
+
+    switch (node->type) {
+        case NODE_NUM:
+            return compile_literal(compilation, node);
+
+        case NODE_ID: {
+            const int parameter = parameter_index(node->id);
+            if (parameter == -1) {
+                return (Operand){0, 0.0, emit(compilation, (Instruction){OP_X, DEPENDS_ON_X, 0, 0, 0.0, -1}), 0};
+            }
+            return (Operand){
+                0, 0.0, emit(compilation, (Instruction){OP_PARAMETER, DEPENDS_ON_PARAMETERS, 0, 0, 0.0, parameter}), 0
+            };
+        }
+
+        case NODE_FUNC: {
+            const OpCode code = function_code(node->func.func);
+            return compile_operation(compilation, code, compile_node(compilation, node->func.arg), none);
+        }
+
+        case NODE_OP: {
+            if (node->op.left == NULL) {
+                return compile_operation(compilation, OP_NEG, compile_node(compilation, node->op.right), none);
+            }
+            const OpCode code = operator_code(node->op.op);
+            const Operand left = compile_node(compilation, node->op.left);
+            const Operand right = compile_node(compilation, node->op.right);
+            return compile_operation(compilation, code, left, right);
+        }
+
+        default:
+            error_exit(ERROR_UNKNOWN_NODE_TEXT, ERROR_FUNCTION);
+    }
+    return none; // never reached
+}
+
+Program *compile(const Node *abstract_syntax_tree) {
+    Node *const trees[] = {(Node *) abstract_syntax_tree};
+    return compile_expressions(trees, 1);
+}
+
+/**
+ * @brief Compiles several abstract syntax trees into one fused program.
+ *
+ * @param abstract_syntax_trees Array of pointers to the root nodes of the expressions.
+ * @param count                 Number of expressions.
+ * @param patchable             1 to give every literal a slot of a constant pool.
+ * @return The program.
+ */
+static Program *compile_program(Node *const *abstract_syntax_trees, const size_t count, const int patchable) {
+    Program *program = malloc(sizeof(Program));
+    program->code = NULL;
+    program->length = 0;
+    program->capacity = 0;
+    program->results = malloc((count ? count : 1) * sizeof(size_t));
+    program->result_count = count;
+    program->recurrences = NULL;
+    program->ranges = NULL;
+    program->pool = patchable ? calloc(1, sizeof(ConstantPool)) : NULL;
+
+    Compilation compilation = {program, program->pool, 0, malloc(16 * sizeof(size_t)), 16};
+    for (size_t i = 0; i < compilation.table_size; i++) {
+        compilation.table[i] = EMPTY_ENTRY;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        compilation.expression = i;
+        program->results[i] = materialize(&compilation, compile_node(&compilation, abstract_syntax_trees[i]));
+    }
+    if (program->pool) {
+        program->pool->dirty = malloc(program->pool->fold_count ? program->pool->fold_count : 1);
+    }
+
+    free(compilation.table);
+    return program;
+}
+
+Program *compile_expressions(Node *const *abstract_syntax_trees, const size_t count) {
+    return compile_program(abstract_syntax_trees, count, 0);
+}
+
+Program *compile_patchable(Node *const *abstract_syntax_trees, const size_t count) {
+    return compile_program(abstract_syntax_trees, count, 1);
+}
+
+size_t patch_constant(Program *program, const size_t slot, const double value) {
+    ConstantPool *pool = program->pool;
+    size_t patched = 0;
+
+    pool->values[slot] = value;
+    for (size_t i = 0; i < pool->fold_count; i++) {
+        const Instruction *fold = &pool->folds[i];
+        if (fold->code == OP_CONST) {
+            pool->dirty[i] = (size_t) fold->parameter == slot;
+            if (pool->dirty[i]) pool->folded[i] = value;
+        } else {
+            pool->dirty[i] = pool->dirty[fold->left] || (operand_count(fold->code) == 2 && pool->dirty[fold->right]);
+            if (pool->dirty[i]) {
+                execute_instruction(fold, &pool->folded[i], &pool->folded[fold->left], &pool->folded[fold->right],
+                                    NULL, NULL, 1);
+            }
+        }
+        if (pool->dirty[i] && pool->holders[i] != NO_HOLDER) {
+            program->code[pool->holders[i]].value = pool->folded[i];
+            patched++;
+        }
+    }
+
+    // What was derived from the old constants no longer holds
+    for (size_t i = 0; i < program->length; i++) {
+        if (program->code[i].code == OP_SIN_NARROW) program->code[i].code = OP_SIN;
+        if (program->code[i].code == OP_COS_NARROW) program->code[i].code = OP_COS;
+    }
+    free(program->recurrences);
+    free(program->ranges);
+    program->recurrences = NULL;
+    program->ranges = NULL;
+    return patched;
+}
+
+void free_program(Program *program) {
+    if (program == NULL) return;
+    free(program->code);
+    free(program->results);
+    free(program->recurrences);
+    free(program->ranges);
+    if (program->pool) {
+        free(program->pool->values);
+        free(program->pool->spans);
+        free(program->pool->folds);
+        free(program->pool->folded);
+        free(program->pool->holders);
+        free(program->pool->dirty);
+        free(program->pool);
+    }
+    free(program);
+}
+
+int operand_count(const OpCode code) {
+    if (code == OP_CONST || code == OP_X || code == OP_PARAMETER) return 0;
+    if (code >= OP_ADD && code <= OP_POW) return 2;
+    return 1;
+}
+
+/**
+ * @brief pi split into the nearest double and the rest, so that pi - x is exact for x in [pi / 2, pi].
+ */
+#define PI_HIGH 3.141592653589793116
+#define PI_LOW 1.2246467991473531772e-16
+
+/**
+ * @brief pi / 2 split into the nearest double and the rest.
+ */
+#define HALF_PI_HIGH 1.5707963267948965580
+#define HALF_PI_LOW 6.1232339957367658860e-17
+
+/**
+ * @brief Evaluates sin on [-pi / 2, pi / 2] with its Taylor polynomial up to the term of degree 21.
+ *
+ * The first omitted term is below 1.2e-18 on the whole interval, so the error is dominated by the rounding
+ * of the Horner scheme. The result is clamped to [-1, 1], the range the analysis assumes for sin and cos,
+ * with comparisons rather than fmin and fmax, so that NaN is passed through.
+ *
+ * @param r The argument, inside [-pi / 2, pi / 2].
+ * @return sin(r).
+ */
+static double sin_kernel(const double r) {
+    const double r2 = r * r;
+    double p = -1.9572941063391263e-20;
+    p = p * r2 + 8.2206352466243300e-18;
+    p = p * r2 - 2.8114572543455206e-15;
+    p = p * r2 + 7.6471637318198164e-13;
+    p = p * r2 - 1.6059043836821613e-10;
+    p = p * r2 + 2.5052108385441720e-08;
+    p = p * r2 - 2.7557319223985893e-06;
+    p = p * r2 + 1.9841269841269841e-04;
+    p = p * r2 - 8.3333333333333332e-03;
+    p = p * r2 + 1.6666666666666666e-01;
+    const double value = r - r * r2 * p;
+    return value < -1.0 ? -1.0 : value > 1.0 ? 1.0 : value;
+}
+
+/**
+ * @brief Evaluates sin of an argument inside [-pi, pi] without range reduction and without branches.
+ *
+ * @param x The argument.
+ * @return sin(x).
+ */
+static double narrow_sin(const double x) {
+    const double a = fabs(x);
+    const double r = a > HALF_PI_HIGH ? (PI_HIGH - a) + PI_LOW : a;
+    return copysign(sin_kernel(r), x);
+}
+
+/**
+ * @brief Evaluates cos of an argument inside [-pi, pi] without range reduction and without branches.
+ *
+ * @param x The argument.
+ * @return cos(x), computed as sin(pi / 2 - |x|).
+ */
+static double narrow_cos(const double x) {
+    return sin_kernel((HALF_PI_HIGH - fabs(x)) + HALF_PI_LOW);
+}
+
+void execute_instruction(const Instruction *instruction, double *out, const double *left, const double *right,
+                         const double *xs, const double *parameters, const size_t count) {
+    size_t i;
+    switch (instruction->code) {
+        case OP_CONST:
+            for (i = 0; i < count; i++) out[i] = instruction->value;
+            break;
+        case OP_X:
+            memcpy(out, xs, count * sizeof(double));
+            break;
+        case OP_PARAMETER: {
+            const double value = parameters ? parameters[instruction->parameter] : 0.0;
+            for (i = 0; i < count; i++) out[i] = value;
+            break;
+        }
+        case OP_NEG: for (i = 0; i < count; i++) out[i] = -left[i]; break;
+        case OP_ADD: for (i = 0; i < count; i++) out[i] = left[i] + right[i]; break;
+        case OP_SUB: for (i = 0; i < count; i++) out[i] = left[i] - right[i]; break;
+        case OP_MUL: for (i = 0; i < count; i++) out[i] = left[i] * right[i]; break;
+        case OP_DIV: for (i = 0; i < count; i++) out[i] = left[i] / right[i]; break;
+        case OP_POW: for (i = 0; i < count; i++) out[i] = pow(left[i], right[i]); break;
+        case OP_SIN: for (i = 0; i < count; i++) out[i] = sin(left[i]); break;
+        case OP_COS: for (i = 0; i < count; i++) out[i] = cos(left[i]); break;
+        case OP_TAN: for (i = 0; i < count; i++) out[i] = tan(left[i]); break;
+        case OP_ABS: for (i = 0; i < count; i++) out[i] = fabs(left[i]); break;
+        case OP_LN: for (i = 0; i < count; i++) out[i] = log(left[i]); break;
+        case OP_LOG: for (i = 0; i < count; i++) out[i] = log10(left[i]); break;
+        case OP_ASIN: for (i = 0; i < count; i++) out[i] = asin(left[i]); break;
+        case OP_ACOS: for (i = 0; i < count; i++) out[i] = acos(left[i]); break;
+        case OP_ATAN: for (i = 0; i < count; i++) out[i] = atan(left[i]); break;
+        case OP_SINH: for (i = 0; i < count; i++) out[i] = sinh(left[i]); break;
+        case OP_COSH: for (i = 0; i < count; i++) out[i] = cosh(left[i]); break;
+        case OP_TANH: for (i = 0; i < count; i++) out[i] = tanh(left[i]); break;
+        case OP_EXP: for (i = 0; i < count; i++) out[i] = exp(left[i]); break;
+        case OP_SIN_NARROW: for (i = 0; i < count; i++) out[i] = narrow_sin(left[i]); break;
+        case OP_COS_NARROW: for (i = 0; i < count; i++) out[i] = narrow_cos(left[i]); break;
+    }
+}
+
+/**
+ * @brief Affine form `slope * x + intercept` of an instruction with constant coefficients.
+ */
+typedef struct Affine {
+    int affine; /**< 1 if the instruction is affine in 'x' (constants included) */
+    double slope; /**< Factor of 'x' */
+    double intercept; /**< Constant term */
+    double error_slope; /**< Rounding error of the computed value is at most error_slope * |x| + error_intercept */
+    double error_intercept; /**< See error_slope */
+} Affine;
+
+/**
+ * @brief Creates the affine form of an operation result and adds the rounding of the operation to its error.
+ *
+ * @param slope The factor of 'x' of the result.
+ * @param intercept The constant term of the result.
+ * @param error_slope The error propagated from the operands, factor of |x|.
+ * @param error_intercept The error propagated from the operands, constant term.
+ * @return The affine form.
+ */
+static Affine rounded_affine(const double slope, const double intercept, const double error_slope,
+                             const double error_intercept) {
+    return (Affine){1, slope, intercept, error_slope + DBL_EPSILON * fabs(slope),
+                    error_intercept + DBL_EPSILON * fabs(intercept)};
+}
+
+size_t enable_recurrences(Program *program, const double step) {
+    Affine *forms = calloc(program->length ? program->length : 1, sizeof(Affine));
+    size_t recurrent = 0;
+
+    free(program->recurrences);
+    free(program->ranges);
+    program->recurrences = calloc(program->length ? program->length : 1, sizeof(Recurrence));
+
+    for (size_t i = 0; i < program->length; i++) {
+        const Instruction *instruction = &program->code[i];
+        const Affine left = forms[instruction->left];
+        const Affine right = forms[instruction->right];
+        Affine form = {0, 0.0, 0.0, 0.0, 0.0};
+
+        switch (instruction->code) {
+            case OP_CONST: form = (Affine){1, 0.0, instruction->value, 0.0, 0.0}; break;
+            case OP_X: form = (Affine){1, 1.0, 0.0, 0.0, 0.0}; break;
+            case OP_NEG:
+                if (left.affine) form = (Affine){1, -left.slope, -left.intercept, left.error_slope, left.error_intercept};
+                break;
+            case OP_ADD:
+            case OP_SUB:
+                if (left.affine && right.affine) {
+                    const double sign = instruction->code == OP_ADD ? 1.0 : -1.0;
+                    form = rounded_affine(left.slope + sign * right.slope, left.intercept + sign * right.intercept,
+                                          left.error_slope + right.error_slope,
+                                          left.error_intercept + right.error_intercept);
+                }
+                break;
+            case OP_MUL:
+                if (left.affine && right.affine && (left.slope == 0.0 || right.slope == 0.0)) {
+                    const Affine factor = left.slope == 0.0 ? left : right;
+                    const Affine other = left.slope == 0.0 ? right : left;
+                    const double c = fabs(factor.intercept);
+                    form = rounded_affine(other.slope * factor.intercept, other.intercept * factor.intercept,
+                                          c * other.error_slope, c * other.error_intercept);
+                }
+                break;
+            case OP_DIV:
+                if (left.affine && right.affine && right.slope == 0.0 && right.intercept != 0.0) {
+                    const double c = fabs(right.intercept);
+                    form = rounded_affine(left.slope / right.intercept, left.intercept / right.intercept,
+                                          left.error_slope / c, left.error_intercept / c);
+                }
+                break;
+            case OP_SIN:
+            case OP_COS:
+            case OP_EXP:
+                if (left.affine && left.slope != 0.0 && isfinite(left.slope) && isfinite(left.intercept)) {
+                    Recurrence *recurrence = &program->recurrences[i];
+                    recurrence->slope = left.slope;
+                    recurrence->error_slope = left.error_slope;
+                    recurrence->error_intercept = left.error_intercept;
+                    if (instruction->code == OP_EXP) {
+                        recurrence->kind = RECURRENCE_GROWTH;
+                        recurrence->ratio = exp(left.slope * step);
+                    } else {
+                        recurrence->kind = RECURRENCE_ROTATION;
+                        recurrence->sin_step = sin(left.slope * step);
+                        recurrence->cos_step = cos(left.slope * step);
+                    }
+                    recurrent++;
+                }
+                break;
+            default:
+                break;
+        }
+        forms[i] = form;
+    }
+
+    free(forms);
+    return recurrent;
+}
+
+double recurrence_drift_bound(const Recurrence *recurrence, const double step, const double max_abs_x) {
+    // Spacing of doubles around the largest x, every addition of the grid rounds by half of it
+    const double grid_ulp = nextafter(max_abs_x, INFINITY) - max_abs_x;
+    const double per_step = 4.0 * DBL_EPSILON + fabs(recurrence->slope) * (grid_ulp + fabs(step) * DBL_EPSILON);
+    const double argument = recurrence->error_slope * max_abs_x + recurrence->error_intercept;
+    if (recurrence->kind == RECURRENCE_NONE) return 0.0;
+    return RECURRENCE_RESYNC_PERIOD * per_step + 2.0 * argument;
+}
+
+/**
+ * @brief Evaluates a recurrent instruction over a block of consecutive grid points.
+ *
+ * @param instruction The instruction, OP_SIN, OP_COS or OP_EXP.
+ * @param recurrence  Its recurrence.
+ * @param out         Output array of `count` values.
+ * @param left        Values of the argument, only read at the resynchronisation points.
+ * @param count       Number of samples.
+ */
+static void execute_recurrence(const Instruction *instruction, const Recurrence *recurrence, double *out,
+                               const double *left, const size_t count) {
+    for (size_t start = 0; start < count; start += RECURRENCE_RESYNC_PERIOD) {
+        const size_t end = count - start < RECURRENCE_RESYNC_PERIOD ? count : start + RECURRENCE_RESYNC_PERIOD;
+
+        if (recurrence->kind == RECURRENCE_GROWTH) {
+            double value = exp(left[start]);
+            out[start] = value;
+            for (size_t i = start + 1; i < end; i++) {
+                // Subnormal and overflowing values lose the relative bound, so those samples fall back to libm
+                value = value >= DBL_MIN ? value * recurrence->ratio : exp(left[i]);
+                if (!(value <= DBL_MAX)) value = exp(left[i]);
+                out[i] = value;
+            }
+            continue;
+        }
+
+        double sine = sin(left[start]);
+        double cosine = cos(left[start]);
+        double *values = instruction->code == OP_SIN ? &sine : &cosine;
+        out[start] = *values;
+        for (size_t i = start + 1; i < end; i++) {
+            const double next_sine = sine * recurrence->cos_step + cosine * recurrence->sin_step;
+            cosine = cosine * recurrence->cos_step - sine * recurrence->sin_step;
+            sine = next_sine;
+            out[i] = *values;
+        }
+    }
+}
+
+void execute_block(const Program *program, const double *xs, const size_t count, const double *parameters,
+                   double *registers, double *const *ys) {
+    for (size_t i = 0; i < program->length; i++) {
+        const Instruction *instruction = &program->code[i];
+        if (program->recurrences && program->recurrences[i].kind != RECURRENCE_NONE) {
+            execute_recurrence(instruction, &program->recurrences[i], registers + i * count,
+                               registers + instruction->left * count, count);
+            continue;
+        }
+        execute_instruction(instruction, registers + i * count, registers + instruction->left * count,
+                            registers + instruction->right * count, xs, parameters, count);
+    }
+    for (size_t i = 0; i < program->result_count; i++) {
+        memcpy(ys[i], registers + program->results[i] * count, count * sizeof(double));
+    }
+}
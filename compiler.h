@@ -0,0 +1,290 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "parser.h"
+
+/**
+ * @brief Dependency flags of a compiled instruction.
+ *
+ * Every instruction records whether its value depends on 'x', on the named parameters, on both or on
+ * neither. Instructions depending on neither are folded into constants during compilation.
+ */
+#define DEPENDS_ON_X 1
+#define DEPENDS_ON_PARAMETERS 2
+#define DEPENDS_ON_BOTH (DEPENDS_ON_X | DEPENDS_ON_PARAMETERS)
+
+/**
+ * @brief Operation codes of the compiled program.
+ *
+ * Each operator and each function supported by the evaluator has its own code, so the function name
+ * is resolved once at compile time instead of being compared for every sample.
+ */
+typedef enum OpCode {
+    OP_CONST, /**< Numeric constant stored in the instruction */
+    OP_X, /**< The independent variable 'x' */
+    OP_PARAMETER, /**< One of the named parameters */
+    OP_NEG, /**< Unary minus */
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_POW,
+    OP_SIN,
+    OP_COS,
+    OP_TAN,
+    OP_ABS,
+    OP_LN,
+    OP_LOG,
+    OP_ASIN,
+    OP_ACOS,
+    OP_ATAN,
+    OP_SINH,
+    OP_COSH,
+    OP_TANH,
+    OP_EXP,
+    OP_SIN_NARROW, /**< sin of an argument proven inside [-pi, pi], evaluated without range reduction */
+    OP_COS_NARROW /**< cos of an argument proven inside [-pi, pi], evaluated without range reduction */
+} OpCode;
+
+/**
+ * @brief A single instruction of a compiled program.
+ *
+ * Instructions are stored in evaluation order and every instruction writes its own slot, so operands
+ * are referenced by the index of the instruction that produced them.
+ */
+typedef struct Instruction {
+    OpCode code; /**< Operation performed by the instruction */
+    int dependency; /**< Combination of DEPENDS_ON_X and DEPENDS_ON_PARAMETERS */
+    size_t left; /**< Slot of the first operand (the argument of unary operations and functions) */
+    size_t right; /**< Slot of the second operand of binary operations */
+    double value; /**< Value of an OP_CONST instruction */
+    int parameter; /**< Parameter index of an OP_PARAMETER instruction, the fold of an OP_CONST instruction of a
+                        patchable program, -1 otherwise */
+} Instruction;
+
+/**
+ * @brief Number of samples a recurrence is advanced before it is resynchronised with libm.
+ *
+ * Together with `recurrence_drift_bound()` this bounds the error of the incremental evaluation.
+ */
+#define RECURRENCE_RESYNC_PERIOD 32
+
+/**
+ * @brief Kind of the incremental evaluation of an instruction along a uniform grid.
+ */
+typedef enum RecurrenceKind {
+    RECURRENCE_NONE, /**< Evaluated with libm for every sample */
+    RECURRENCE_ROTATION, /**< sin or cos of an affine argument, advanced by rotating (sin, cos) by a fixed angle */
+    RECURRENCE_GROWTH /**< exp of an affine argument, advanced by multiplying with a fixed ratio */
+} RecurrenceKind;
+
+/**
+ * @brief Incremental evaluation of one instruction whose argument is `slope * x + intercept`.
+ *
+ * From one grid point to the next the argument grows by `slope * step`, so the value can be advanced with
+ * one or two multiplications instead of a call to libm.
+ */
+typedef struct Recurrence {
+    RecurrenceKind kind; /**< How the instruction is advanced */
+    double slope; /**< Factor of 'x' in the argument */
+    double error_slope; /**< Rounding error of the computed argument is at most error_slope * |x| + error_intercept */
+    double error_intercept; /**< See error_slope */
+    double sin_step; /**< sin(slope * step) for rotations */
+    double cos_step; /**< cos(slope * step) for rotations */
+    double ratio; /**< exp(slope * step) for growths */
+} Recurrence;
+
+/**
+ * @brief Closed interval containing every value an instruction takes over a grid.
+ *
+ * Infinite bounds are allowed. NaN is never part of the interval, `nan` records whether it may occur.
+ */
+typedef struct Interval {
+    double lo; /**< Lower bound */
+    double hi; /**< Upper bound */
+    int nan; /**< 1 if the value may be NaN */
+} Interval;
+
+/**
+ * @brief Position of a numeric literal in the source text.
+ */
+typedef struct ConstantSpan {
+    size_t expression; /**< The expression containing the literal */
+    size_t start; /**< Offset of the first character of the literal */
+    size_t end; /**< Offset one past the last character of the literal */
+} ConstantSpan;
+
+/**
+ * @brief Patchable numeric literals of a program and the constants folded from them.
+ *
+ * Every literal of the source gets its own slot, numbered in the order the literals are compiled, which is
+ * the order they appear in within every expression. Every folded constant is recorded as a fold: a literal
+ * (OP_CONST with the slot in `parameter`) or an operation on earlier folds. Patching a slot recomputes only
+ * the folds depending on it, exactly as the compiler computed them, and updates the instructions holding them.
+ */
+typedef struct ConstantPool {
+    double *values; /**< Per slot: the current value of the literal */
+    ConstantSpan *spans; /**< Per slot: the position of the literal in the source */
+    size_t count; /**< Number of slots */
+    Instruction *folds; /**< The folds in evaluation order, operands refer to earlier folds */
+    double *folded; /**< Per fold: its current value */
+    size_t *holders; /**< Per fold: the instruction holding its value, (size_t) -1 if none */
+    unsigned char *dirty; /**< Per fold: scratch flags of `patch_constant()` */
+    size_t fold_count; /**< Number of folds */
+    size_t slot_capacity; /**< Allocated number of slots */
+    size_t fold_capacity; /**< Allocated number of folds */
+} ConstantPool;
+
+/**
+ * @brief A compiled group of expressions.
+ *
+ * The program is a flat list of instructions produced from the abstract syntax trees by a post-order walk.
+ * Constant subtrees are folded during compilation, so every remaining instruction depends on 'x',
+ * on the parameters or on both, except for the constants used as operands. Identical subexpressions are
+ * compiled only once, even across expressions, so the program is a DAG shared by all of its results.
+ */
+typedef struct Program {
+    Instruction *code; /**< The instructions in evaluation order */
+    size_t length; /**< Number of instructions */
+    size_t capacity; /**< Allocated number of instructions */
+    size_t *results; /**< Per expression: the slot holding the value of the whole expression */
+    size_t result_count; /**< Number of compiled expressions */
+    Recurrence *recurrences; /**< Per instruction: its incremental evaluation, NULL unless `enable_recurrences()` was called */
+    Interval *ranges; /**< Per instruction: its proven range, NULL unless `specialise_ranges()` was called */
+    ConstantPool *pool; /**< The patchable literals, NULL unless compiled with `compile_patchable()` */
+} Program;
+
+/**
+ * @brief Compiles an abstract syntax tree into a flat program.
+ *
+ * Function names are resolved to operation codes, constant subtrees are folded, and every instruction is
+ * classified as x-only, parameter-only or mixed through its dependency flags.
+ *
+ * @param abstract_syntax_tree Pointer to the root node of the expression.
+ * @return A pointer to the newly allocated program with a single result. The caller frees it with `free_program()`.
+ *
+ * @note Exits the program with an error if the tree contains an unknown function, operator or node.
+ */
+Program *compile(const Node *abstract_syntax_tree);
+
+/**
+ * @brief Compiles several abstract syntax trees into one fused program.
+ *
+ * Works like `compile()`, but all expressions share one instruction list. Subexpressions that occur in
+ * more than one place, such as `sin(x)` in `sin(x)` and `2*sin(x)`, are evaluated once per sample for
+ * all results.
+ *
+ * @param abstract_syntax_trees Array of pointers to the root nodes of the expressions.
+ * @param count                 Number of expressions.
+ * @return A pointer to the newly allocated program with `count` results. The caller frees it with `free_program()`.
+ *
+ * @note Exits the program with an error if a tree contains an unknown function, operator or node.
+ */
+Program *compile_expressions(Node *const *abstract_syntax_trees, size_t count);
+
+/**
+ * @brief Compiles several abstract syntax trees into one fused program with patchable literals.
+ *
+ * Works like `compile_expressions()`, but every numeric literal gets a slot of the constant pool of the program,
+ * so its value can be changed with `patch_constant()` without parsing and compiling again. Literals with equal
+ * values in different places stay separate instructions, so that each can be patched on its own.
+ *
+ * @param abstract_syntax_trees Array of pointers to the root nodes of the expressions.
+ * @param count                 Number of expressions.
+ * @return A pointer to the newly allocated program with `count` results. The caller frees it with `free_program()`.
+ *
+ * @note Exits the program with an error if a tree contains an unknown function, operator or node.
+ */
+Program *compile_patchable(Node *const *abstract_syntax_trees, size_t count);
+
+/**
+ * @brief Changes the value of a literal of a program compiled with `compile_patchable()`.
+ *
+ * Only the folded constants depending on the slot are recomputed. The program evaluates exactly like a program
+ * compiled from the source with the new literal. Recurrences and proven ranges depend on the constants, so they
+ * are dropped and the narrow kernels are switched back to sin and cos; call `enable_recurrences()` and
+ * `specialise_ranges()` again if they are wanted.
+ *
+ * @param program The program.
+ * @param slot    The slot of the literal, below `program->pool->count`.
+ * @param value   The new value.
+ * @return The number of instructions whose constant changed.
+ */
+size_t patch_constant(Program *program, size_t slot, double value);
+
+/**
+ * @brief Recognises instructions that can be evaluated incrementally along a uniform grid.
+ *
+ * `sin`, `cos` and `exp` of an argument that is affine in 'x' with constant coefficients, such as `sin(3*x+1)`,
+ * are evaluated with a recurrence by `execute_block()` instead of calling libm for every sample. The recurrence
+ * is seeded with libm at the first sample of every block and every RECURRENCE_RESYNC_PERIOD samples after it,
+ * so the error stays within `recurrence_drift_bound()`.
+ *
+ * After this call the program must only be executed on consecutive points of a grid with the given step.
+ *
+ * @param program The compiled program.
+ * @param step    The distance of consecutive x values of the grid.
+ * @return The number of instructions that are evaluated incrementally.
+ */
+size_t enable_recurrences(Program *program, double step);
+
+/**
+ * @brief Returns the largest error a recurrence may add to its value between two resynchronisations.
+ *
+ * The bound covers the rounding of every rotation or multiplication, the rounding of the step of the argument,
+ * the deviation of the grid from exact multiples of the step, because the grid is produced by repeated
+ * addition, and the rounding of the argument at the resynchronisation point and at the sample.
+ * For a rotation it is an absolute error of sin and cos, for a growth a relative error of exp.
+ *
+ * @param recurrence The recurrence.
+ * @param step       The step of the grid.
+ * @param max_abs_x  The largest absolute x value of the grid.
+ * @return The bound of the error.
+ */
+double recurrence_drift_bound(const Recurrence *recurrence, double step, double max_abs_x);
+
+/**
+ * @brief Frees a program created by `compile()`.
+ *
+ * @param program A pointer to the program to be freed. NULL is ignored.
+ */
+void free_program(Program *program);
+
+/**
+ * @brief Returns the number of operands an operation code takes.
+ *
+ * @param code The operation code.
+ * @return 0 for constants, 'x' and parameters, 2 for binary operators and 1 for everything else.
+ */
+int operand_count(OpCode code);
+
+/**
+ * @brief Executes one instruction over an array of samples.
+ *
+ * @param instruction The instruction to be executed.
+ * @param out         Output array of `count` values.
+ * @param left        Values of the first operand (unused by operations without operands).
+ * @param right       Values of the second operand (used by binary operations only).
+ * @param xs          Values of 'x' (used by OP_X only).
+ * @param parameters  Array of PARAMETER_COUNT parameter values, or NULL to treat every parameter as 0.
+ * @param count       Number of samples.
+ */
+void execute_instruction(const Instruction *instruction, double *out, const double *left, const double *right,
+                         const double *xs, const double *parameters, size_t count);
+
+/**
+ * @brief Evaluates the whole program for a block of x values.
+ *
+ * @param program    The compiled program.
+ * @param xs         The x values of the block.
+ * @param count      Number of x values.
+ * @param parameters Array of PARAMETER_COUNT parameter values, or NULL to treat every parameter as 0.
+ * @param registers  Scratch memory for at least `program->length * count` values.
+ * @param ys         Per result: output array for the `count` values of the expression.
+ *
+ * @note With `enable_recurrences()`, `xs` must be consecutive points of the grid the recurrences were set up for.
+ */
+void execute_block(const Program *program, const double *xs, size_t count, const double *parameters,
+                   double *registers, double *const *ys);
+
+#endif //COMPILER_H
@@ -0,0 +1,228 @@
+#include <math.h>
+#include <stdlib.h>
+#include "curve_index.h"
+#include "draw_utils.h"
+
+/**
+ * @brief Left edge of the plot area on the page.
+ */
+#define PLOT_LEFT (PAGE_MARGIN / 2)
+
+/**
+ * @brief Translation of the x-axis on the page, as written by `prepare_page()`.
+ */
+static double translate_x(const CurveIndex *index) {
+    return PAGE_WIDTH / 2 - index->scale_x * (index->limits.x_max + index->limits.x_min) / 2;
+}
+
+/**
+ * @brief Translation of the y-axis on the page, as written by `prepare_page()`.
+ */
+static double translate_y(const CurveIndex *index) {
+    return PAGE_HEIGHT / 2 - index->scale_y * (index->limits.y_max + index->limits.y_min) / 2;
+}
+
+/**
+ * @brief Returns the column of a page x coordinate, clamped to the columns of the index.
+ */
+static size_t column_of(const CurveIndex *index, const double page_x) {
+    const double column = floor((page_x - PLOT_LEFT) / INDEX_COLUMN_WIDTH);
+    if (!(column > 0.0)) return 0; // Also NaN
+    return column < (double) index->column_count ? (size_t) column : index->column_count - 1;
+}
+
+/**
+ * @brief Allocates the memory of an index for a number of curves and samples per curve.
+ */
+static void reserve_curve_index(CurveIndex *index, const size_t result_count, const size_t capacity) {
+    const size_t sample_count = result_count * capacity;
+
+    index->column_count = (size_t) ceil((PAGE_WIDTH - PAGE_MARGIN) / INDEX_COLUMN_WIDTH);
+    index->page_xs = malloc((capacity ? capacity : 1) * sizeof(float));
+    index->page_ys = malloc((sample_count ? sample_count : 1) * sizeof(float));
+    index->column_first = malloc((index->column_count + 1) * sizeof(size_t));
+    index->column_lo = malloc((result_count ? result_count : 1) * index->column_count * sizeof(float));
+    index->column_hi = malloc((result_count ? result_count : 1) * index->column_count * sizeof(float));
+    index->reserved_results = result_count;
+    index->reserved_capacity = capacity;
+}
+
+/**
+ * @brief Empties an index with enough memory for the curves of a page.
+ */
+static void reset_curve_index(CurveIndex *index, const Limits *limits, const double scale_x, const double scale_y,
+                              const size_t result_count, const size_t capacity) {
+    index->limits = *limits;
+    index->scale_x = scale_x;
+    index->scale_y = scale_y;
+    index->result_count = result_count;
+    index->capacity = capacity;
+    index->count = 0;
+    index->column_first[0] = 0;
+    index->last_column = 0;
+    for (size_t i = 0; i < result_count * index->column_count; i++) {
+        index->column_lo[i] = INFINITY;
+        index->column_hi[i] = -INFINITY;
+    }
+}
+
+void initialize_curve_index(CurveIndex *index, const Limits *limits, const double scale_x, const double scale_y,
+                            const size_t result_count, const size_t capacity) {
+    reserve_curve_index(index, result_count, capacity);
+    reset_curve_index(index, limits, scale_x, scale_y, result_count, capacity);
+}
+
+void reuse_curve_index(CurveIndex *index, const Limits *limits, const double scale_x, const double scale_y,
+                       const size_t result_count, const size_t capacity) {
+    if (!index->page_xs || result_count > index->reserved_results || capacity > index->reserved_capacity) {
+        const size_t results = result_count > index->reserved_results ? result_count : index->reserved_results;
+        const size_t samples = capacity > index->reserved_capacity ? capacity : index->reserved_capacity;
+        free_curve_index(index);
+        reserve_curve_index(index, results, samples);
+    }
+    reset_curve_index(index, limits, scale_x, scale_y, result_count, capacity);
+}
+
+void index_samples(CurveIndex *index, const double *xs, double *const *ys, const size_t count) {
+    const double offset_x = translate_x(index);
+    const double offset_y = translate_y(index);
+    const size_t columns = index->column_count;
+
+    for (size_t i = 0; i < count && index->count < index->capacity; i++) {
+        const size_t sample = index->count++;
+        const double page_x = xs[i] * index->scale_x + offset_x;
+        const size_t column = column_of(index, page_x);
+        while (index->last_column < column) {
+            index->column_first[++index->last_column] = sample;
+        }
+        index->page_xs[sample] = (float) page_x;
+
+        for (size_t r = 0; r < index->result_count; r++) {
+            const double y = ys[r][i];
+            float *page_y = &index->page_ys[r * index->capacity + sample];
+            if (!(y >= index->limits.y_min && y <= index->limits.y_max)) {
+                *page_y = NAN;
+                continue;
+            }
+            *page_y = (float) (y * index->scale_y + offset_y);
+            float *lo = &index->column_lo[r * columns + column];
+            float *hi = &index->column_hi[r * columns + column];
+            *lo = *page_y < *lo ? *page_y : *lo;
+            *hi = *page_y > *hi ? *page_y : *hi;
+        }
+    }
+}
+
+void finish_curve_index(CurveIndex *index) {
+    while (index->last_column < index->column_count) {
+        index->column_first[++index->last_column] = index->count;
+    }
+}
+
+int curve_value_at(const CurveIndex *index, const size_t result, const double page_x, double *y) {
+    const float *page_xs = index->page_xs;
+    const float *page_ys = index->page_ys + result * index->capacity;
+
+    // First sample right of page_x, starting in its column
+    size_t right = index->column_first[column_of(index, page_x)];
+    while (right < index->count && page_xs[right] <= page_x) right++;
+    while (right > 0 && page_xs[right - 1] > page_x) right--;
+    if (right == 0) {
+        return 1; // Left of the curve
+    }
+
+    const size_t left = right - 1;
+    double page_y;
+    if (page_xs[left] == page_x && !isnan(page_ys[left])) {
+        page_y = page_ys[left];
+    } else if (right < index->count && !isnan(page_ys[left]) && !isnan(page_ys[right])) {
+        const double t = (page_x - page_xs[left]) / (page_xs[right] - page_xs[left]);
+        page_y = page_ys[left] + t * (page_ys[right] - page_ys[left]);
+    } else {
+        return 1; // Right of the curve or in a gap
+    }
+    *y = (page_y - translate_y(index)) / index->scale_y;
+    return 0;
+}
+
+/**
+ * @brief Looks for samples of a column nearer to a point than the best one found so far.
+ *
+ * @return 1 if the column could hold a nearer sample, 0 if its horizontal distance rules it out.
+ */
+static int search_column(const CurveIndex *index, const size_t column, const double page_x, const double page_y,
+                         IndexHit *best, size_t *best_sample) {
+    const size_t first = index->column_first[column];
+    const size_t end = index->column_first[column + 1];
+
+    // The samples bound the column, the drawn part only if it has none
+    const double left = first < end ? index->page_xs[first] : PLOT_LEFT + (double) column * INDEX_COLUMN_WIDTH;
+    const double right = first < end ? index->page_xs[end - 1] : left + INDEX_COLUMN_WIDTH;
+    const double dx = page_x < left ? left - page_x : page_x > right ? page_x - right : 0.0;
+    if (dx >= best->distance) {
+        return 0;
+    }
+
+    for (size_t r = 0; r < index->result_count; r++) {
+        const double lo = index->column_lo[r * index->column_count + column];
+        const double hi = index->column_hi[r * index->column_count + column];
+        const double dy = page_y < lo ? lo - page_y : page_y > hi ? page_y - hi : 0.0;
+        if (lo > hi || hypot(dx, dy) >= best->distance) {
+            continue; // Nothing drawn or too far away
+        }
+
+        const float *page_ys = index->page_ys + r * index->capacity;
+        for (size_t i = first; i < end; i++) {
+            const double distance = hypot(index->page_xs[i] - page_x, page_ys[i] - page_y);
+            if (distance < best->distance) { // False for NaN
+                best->distance = distance;
+                best->result = r;
+                *best_sample = i;
+            }
+        }
+    }
+    return 1;
+}
+
+int nearest_curve_point(const CurveIndex *index, const double page_x, const double page_y, IndexHit *hit) {
+    const size_t start = column_of(index, page_x);
+    IndexHit best = {0, 0.0, 0.0, INFINITY};
+    size_t best_sample = 0;
+
+    // Columns in the order of their distance, until neither side can hold a nearer sample
+    for (size_t k = 0; k < index->column_count; k++) {
+        int searched = 0;
+        if (k <= start) {
+            searched |= search_column(index, start - k, page_x, page_y, &best, &best_sample);
+        }
+        if (k > 0 && start + k < index->column_count) {
+            searched |= search_column(index, start + k, page_x, page_y, &best, &best_sample);
+        }
+        if (!searched) {
+            break;
+        }
+    }
+    if (isinf(best.distance)) {
+        return 1;
+    }
+
+    best.x = (index->page_xs[best_sample] - translate_x(index)) / index->scale_x;
+    best.y = (index->page_ys[best.result * index->capacity + best_sample] - translate_y(index)) / index->scale_y;
+    *hit = best;
+    return 0;
+}
+
+void free_curve_index(CurveIndex *index) {
+    free(index->page_xs);
+    free(index->page_ys);
+    free(index->column_first);
+    free(index->column_lo);
+    free(index->column_hi);
+    index->page_xs = NULL;
+    index->page_ys = NULL;
+    index->column_first = NULL;
+    index->column_lo = NULL;
+    index->column_hi = NULL;
+    index->reserved_results = 0;
+    index->reserved_capacity = 0;
+}
@@ -0,0 +1,149 @@
+#ifndef CURVE_INDEX_H
+#define CURVE_INDEX_H
+
+#include <stddef.h>
+#include "limits.h"
+
+/**
+ * @brief Width of a column of the index in page units.
+ */
+#define INDEX_COLUMN_WIDTH 1.0
+
+/**
+ * @brief Spatial index over the rendered curves of a page, for hover and value queries.
+ *
+ * The samples are kept in page coordinates, the coordinates of the PostScript page with its origin in the
+ * lower left corner, as single precision floats. The plot area is cut into columns of INDEX_COLUMN_WIDTH, and
+ * every column holds the range of its samples and, per curve, the lowest and highest drawn y value. Queries
+ * locate their column directly and only look at the samples of columns whose bounds can beat the best answer,
+ * so nothing is evaluated again.
+ *
+ * @struct CurveIndex
+ * @member limits The limits of the page.
+ * @member scale_x The scaling factor for the x-axis.
+ * @member scale_y The scaling factor for the y-axis.
+ * @member result_count The number of curves.
+ * @member capacity The maximum number of samples per curve.
+ * @member count The number of samples indexed so far.
+ * @member page_xs The page x coordinate of every sample.
+ * @member page_ys Per curve: `capacity` page y coordinates, NaN where the curve is not drawn.
+ * @member column_count The number of columns.
+ * @member column_first Per column and one past the last: the first sample of the column.
+ * @member column_lo Per curve and column: the lowest drawn page y, +infinity if none is drawn.
+ * @member column_hi Per curve and column: the highest drawn page y, -infinity if none is drawn.
+ * @member last_column The column of the last indexed sample.
+ * @member reserved_results The number of curves the memory of the index is allocated for.
+ * @member reserved_capacity The number of samples per curve the memory of the index is allocated for.
+ */
+typedef struct CurveIndex {
+    Limits limits;
+    double scale_x;
+    double scale_y;
+    size_t result_count;
+    size_t capacity;
+    size_t count;
+    float *page_xs;
+    float *page_ys;
+    size_t column_count;
+    size_t *column_first;
+    float *column_lo;
+    float *column_hi;
+    size_t last_column;
+    size_t reserved_results;
+    size_t reserved_capacity;
+} CurveIndex;
+
+/**
+ * @brief The drawn sample nearest to a point of the page.
+ *
+ * @struct IndexHit
+ * @member result The curve of the sample.
+ * @member x The x value of the sample.
+ * @member y The y value of the sample.
+ * @member distance The distance to the point in page units.
+ */
+typedef struct IndexHit {
+    size_t result;
+    double x;
+    double y;
+    double distance;
+} IndexHit;
+
+/**
+ * @brief Prepares an empty index for the curves of a page.
+ *
+ * @param index        The index, freed with `free_curve_index()`.
+ * @param limits       The limits of the page.
+ * @param scale_x      The scaling factor for the x-axis.
+ * @param scale_y      The scaling factor for the y-axis.
+ * @param result_count The number of curves.
+ * @param capacity     The maximum number of samples per curve.
+ */
+void initialize_curve_index(CurveIndex *index, const Limits *limits, double scale_x, double scale_y,
+                            size_t result_count, size_t capacity);
+
+/**
+ * @brief Prepares an index for the curves of another page, keeping its memory if it is large enough.
+ *
+ * Otherwise the memory is allocated again, large enough for this page and every page it held before, so an
+ * index reused for similar pages stops allocating.
+ *
+ * @param index        The index, prepared with `initialize_curve_index()` before or zeroed.
+ * @param limits       The limits of the page.
+ * @param scale_x      The scaling factor for the x-axis.
+ * @param scale_y      The scaling factor for the y-axis.
+ * @param result_count The number of curves.
+ * @param capacity     The maximum number of samples per curve.
+ */
+void reuse_curve_index(CurveIndex *index, const Limits *limits, double scale_x, double scale_y,
+                       size_t result_count, size_t capacity);
+
+/**
+ * @brief Adds the next samples of the grid, meant to be called with every block of the sampling pass.
+ *
+ * A sample is drawn if its value lies within the y limits, like in `classify_samples()`.
+ *
+ * @param index The index.
+ * @param xs    The x values, ascending and following the samples indexed so far.
+ * @param ys    Per curve: the values at `xs`.
+ * @param count The number of samples.
+ */
+void index_samples(CurveIndex *index, const double *xs, double *const *ys, size_t count);
+
+/**
+ * @brief Closes the columns after the last indexed sample, once the sampling pass is complete.
+ *
+ * @param index The index.
+ */
+void finish_curve_index(CurveIndex *index);
+
+/**
+ * @brief Finds the value of a curve at a page x coordinate, interpolated like the drawn line.
+ *
+ * @param index  The finished index.
+ * @param result The curve.
+ * @param page_x The page x coordinate.
+ * @param y      Set to the y value.
+ * @return 0 if the curve is drawn at `page_x`, 1 otherwise.
+ */
+int curve_value_at(const CurveIndex *index, size_t result, double page_x, double *y);
+
+/**
+ * @brief Finds the drawn sample of any curve nearest to a point of the page.
+ *
+ * @param index  The finished index.
+ * @param page_x The page x coordinate of the point.
+ * @param page_y The page y coordinate of the point.
+ * @param hit    Set to the nearest sample.
+ * @return 0 if a sample was found, 1 if no curve is drawn.
+ */
+int nearest_curve_point(const CurveIndex *index, double page_x, double page_y, IndexHit *hit);
+
+/**
+ * @brief Frees the arrays of an index.
+ *
+ * @param index The index.
+ */
+void free_curve_index(CurveIndex *index);
+
+#endif //CURVE_INDEX_H
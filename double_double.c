@@ -0,0 +1,612 @@
+#include <float.h>
+#include <stdint.h>
+#include "double_double.h"
+
+/**
+ * @brief 2^27 + 1, splits a double into two halves of 26 bits whose products are exact.
+ */
+#define SPLITTER 134217729.0
+
+/**
+ * @brief Largest magnitude that can be split without overflowing.
+ */
+#define SPLIT_LIMIT 6.69692879491417e+299
+
+/**
+ * @brief Number of halvings of the reduced argument of exp before its Taylor series is summed.
+ */
+#define EXP_HALVINGS 9
+
+/**
+ * @brief Power of two subnormal arguments of the logarithm are scaled by, which makes them normal.
+ */
+#define SUBNORMAL_LOG_SCALING 256
+
+/**
+ * @brief Magnitude of dividends below which the division is carried out on the dividend times 2^DIVISION_SCALING.
+ */
+#define DIVISION_SCALING_LIMIT 0x1p-900
+
+/**
+ * @brief Power of two small dividends are scaled by, which brings every subnormal above DIVISION_SCALING_LIMIT.
+ */
+#define DIVISION_SCALING 600
+
+/**
+ * @brief Largest magnitude for which sinh and tanh are summed as a Taylor series.
+ */
+#define HYPERBOLIC_SERIES_LIMIT 0.5
+
+/**
+ * @brief Magnitude above which exp(-|a|) is below the precision of sinh and cosh, which are then exp(|a|) / 2.
+ */
+#define HYPERBOLIC_EXP_LIMIT 40.0
+
+/**
+ * @brief 1/n! for n = 2 .. 30, rounded to double-double.
+ */
+static const DoubleDouble INVERSE_FACTORIALS[] = {
+    {0.5, 0},
+    {0.16666666666666666, 9.2518585385429707e-18},
+    {0.041666666666666664, 2.3129646346357427e-18},
+    {0.0083333333333333332, 1.1564823173178714e-19},
+    {0.0013888888888888889, -5.3005439543735771e-20},
+    {0.00019841269841269841, 1.7209558293420705e-22},
+    {2.4801587301587302e-05, 2.1511947866775882e-23},
+    {2.7557319223985893e-06, -1.8583932740464721e-22},
+    {2.7557319223985888e-07, 2.3767714622250297e-23},
+    {2.505210838544172e-08, -1.448814070935912e-24},
+    {2.08767569878681e-09, -1.20734505911326e-25},
+    {1.6059043836821613e-10, 1.2585294588752098e-26},
+    {1.1470745597729725e-11, 2.0655512752830745e-28},
+    {7.6471637318198164e-13, 7.03872877733453e-30},
+    {4.7794773323873853e-14, 4.3992054858340813e-31},
+    {2.8114572543455206e-15, 1.6508842730861433e-31},
+    {1.5619206968586225e-16, 1.1910679660273754e-32},
+    {8.2206352466243295e-18, 2.2141894119604265e-34},
+    {4.1103176233121648e-19, 1.4412973378659527e-36},
+    {1.9572941063391263e-20, -1.3643503830087908e-36},
+    {8.8967913924505741e-22, -7.9114026148723762e-38},
+    {3.8681701706306841e-23, -8.8431776554823438e-40},
+    {1.6117375710961184e-24, -3.6846573564509766e-41},
+    {6.4469502843844736e-26, -1.9330404233703465e-42},
+    {2.4795962632247976e-27, -1.2953730964765229e-43},
+    {9.183689863795546e-29, 1.4303150396787322e-45},
+    {3.2798892370698378e-30, 1.5117542744029879e-46},
+    {1.1309962886447716e-31, 1.0498015412959506e-47},
+    {3.7699876288159054e-33, 2.5870347832750324e-49},
+};
+
+/**
+ * @brief Returns 1/n! for 2 <= n <= 30.
+ */
+#define INVERSE_FACTORIAL(n) (INVERSE_FACTORIALS[(n) - 2])
+
+/**
+ * @brief pi / 2 split into three doubles, for the reduction of large arguments of sin and cos.
+ */
+static const double HALF_PI[3] = {1.5707963267948966, 6.123233995736766e-17, -1.4973849048591698e-33};
+
+static const DoubleDouble DD_PI = {3.1415926535897931, 1.2246467991473532e-16};
+static const DoubleDouble DD_HALF_PI = {1.5707963267948966, 6.123233995736766e-17};
+static const DoubleDouble DD_LN2 = {0.69314718055994529, 2.3190468138462996e-17};
+static const DoubleDouble DD_LN10 = {2.3025850929940459, -2.1707562233822494e-16};
+static const DoubleDouble DD_ONE = {1.0, 0.0};
+
+/**
+ * @brief Creates a double-double from a double.
+ *
+ * Also used for special values, whose trailing part would otherwise be NaN.
+ */
+static DoubleDouble dd_from(const double value) {
+    return (DoubleDouble){value, 0.0};
+}
+
+/**
+ * @brief Adds two doubles exactly, for any order of magnitude (Knuth).
+ */
+static DoubleDouble two_sum(const double a, const double b) {
+    const double s = a + b;
+    const double v = s - a;
+    return (DoubleDouble){s, (a - (s - v)) + (b - v)};
+}
+
+/**
+ * @brief Adds two doubles exactly, provided that |a| >= |b| (Dekker).
+ */
+static DoubleDouble quick_two_sum(const double a, const double b) {
+    const double s = a + b;
+    return (DoubleDouble){s, b - (s - a)};
+}
+
+/**
+ * @brief Exponent bits of a double, all set for infinities and NaN.
+ */
+#define EXPONENT_BITS 0x7ff0000000000000ull
+
+/**
+ * @brief Sign bit of a double.
+ */
+#define SIGN_BIT 0x8000000000000000ull
+
+/**
+ * @brief Returns the bits of a double.
+ */
+static inline uint64_t bits_of(const double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(double));
+    return bits;
+}
+
+/**
+ * @brief Selects one of two values with a mask of all ones or all zeros instead of a branch.
+ *
+ * A conditional expression would let the compiler move the computation of a value into a branch, which keeps the
+ * loops over the lanes from vectorising.
+ */
+static inline double select_by_mask(const uint64_t mask, const double chosen, const double otherwise) {
+    const uint64_t bits = (bits_of(chosen) & mask) | (bits_of(otherwise) & ~mask);
+    double selected;
+    memcpy(&selected, &bits, sizeof(double));
+    return selected;
+}
+
+/**
+ * @brief Returns a mask of all ones if the magnitude of a value is above a positive limit, NaN included.
+ */
+static inline uint64_t above_mask(const double value, const double limit) {
+    // The difference wraps around and sets the sign bit exactly when the magnitude is larger
+    return (uint64_t) 0 - ((bits_of(limit) - (bits_of(value) & ~SIGN_BIT)) >> 63);
+}
+
+/**
+ * @brief Returns a mask of all ones if a value is finite.
+ */
+static inline uint64_t finite_mask(const double value) {
+    // The difference wraps around and sets the sign bit unless all exponent bits are set
+    return (uint64_t) 0 - (((bits_of(value) & EXPONENT_BITS) - EXPONENT_BITS) >> 63);
+}
+
+/**
+ * @brief Splits a double into two halves of at most 26 significant bits.
+ *
+ * Huge values are scaled down and back by powers of two, selected without a branch so that loops over lanes
+ * still vectorise.
+ */
+static inline void split(const double a, double *hi, double *lo) {
+    const uint64_t scaled = above_mask(a, SPLIT_LIMIT);
+    const double down = select_by_mask(scaled, 0x1p-28, 1.0);
+    const double up = select_by_mask(scaled, 0x1p28, 1.0);
+    const double reduced = a * down;
+    const double t = SPLITTER * reduced;
+    const double reduced_hi = t - (t - reduced);
+    *hi = reduced_hi * up;
+    *lo = (reduced - reduced_hi) * up;
+}
+
+/**
+ * @brief Multiplies two doubles exactly (Dekker), without relying on a fused multiply-add.
+ */
+static inline DoubleDouble two_prod(const double a, const double b) {
+    double a_hi, a_lo, b_hi, b_lo;
+    const double p = a * b;
+    split(a, &a_hi, &a_lo);
+    split(b, &b_hi, &b_lo);
+    return (DoubleDouble){p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo};
+}
+
+/**
+ * @brief Adds two double-doubles whose sum is finite, without a branch.
+ *
+ * A lane whose leading parts add up to an infinity or NaN gives NaN, see `dd_add()`.
+ */
+static DoubleDouble dd_add_finite(const DoubleDouble a, const DoubleDouble b) {
+    DoubleDouble s = two_sum(a.hi, b.hi);
+    const DoubleDouble t = two_sum(a.lo, b.lo);
+    s.lo += t.hi;
+    s = quick_two_sum(s.hi, s.lo);
+    s.lo += t.lo;
+    return quick_two_sum(s.hi, s.lo);
+}
+
+static DoubleDouble dd_add(const DoubleDouble a, const DoubleDouble b) {
+    const double sum = a.hi + b.hi;
+    return isfinite(sum) ? dd_add_finite(a, b) : dd_from(sum);
+}
+
+static DoubleDouble dd_neg(const DoubleDouble a) {
+    return (DoubleDouble){-a.hi, -a.lo};
+}
+
+static DoubleDouble dd_sub(const DoubleDouble a, const DoubleDouble b) {
+    return dd_add(a, dd_neg(b));
+}
+
+/**
+ * @brief Multiplies two double-doubles whose product is finite, without a branch.
+ *
+ * A lane whose leading parts multiply to an infinity or NaN gives NaN, see `dd_mul()`.
+ */
+static inline DoubleDouble dd_mul_finite(const DoubleDouble a, const DoubleDouble b) {
+    DoubleDouble p = two_prod(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+    return quick_two_sum(p.hi, p.lo);
+}
+
+static DoubleDouble dd_mul(const DoubleDouble a, const DoubleDouble b) {
+    const double product = a.hi * b.hi;
+    return isfinite(product) ? dd_mul_finite(a, b) : dd_from(product);
+}
+
+static DoubleDouble dd_mul_double(const DoubleDouble a, const double b) {
+    DoubleDouble p = two_prod(a.hi, b);
+    if (!isfinite(p.hi)) return dd_from(p.hi);
+    p.lo += a.lo * b;
+    return quick_two_sum(p.hi, p.lo);
+}
+
+/**
+ * @brief Multiplies by a power of two, exactly unless the result underflows.
+ */
+static DoubleDouble dd_ldexp(const DoubleDouble a, const int exponent) {
+    return (DoubleDouble){ldexp(a.hi, exponent), ldexp(a.lo, exponent)};
+}
+
+static DoubleDouble dd_div(const DoubleDouble a, const DoubleDouble b) {
+    const double q1 = a.hi / b.hi;
+    if (!isfinite(q1) || b.hi == 0.0) return dd_from(q1);
+    if (a.hi != 0.0 && fabs(a.hi) < DIVISION_SCALING_LIMIT) {
+        // The products of the remainders would underflow and lose their trailing bits
+        return dd_ldexp(dd_div(dd_ldexp(a, DIVISION_SCALING), b), -DIVISION_SCALING);
+    }
+
+    DoubleDouble r = dd_sub(a, dd_mul_double(b, q1));
+    const double q2 = r.hi / b.hi;
+    r = dd_sub(r, dd_mul_double(b, q2));
+    const double q3 = r.hi / b.hi;
+    if (!isfinite(q2) || !isfinite(q3)) return dd_from(q1);
+
+    return dd_add(quick_two_sum(q1, q2), dd_from(q3));
+}
+
+static DoubleDouble dd_sqrt(const DoubleDouble a) {
+    if (a.hi <= 0.0 || !isfinite(a.hi)) return dd_from(sqrt(a.hi));
+
+    // One Newton step from the double square root doubles the number of correct bits
+    const double root = sqrt(a.hi);
+    const DoubleDouble square = two_prod(root, root);
+    const DoubleDouble residual = dd_sub(a, square);
+    return dd_add(dd_from(root), dd_from(residual.hi * (0.5 / root)));
+}
+
+static DoubleDouble dd_exp(const DoubleDouble a) {
+    if (a.hi > 709.8) return dd_from(INFINITY);
+    if (a.hi < -745.2) return dd_from(0.0);
+    if (!isfinite(a.hi)) return dd_from(exp(a.hi));
+
+    // exp(a) = 2^k * exp(r), with exp(r) = (1 + s)^(2^EXP_HALVINGS) and s = expm1(r / 2^EXP_HALVINGS)
+    const double k = nearbyint(a.hi / DD_LN2.hi);
+    const DoubleDouble r = dd_ldexp(dd_sub(a, dd_mul_double(DD_LN2, k)), -EXP_HALVINGS);
+    DoubleDouble power = r;
+    DoubleDouble s = r;
+    for (int n = 2; n <= 11; n++) {
+        power = dd_mul(power, r);
+        s = dd_add(s, dd_mul(power, INVERSE_FACTORIAL(n)));
+    }
+    for (int i = 0; i < EXP_HALVINGS; i++) {
+        s = dd_add(dd_ldexp(s, 1), dd_mul(s, s)); // (1 + s)^2 - 1
+    }
+    return dd_ldexp(dd_add(s, DD_ONE), (int) k);
+}
+
+static DoubleDouble dd_log(const DoubleDouble a) {
+    if (a.hi <= 0.0 || !isfinite(a.hi)) return dd_from(log(a.hi));
+    if (a.hi < DBL_MIN) {
+        // exp(-log(a)) would overflow, so the logarithm is taken of a * 2^k and k ln 2 subtracted
+        return dd_sub(dd_log(dd_ldexp(a, SUBNORMAL_LOG_SCALING)), dd_mul_double(DD_LN2, SUBNORMAL_LOG_SCALING));
+    }
+
+    // One Newton step on exp(x) = a from the double logarithm
+    const DoubleDouble x = dd_from(log(a.hi));
+    return dd_sub(dd_add(x, dd_mul(a, dd_exp(dd_neg(x)))), DD_ONE);
+}
+
+/**
+ * @brief Computes sin and cos of a reduced argument in [-pi / 4, pi / 4] with their Taylor series.
+ */
+static void sin_cos_taylor(const DoubleDouble r, DoubleDouble *sine, DoubleDouble *cosine) {
+    const DoubleDouble r2 = dd_mul(r, r);
+    DoubleDouble power = r;
+    DoubleDouble s = r;
+    DoubleDouble c = DD_ONE;
+    for (int n = 2; n <= 28; n += 2) {
+        const double sign = n % 4 == 2 ? -1.0 : 1.0;
+        c = dd_add(c, dd_mul_double(dd_mul(dd_mul(power, r), INVERSE_FACTORIAL(n)), sign));
+        power = dd_mul(power, r2);
+        s = dd_add(s, dd_mul_double(dd_mul(power, INVERSE_FACTORIAL(n + 1)), sign));
+    }
+    *sine = s;
+    *cosine = c;
+}
+
+/**
+ * @brief Computes sin and cos of a finite argument below 2^52 in magnitude.
+ */
+static void dd_sin_cos(const DoubleDouble a, DoubleDouble *sine, DoubleDouble *cosine) {
+    // a = k * pi / 2 + r, with pi / 2 in three parts so that the reduction stays exact for large k
+    const double k = nearbyint(a.hi / HALF_PI[0]);
+    DoubleDouble r = dd_sub(a, two_prod(k, HALF_PI[0]));
+    r = dd_sub(r, two_prod(k, HALF_PI[1]));
+    r = dd_sub(r, dd_from(k * HALF_PI[2]));
+
+    DoubleDouble s, c;
+    sin_cos_taylor(r, &s, &c);
+    switch ((long long) fmod(k, 4.0) & 3) {
+        case 0: *sine = s; *cosine = c; break;
+        case 1: *sine = c; *cosine = dd_neg(s); break;
+        case 2: *sine = dd_neg(s); *cosine = dd_neg(c); break;
+        default: *sine = dd_neg(c); *cosine = s; break;
+    }
+}
+
+static DoubleDouble dd_atan(const DoubleDouble a) {
+    if (!isfinite(a.hi)) return isnan(a.hi) ? dd_from(a.hi) : (a.hi > 0 ? DD_HALF_PI : dd_neg(DD_HALF_PI));
+
+    if (fabs(a.hi) > 1.0) {
+        // Near +-pi / 2 the step would multiply a huge a by a cos z that is known to a few digits only
+        const DoubleDouble z = dd_sub(DD_HALF_PI, dd_atan(dd_div(DD_ONE, a.hi > 0 ? a : dd_neg(a))));
+        return a.hi > 0 ? z : dd_neg(z);
+    }
+
+    // One Newton step on tan(z) = a from the double arctangent: z += (a cos z - sin z) cos z
+    DoubleDouble z = dd_from(atan(a.hi));
+    DoubleDouble s, c;
+    dd_sin_cos(z, &s, &c);
+    z = dd_add(z, dd_mul(dd_sub(dd_mul(a, c), s), c));
+    return z;
+}
+
+static DoubleDouble dd_asin(const DoubleDouble a) {
+    if (!(fabs(a.hi) <= 1.0)) return dd_from(asin(a.hi));
+    if (fabs(a.hi) == 1.0 && a.lo * a.hi > 0.0) return dd_from(NAN);
+    if (fabs(a.hi) == 1.0 && a.lo == 0.0) return a.hi > 0 ? DD_HALF_PI : dd_neg(DD_HALF_PI);
+
+    // asin(a) = atan(a / sqrt((1 - a)(1 + a)))
+    const DoubleDouble root = dd_sqrt(dd_mul(dd_sub(DD_ONE, a), dd_add(DD_ONE, a)));
+    return dd_atan(dd_div(a, root));
+}
+
+static DoubleDouble dd_acos(const DoubleDouble a) {
+    if (!(fabs(a.hi) <= 1.0)) return dd_from(acos(a.hi));
+    if (fabs(a.hi) == 1.0 && a.lo * a.hi > 0.0) return dd_from(NAN);
+    if (a.hi == -1.0 && a.lo == 0.0) return DD_PI;
+
+    // acos(a) = 2 atan(sqrt((1 - a) / (1 + a))), without cancellation near 1
+    const DoubleDouble root = dd_sqrt(dd_div(dd_sub(DD_ONE, a), dd_add(DD_ONE, a)));
+    return dd_ldexp(dd_atan(root), 1);
+}
+
+/**
+ * @brief Computes sinh of a small argument with its Taylor series.
+ */
+static DoubleDouble sinh_taylor(const DoubleDouble a) {
+    const DoubleDouble a2 = dd_mul(a, a);
+    DoubleDouble power = a;
+    DoubleDouble s = a;
+    for (int n = 3; n <= 27; n += 2) {
+        power = dd_mul(power, a2);
+        s = dd_add(s, dd_mul(power, INVERSE_FACTORIAL(n)));
+    }
+    return s;
+}
+
+/**
+ * @brief Returns exp(|a|) / 2 without overflowing where the result is finite.
+ */
+static DoubleDouble half_exp_abs(const DoubleDouble a) {
+    return dd_exp(dd_sub(a.hi > 0 ? a : dd_neg(a), DD_LN2));
+}
+
+static DoubleDouble dd_sinh(const DoubleDouble a) {
+    if (!isfinite(a.hi)) return dd_from(sinh(a.hi));
+    if (fabs(a.hi) < HYPERBOLIC_SERIES_LIMIT) return sinh_taylor(a);
+    if (fabs(a.hi) > HYPERBOLIC_EXP_LIMIT) return a.hi > 0 ? half_exp_abs(a) : dd_neg(half_exp_abs(a));
+
+    const DoubleDouble e = dd_exp(a);
+    return dd_ldexp(dd_sub(e, dd_div(DD_ONE, e)), -1);
+}
+
+static DoubleDouble dd_cosh(const DoubleDouble a) {
+    if (!isfinite(a.hi)) return dd_from(cosh(a.hi));
+    if (fabs(a.hi) > HYPERBOLIC_EXP_LIMIT) return half_exp_abs(a);
+
+    const DoubleDouble e = dd_exp(a);
+    return dd_ldexp(dd_add(e, dd_div(DD_ONE, e)), -1);
+}
+
+static DoubleDouble dd_tanh(const DoubleDouble a) {
+    if (!isfinite(a.hi) || fabs(a.hi) > 40.0) return dd_from(tanh(a.hi));
+    if (fabs(a.hi) < HYPERBOLIC_SERIES_LIMIT) {
+        const DoubleDouble s = sinh_taylor(a);
+        return dd_div(s, dd_sqrt(dd_add(DD_ONE, dd_mul(s, s))));
+    }
+
+    // tanh(|a|) = 1 - 2 / (exp(2 |a|) + 1)
+    const DoubleDouble e = dd_exp(dd_ldexp(a.hi < 0 ? dd_neg(a) : a, 1));
+    const DoubleDouble t = dd_sub(DD_ONE, dd_div(dd_from(2.0), dd_add(e, DD_ONE)));
+    return a.hi < 0 ? dd_neg(t) : t;
+}
+
+static DoubleDouble dd_pow(const DoubleDouble base, const DoubleDouble exponent) {
+    const double fallback = pow(base.hi + base.lo, exponent.hi + exponent.lo);
+    if (!isfinite(fallback) || fallback == 0.0 || !isfinite(base.hi) || !isfinite(exponent.hi)) {
+        return dd_from(fallback);
+    }
+
+    if (exponent.lo == 0.0 && exponent.hi == nearbyint(exponent.hi) && fabs(exponent.hi) < 0x1p31) {
+        // Integer exponents are computed by repeated squaring, which also covers negative bases
+        long long n = (long long) fabs(exponent.hi);
+        DoubleDouble result = DD_ONE;
+        DoubleDouble square = base;
+        while (n) {
+            if (n & 1) result = dd_mul(result, square);
+            square = dd_mul(square, square);
+            n >>= 1;
+        }
+        return exponent.hi < 0 ? dd_div(DD_ONE, result) : result;
+    }
+    if (base.hi <= 0.0) return dd_from(fallback);
+    return dd_exp(dd_mul(exponent, dd_log(base)));
+}
+
+DoubleDouble dd_apply(const OpCode code, const DoubleDouble left, const DoubleDouble right) {
+    // Beyond 2^52 every double is an integer and the reduction by pi / 2 loses all significance
+    const int periodic = isfinite(left.hi) && fabs(left.hi) < 0x1p52;
+    DoubleDouble s, c;
+    switch (code) {
+        case OP_NEG: return dd_neg(left);
+        case OP_ADD: return dd_add(left, right);
+        case OP_SUB: return dd_sub(left, right);
+        case OP_MUL: return dd_mul(left, right);
+        case OP_DIV: return dd_div(left, right);
+        case OP_POW: return dd_pow(left, right);
+        case OP_SIN:
+        case OP_SIN_NARROW:
+            if (!periodic) return dd_from(sin(left.hi));
+            dd_sin_cos(left, &s, &c);
+            return s;
+        case OP_COS:
+        case OP_COS_NARROW:
+            if (!periodic) return dd_from(cos(left.hi));
+            dd_sin_cos(left, &s, &c);
+            return c;
+        case OP_TAN:
+            if (!periodic) return dd_from(tan(left.hi));
+            dd_sin_cos(left, &s, &c);
+            return dd_div(s, c);
+        case OP_ABS: return left.hi < 0.0 ? dd_neg(left) : left;
+        case OP_LN: return dd_log(left);
+        case OP_LOG:
+            if (left.hi <= 0.0 || !isfinite(left.hi)) return dd_from(log10(left.hi));
+            return dd_div(dd_log(left), DD_LN10);
+        case OP_ASIN: return dd_asin(left);
+        case OP_ACOS: return dd_acos(left);
+        case OP_ATAN: return dd_atan(left);
+        case OP_SINH: return dd_sinh(left);
+        case OP_COSH: return dd_cosh(left);
+        case OP_TANH: return dd_tanh(left);
+        case OP_EXP: return dd_exp(left);
+        default: return dd_from(NAN);
+    }
+}
+
+int needs_deep_zoom(const Limits *limits) {
+    const double width = limits->x_max - limits->x_min;
+    const double magnitude = fmax(fabs(limits->x_min), fabs(limits->x_max));
+    const double resolution = nextafter(magnitude, INFINITY) - magnitude;
+    return width > 0.0 && width < DEEP_ZOOM_SAMPLES * resolution;
+}
+
+void deep_zoom_grid(const Limits *limits, const size_t first, const size_t count, double *offsets, double *x_hi,
+                    double *x_lo) {
+    const double width = limits->x_max - limits->x_min;
+    for (size_t i = 0; i < count; i++) {
+        offsets[i] = width * (double) (first + i) / (DEEP_ZOOM_SAMPLES - 1);
+        const DoubleDouble x = two_sum(limits->x_min, offsets[i]);
+        x_hi[i] = x.hi;
+        x_lo[i] = x.lo;
+    }
+}
+
+/**
+ * @brief Executes one instruction over arrays of double-double samples.
+ *
+ * The basic arithmetic is written as branch-free loops over the planes, so the compiler can vectorise it. Lanes
+ * that leave the finite range are patched in the same loop by selecting the plain double result with a mask.
+ */
+static void execute_instruction_dd(const Instruction *instruction, double *out_hi, double *out_lo,
+                                   const double *left_hi, const double *left_lo, const double *right_hi,
+                                   const double *right_lo, const double *x_hi, const double *x_lo,
+                                   const double *parameters, const size_t count) {
+    size_t i;
+    switch (instruction->code) {
+        case OP_CONST:
+            for (i = 0; i < count; i++) {
+                out_hi[i] = instruction->value;
+                out_lo[i] = 0.0;
+            }
+            break;
+        case OP_X:
+            memcpy(out_hi, x_hi, count * sizeof(double));
+            memcpy(out_lo, x_lo, count * sizeof(double));
+            break;
+        case OP_PARAMETER: {
+            const double value = parameters ? parameters[instruction->parameter] : 0.0;
+            for (i = 0; i < count; i++) {
+                out_hi[i] = value;
+                out_lo[i] = 0.0;
+            }
+            break;
+        }
+        case OP_NEG:
+            for (i = 0; i < count; i++) {
+                out_hi[i] = -left_hi[i];
+                out_lo[i] = -left_lo[i];
+            }
+            break;
+        case OP_ADD:
+        case OP_SUB: {
+            const double sign = instruction->code == OP_ADD ? 1.0 : -1.0;
+            for (i = 0; i < count; i++) {
+                const DoubleDouble r = dd_add_finite((DoubleDouble){left_hi[i], left_lo[i]},
+                                                     (DoubleDouble){sign * right_hi[i], sign * right_lo[i]});
+                // Lanes that overflowed or met an infinity or NaN take the plain sum, like dd_add()
+                const double sum = left_hi[i] + sign * right_hi[i];
+                out_hi[i] = select_by_mask(finite_mask(sum), r.hi, sum);
+                out_lo[i] = select_by_mask(finite_mask(sum), r.lo, 0.0);
+            }
+            break;
+        }
+        case OP_MUL:
+            for (i = 0; i < count; i++) {
+                const DoubleDouble r = dd_mul_finite((DoubleDouble){left_hi[i], left_lo[i]},
+                                                     (DoubleDouble){right_hi[i], right_lo[i]});
+                // Lanes that overflowed or met an infinity or NaN take the plain product, like dd_mul()
+                const double product = left_hi[i] * right_hi[i];
+                out_hi[i] = select_by_mask(finite_mask(product), r.hi, product);
+                out_lo[i] = select_by_mask(finite_mask(product), r.lo, 0.0);
+            }
+            break;
+        default:
+            for (i = 0; i < count; i++) {
+                const DoubleDouble r = dd_apply(instruction->code, (DoubleDouble){left_hi[i], left_lo[i]},
+                                                right_hi ? (DoubleDouble){right_hi[i], right_lo[i]} : DD_ONE);
+                out_hi[i] = r.hi;
+                out_lo[i] = r.lo;
+            }
+            break;
+    }
+}
+
+void execute_block_dd(const Program *program, const double *x_hi, const double *x_lo, const size_t count,
+                      const double *parameters, double *registers, double *const *ys) {
+    // The leading parts of all registers come first, then the trailing parts
+    double *hi = registers;
+    double *lo = registers + program->length * count;
+
+    for (size_t i = 0; i < program->length; i++) {
+        const Instruction *instruction = &program->code[i];
+        const int binary = operand_count(instruction->code) == 2;
+        execute_instruction_dd(instruction, hi + i * count, lo + i * count,
+                               hi + instruction->left * count, lo + instruction->left * count,
+                               binary ? hi + instruction->right * count : NULL,
+                               binary ? lo + instruction->right * count : NULL,
+                               x_hi, x_lo, parameters, count);
+    }
+    for (size_t i = 0; i < program->result_count; i++) {
+        const size_t result = program->results[i];
+        for (size_t j = 0; j < count; j++) {
+            ys[i][j] = hi[result * count + j] + lo[result * count + j];
+        }
+    }
+}
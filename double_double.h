@@ -0,0 +1,89 @@
+#ifndef DOUBLE_DOUBLE_H
+#define DOUBLE_DOUBLE_H
+
+#include "compiler.h"
+#include "limits.h"
+
+/**
+ * @brief Number of samples of the grid of a deep zoom.
+ *
+ * The regular grid advances by X_EVALUATION_STEP, which leaves a deep zoom with a single sample, so a deep zoom
+ * is sampled with this many evenly spaced points across the window instead.
+ */
+#define DEEP_ZOOM_SAMPLES 1024
+
+/**
+ * @brief A value represented as the unevaluated sum of two doubles with non-overlapping mantissas.
+ *
+ * The pair carries about 106 bits of mantissa, twice the precision of a double, at a small multiple of its cost.
+ * `lo` is at most half a unit in the last place of `hi`. Infinities and NaN are carried in `hi` with `lo` set to 0.
+ *
+ * @struct DoubleDouble
+ * @member hi The leading double, the value rounded to double precision.
+ * @member lo The rounding error of `hi`.
+ */
+typedef struct DoubleDouble {
+    double hi;
+    double lo;
+} DoubleDouble;
+
+/**
+ * @brief Checks whether the x window of the limits is too narrow to be resolved in double precision.
+ *
+ * This is the case when the window holds fewer than DEEP_ZOOM_SAMPLES distinct doubles, so the curve evaluated
+ * in double precision would degenerate into a staircase.
+ *
+ * @param limits The limits defining the window.
+ * @return 1 if the window needs the double-double deep zoom, 0 otherwise.
+ */
+int needs_deep_zoom(const Limits *limits);
+
+/**
+ * @brief Produces points of the deep zoom grid.
+ *
+ * Point `i` of the grid is `x_min + i * (x_max - x_min) / (DEEP_ZOOM_SAMPLES - 1)`. The offset from `x_min` is
+ * rounded to double, the sum is exact as a double-double.
+ *
+ * @param limits  The limits defining the window.
+ * @param first   The index of the first point.
+ * @param count   The number of points.
+ * @param offsets Output array of the offsets of the points from `x_min`.
+ * @param x_hi    Output array of the leading parts of the points.
+ * @param x_lo    Output array of the trailing parts of the points.
+ */
+void deep_zoom_grid(const Limits *limits, size_t first, size_t count, double *offsets, double *x_hi, double *x_lo);
+
+/**
+ * @brief Applies an operation of the compiled program in double-double precision.
+ *
+ * Every operator and function of the evaluator is supported. Arithmetic is accurate to a few units of 2^-106,
+ * the functions to a few units of 2^-104, except `pow` with non-integer exponents, whose error grows with the
+ * magnitude of its logarithm. Special values (infinities, NaN, poles and arguments outside the domain) give the
+ * same result as the double precision evaluation.
+ *
+ * @param code  The operation code, not OP_CONST, OP_X or OP_PARAMETER.
+ * @param left  The first operand.
+ * @param right The second operand of binary operations, ignored otherwise.
+ * @return The result.
+ */
+DoubleDouble dd_apply(OpCode code, DoubleDouble left, DoubleDouble right);
+
+/**
+ * @brief Evaluates the whole program for a block of x values in double-double precision.
+ *
+ * Works like `execute_block()`, with every register split into a plane of leading and a plane of trailing doubles,
+ * so that every instruction is applied to contiguous arrays. Recurrences and narrow kernels are ignored,
+ * every instruction is evaluated directly.
+ *
+ * @param program    The compiled program.
+ * @param x_hi       The leading parts of the x values.
+ * @param x_lo       The trailing parts of the x values.
+ * @param count      Number of x values, at most SAMPLE_BLOCK_SIZE.
+ * @param parameters Array of PARAMETER_COUNT parameter values, or NULL to treat every parameter as 0.
+ * @param registers  Scratch memory of at least `2 * program->length * count` doubles.
+ * @param ys         Per result: output array receiving `count` values, rounded to double.
+ */
+void execute_block_dd(const Program *program, const double *x_hi, const double *x_lo, size_t count,
+                      const double *parameters, double *registers, double *const *ys);
+
+#endif //DOUBLE_DOUBLE_H
@@ -1,8 +1,65 @@
 #include "draw_utils.h"
 
+/**
+ * @brief Binary token of a homogeneous number array (PostScript Language Reference, section 3.14.2).
+ */
+#define BINARY_NUMBER_ARRAY 149
+
+/**
+ * @brief Number representation of 32-bit IEEE reals, high-order byte first, of a binary token.
+ */
+#define BINARY_IEEE_REAL_HIGH_FIRST 48
+
+/**
+ * @brief Bytes of the header of a homogeneous number array: the token, the representation and the length.
+ */
+#define BINARY_ARRAY_HEADER 4
+
+/**
+ * @brief Encoding of the path data, see `set_path_encoding()`.
+ */
+static PathEncoding path_encoding = PATH_ENCODING_TEXT;
+
+void set_path_encoding(const PathEncoding encoding) {
+    path_encoding = encoding;
+}
+
+/**
+ * @brief Number of samples evaluated at once by `draw_function()`, see `set_evaluation_block()`.
+ */
+static size_t evaluation_block = SAMPLE_BLOCK_SIZE;
+
+void set_evaluation_block(const size_t block) {
+    const size_t rounded = block - block % RECURRENCE_RESYNC_PERIOD;
+    evaluation_block = rounded < RECURRENCE_RESYNC_PERIOD ? RECURRENCE_RESYNC_PERIOD
+                                                          : rounded > SAMPLE_BLOCK_SIZE ? SAMPLE_BLOCK_SIZE : rounded;
+}
+
+/**
+ * @brief Writes the header of a PostScript document.
+ *
+ * With the binary path encoding the header also defines the procedures drawing a binary array of points:
+ * 'M' starts a new path at its first point and continues it through the others, 'L' continues the current path.
+ *
+ * @param file Pointer to the output file.
+ */
+static void begin_document(FILE *file) {
+    fprintf(file, "%%!PS\n");
+    if (path_encoding == PATH_ENCODING_BINARY) {
+        fprintf(file, "%%%%LanguageLevel: 2\n");
+        fprintf(file, "/L {0 2 2 index length 1 sub {2 copy get 3 1 roll 1 add 1 index exch get exch 3 1 roll lineto} "
+                      "for pop} bind def\n");
+        fprintf(file, "/M {dup 0 get 1 index 1 get moveto dup length 2 sub 2 exch getinterval L} bind def\n");
+    }
+}
+
 void prepare_graph(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y) {
     // Default setup of PostScript document
-    fprintf(file, "%%!PS\n");
+    begin_document(file);
+    prepare_page(limits, file, scale_x, scale_y);
+}
+
+void prepare_page(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y) {
     fprintf(file, "%%PageSetup\n");
 
     // Font setup
@@ -181,39 +238,199 @@ void draw_support_lines(const Limits *limits, FILE *file, const double *scale_x,
     }
 }
 
+/**
+ * @brief Colors of the curves drawn by `draw_series()`, in order.
+ *
+ * The first curve keeps the current (black) color, so a single function is drawn exactly as before.
+ * Further curves cycle through the remaining colors.
+ */
+static const char *SERIES_COLORS[] = {"0 0 0", "0.8 0 0", "0 0.5 0", "0 0 0.8", "0.8 0.5 0", "0.5 0 0.5", "0 0.6 0.6"};
+
+/**
+ * @brief Number of colors in SERIES_COLORS.
+ */
+#define SERIES_COLOR_COUNT (sizeof(SERIES_COLORS) / sizeof(SERIES_COLORS[0]))
+
 void draw_function(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y,
-                   const Node *abstract_syntax_tree) {
-    int first_point = 1;
-    int out_of_range = 0;
-    for (double x = limits->x_min; x <= limits->x_max; x += X_EVALUATION_STEP) {
-        const double y = evaluate(abstract_syntax_tree, x);
-        // For invalid evaluate case, for example if 2/x and x == 0
-        if (isnan(y)) {
-            if (!first_point) {
-                fprintf(file, "stroke\n"); // Close the current path if the function can not be evaluated in this point
-            }
-            first_point = 1;
-            out_of_range = 1;
-            continue;
+                   const Program *program) {
+    const size_t count = count_samples(limits);
+    double *xs = malloc((count ? count : 1) * sizeof(double));
+    double **ys = malloc(program->result_count * sizeof(double *));
+    double **block_ys = malloc(program->result_count * sizeof(double *));
+    double *registers = malloc(program->length * evaluation_block * sizeof(double));
+    int *proven = malloc(program->result_count * sizeof(int));
+    double cursor = limits->x_min;
+
+    for (size_t i = 0; i < program->result_count; i++) {
+        ys[i] = malloc((count ? count : 1) * sizeof(double));
+        proven[i] = proven_inside(program, i, limits);
+    }
+
+    // All functions are produced together, one block of x-values at a time
+    stage_begin(STAGE_EVALUATE);
+    for (size_t offset = 0; offset < count; offset += evaluation_block) {
+        const size_t block = next_sample_block(limits, &cursor, xs + offset, evaluation_block);
+        for (size_t i = 0; i < program->result_count; i++) {
+            block_ys[i] = ys[i] + offset;
         }
-        if (y > limits->y_max || y < limits->y_min) {
-            if (!out_of_range) {
-                first_point = 1;
-                out_of_range = 1;
-                fprintf(file, "stroke\n"); // Close the current path if the function goes out of range
-            }
+        TRACE_BEGIN_PHASE("sample_chunk");
+        execute_block(program, xs + offset, block, NULL, registers, block_ys);
+        TRACE_END_PHASE("sample_chunk");
+    }
+    stage_end(STAGE_EVALUATE);
+
+    stage_begin(STAGE_EMIT);
+    draw_series(limits, file, scale_x, scale_y, xs, ys, count, program->result_count, proven);
+    stage_end(STAGE_EMIT);
+
+    for (size_t i = 0; i < program->result_count; i++) {
+        free(ys[i]);
+    }
+    free(proven);
+    free(registers);
+    free(block_ys);
+    free(ys);
+    free(xs);
+}
+
+void begin_series(FILE *file, const size_t index) {
+    if (index > 0) {
+        fprintf(file, "stroke\n"); // Finish the previous curve before switching the color
+        run_stats.path_operators++;
+        fprintf(file, "%s setrgbcolor\n", SERIES_COLORS[index % SERIES_COLOR_COUNT]);
+    }
+}
+
+void draw_series(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y,
+                 const double *xs, double *const *ys, const size_t count, const size_t series_count,
+                 const int *proven) {
+    for (size_t i = 0; i < series_count; i++) {
+        PathState state = {1, 0, proven ? proven[i] : 0};
+        begin_series(file, i);
+        TRACE_BEGIN_PHASE("format_chunk");
+        draw_samples(limits, file, scale_x, scale_y, xs, ys[i], count, &state);
+        TRACE_END_PHASE("format_chunk");
+    }
+}
+
+/**
+ * @brief Stores a real as a 32-bit IEEE real, high-order byte first.
+ *
+ * @param value The value, rounded to single precision.
+ * @param bytes Output of 4 bytes.
+ */
+static void store_binary_real(const double value, unsigned char *bytes) {
+    const float single = (float) value;
+    uint32_t bits;
+    memcpy(&bits, &single, sizeof(bits));
+    bytes[0] = (unsigned char) (bits >> 24);
+    bytes[1] = (unsigned char) (bits >> 16);
+    bytes[2] = (unsigned char) (bits >> 8);
+    bytes[3] = (unsigned char) bits;
+}
+
+/**
+ * @brief Writes points as a binary homogeneous number array followed by the procedure drawing them.
+ *
+ * @param file Pointer to the output file.
+ * @param xs The x values of the points, at most SAMPLE_BLOCK_SIZE.
+ * @param ys The y values of the points.
+ * @param count The number of points, at least 1.
+ * @param scale_x The scaling factor for the x-axis.
+ * @param scale_y The scaling factor for the y-axis.
+ * @param start 1 to start a new path at the first point, 0 to continue the current path.
+ */
+static void write_binary_points(FILE *file, const double *xs, const double *ys, const size_t count,
+                                const double scale_x, const double scale_y, const int start) {
+    unsigned char buffer[BINARY_ARRAY_HEADER + 2 * 4 * SAMPLE_BLOCK_SIZE];
+    const size_t length = 2 * count;
+    unsigned char *cursor = buffer + BINARY_ARRAY_HEADER;
+
+    buffer[0] = BINARY_NUMBER_ARRAY;
+    buffer[1] = BINARY_IEEE_REAL_HIGH_FIRST;
+    buffer[2] = (unsigned char) (length >> 8);
+    buffer[3] = (unsigned char) length;
+    for (size_t i = 0; i < count; i++) {
+        store_binary_real(xs[i] * scale_x, cursor);
+        store_binary_real(ys[i] * scale_y, cursor + 4);
+        cursor += 8;
+    }
+    fwrite(buffer, 1, (size_t) (cursor - buffer), file);
+    fprintf(file, start ? "M\n" : "L\n");
+}
+
+void draw_samples(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y,
+                  const double *xs, const double *ys, const size_t count, PathState *state) {
+    uint64_t valid[SEGMENT_MASK_WORDS(SAMPLE_BLOCK_SIZE)];
+    uint64_t nan[SEGMENT_MASK_WORDS(SAMPLE_BLOCK_SIZE)];
+    SampleRun runs[SAMPLE_BLOCK_SIZE];
+    unsigned long long valid_samples = 0;
+    unsigned long long nan_samples = 0;
+    unsigned long long segments = 0;
+    unsigned long long path_operators = 0;
+
+    for (size_t offset = 0; offset < count; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t block = count - offset < SAMPLE_BLOCK_SIZE ? count - offset : SAMPLE_BLOCK_SIZE;
+
+        size_t run_count;
+        if (state->proven_inside) {
+            // Range analysis proved every sample drawable, so the block is a single run
+            runs[0] = (SampleRun){0, block, RUN_VALID};
+            run_count = 1;
+            valid_samples += block;
         } else {
-            const double ps_x = x * *scale_x;
-            const double ps_y = y * *scale_y;
-            out_of_range = 0;
-            if (first_point) {
-                fprintf(file, "%f %f moveto\n", ps_x, ps_y); // Start a new path at the first point
-                first_point = 0;
-            } else {
-                fprintf(file, "%f %f lineto\n", ps_x, ps_y); // Connect points with lines
+            // Classify the whole block first, then walk it run by run instead of sample by sample
+            classify_samples(ys + offset, block, limits->y_min, limits->y_max, valid, nan);
+            run_count = find_sample_runs(valid, nan, block, runs);
+            valid_samples += count_mask_bits(valid, block);
+            nan_samples += count_mask_bits(nan, block);
+        }
+
+        for (size_t r = 0; r < run_count; r++) {
+            const SampleRun *run = &runs[r];
+            if (run->kind == RUN_VALID) {
+                size_t i = offset + run->start;
+                const size_t end = i + run->length;
+                if (path_encoding == PATH_ENCODING_BINARY) {
+                    // The whole run goes into one binary array
+                    write_binary_points(file, xs + i, ys + i, run->length, *scale_x, *scale_y, state->first_point);
+                    segments += state->first_point;
+                    path_operators += run->length;
+                    state->first_point = 0;
+                    state->out_of_range = 0;
+                    continue;
+                }
+                if (state->first_point) {
+                    // Start a new path at the first point
+                    fprintf(file, "%f %f moveto\n", xs[i] * *scale_x, ys[i] * *scale_y);
+                    segments++;
+                    i++;
+                }
+                for (; i < end; i++) {
+                    fprintf(file, "%f %f lineto\n", xs[i] * *scale_x, ys[i] * *scale_y); // Connect points with lines
+                }
+                path_operators += run->length;
+                state->first_point = 0;
+                state->out_of_range = 0;
+                continue;
             }
+
+            // Only the first sample of an invalid run can close the path, the rest is skipped
+            if (run->kind == RUN_NAN ? !state->first_point : !state->out_of_range) {
+                // Close the current path if the function can not be evaluated or goes out of range
+                fprintf(file, "stroke\n");
+                path_operators++;
+            }
+            state->first_point = 1;
+            state->out_of_range = 1;
         }
     }
+
+    run_stats.samples += count;
+    run_stats.nan_samples += nan_samples;
+    run_stats.out_of_range_samples += count - valid_samples - nan_samples;
+    run_stats.segments += segments;
+    run_stats.path_operators += path_operators;
 }
 
 void finish(FILE *file) {
@@ -221,31 +438,159 @@ void finish(FILE *file) {
     fprintf(file, "showpage\n"); // Output the current page and finalize the drawing
 }
 
-void draw_graph(const Limits *limits, FILE *file, const Node *abstract_syntax_tree) {
-    const double scale_x = (PAGE_WIDTH - PAGE_MARGIN) / (limits->x_max - limits->x_min); // X-axis scaling
-    const double scale_y = (PAGE_HEIGHT - PAGE_MARGIN) / (limits->y_max - limits->y_min); // Y-axis scaling
-    double x_cords_for_y_axis; // Used for translating y-axis
-    double y_cords_for_x_axis; // Used for translating x-axis
-
+/**
+ * @brief Computes where the axes are drawn, keeping them inside the limits when zero is out of range.
+ *
+ * @param limits Pointer to a Limits structure defining the axes ranges.
+ * @param scale_x The scaling factor for the X-axis.
+ * @param scale_y The scaling factor for the Y-axis.
+ * @param x_cords_for_y_axis Set to the X-coordinate of the Y-axis.
+ * @param y_cords_for_x_axis Set to the Y-coordinate of the X-axis.
+ */
+static void axes_position(const Limits *limits, const double scale_x, const double scale_y,
+                          double *x_cords_for_y_axis, double *y_cords_for_x_axis) {
     if (limits->x_min > 0) {
-        x_cords_for_y_axis = limits->x_min * scale_x;
+        *x_cords_for_y_axis = limits->x_min * scale_x;
     } else if (limits->x_max < 0) {
-        x_cords_for_y_axis = limits->x_max * scale_x;
+        *x_cords_for_y_axis = limits->x_max * scale_x;
     } else {
-        x_cords_for_y_axis = 0.0;
+        *x_cords_for_y_axis = 0.0;
     }
     if (limits->y_min > 0) {
-        y_cords_for_x_axis = limits->y_min * scale_y;
+        *y_cords_for_x_axis = limits->y_min * scale_y;
     } else if (limits->y_max < 0) {
-        y_cords_for_x_axis = limits->y_max * scale_y;
+        *y_cords_for_x_axis = limits->y_max * scale_y;
     } else {
-        y_cords_for_x_axis = 0.0;
+        *y_cords_for_x_axis = 0.0;
+    }
+}
+
+void draw_background(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y) {
+    double x_cords_for_y_axis; // Used for translating y-axis
+    double y_cords_for_x_axis; // Used for translating x-axis
+
+    axes_position(limits, *scale_x, *scale_y, &x_cords_for_y_axis, &y_cords_for_x_axis);
+
+    prepare_graph(limits, file, scale_x, scale_y);
+    draw_axes(limits, file, scale_x, scale_y, &x_cords_for_y_axis, &y_cords_for_x_axis);
+    draw_limits(limits, file, scale_x, scale_y);
+    draw_support_lines(limits, file, scale_x, scale_y, &x_cords_for_y_axis, &y_cords_for_x_axis);
+}
+
+void draw_graph(const Limits *limits, FILE *file, const Program *program) {
+    if (needs_deep_zoom(limits)) {
+        draw_deep_zoom(limits, file, program);
+        return;
+    }
+
+    const double scale_x = (PAGE_WIDTH - PAGE_MARGIN) / (limits->x_max - limits->x_min); // X-axis scaling
+    const double scale_y = (PAGE_HEIGHT - PAGE_MARGIN) / (limits->y_max - limits->y_min); // Y-axis scaling
+
+    stage_begin(STAGE_EMIT);
+    draw_background(limits, file, &scale_x, &scale_y);
+    stage_end(STAGE_EMIT);
+
+    draw_function(limits, file, &scale_x, &scale_y, program);
+
+    stage_begin(STAGE_EMIT);
+    finish(file);
+    stage_end(STAGE_EMIT);
+}
+
+void draw_deep_zoom(const Limits *limits, FILE *file, const Program *program) {
+    // Everything is drawn at its offset from x_min, which keeps the page coordinates small and exact
+    const Limits window = {0.0, limits->x_max - limits->x_min, limits->y_min, limits->y_max};
+    const double scale_x = (PAGE_WIDTH - PAGE_MARGIN) / (window.x_max - window.x_min); // X-axis scaling
+    const double scale_y = (PAGE_HEIGHT - PAGE_MARGIN) / (window.y_max - window.y_min); // Y-axis scaling
+    double offsets[DEEP_ZOOM_SAMPLES];
+    double x_hi[SAMPLE_BLOCK_SIZE];
+    double x_lo[SAMPLE_BLOCK_SIZE];
+    double **ys = malloc(program->result_count * sizeof(double *));
+    double **block_ys = malloc(program->result_count * sizeof(double *));
+    double *registers = malloc(2 * program->length * SAMPLE_BLOCK_SIZE * sizeof(double));
+
+    stage_begin(STAGE_EMIT);
+    draw_background(&window, file, &scale_x, &scale_y);
+
+    // The origin of the offsets, below the graph
+    fprintf(file, "0 0 0 setrgbcolor\n");
+    fprintf(file, "%f %f moveto\n", 0.0, window.y_min * scale_y - 3 * FONT_SIZE);
+    fprintf(file, "(x = %.17g + offset) show\n", limits->x_min);
+    stage_end(STAGE_EMIT);
+
+    for (size_t i = 0; i < program->result_count; i++) {
+        ys[i] = malloc(DEEP_ZOOM_SAMPLES * sizeof(double));
+    }
+
+    stage_begin(STAGE_EVALUATE);
+    for (size_t offset = 0; offset < DEEP_ZOOM_SAMPLES; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t block = DEEP_ZOOM_SAMPLES - offset < SAMPLE_BLOCK_SIZE ? DEEP_ZOOM_SAMPLES - offset
+                                                                            : SAMPLE_BLOCK_SIZE;
+        for (size_t i = 0; i < program->result_count; i++) {
+            block_ys[i] = ys[i] + offset;
+        }
+        TRACE_BEGIN_PHASE("sample_chunk");
+        deep_zoom_grid(limits, offset, block, offsets + offset, x_hi, x_lo);
+        execute_block_dd(program, x_hi, x_lo, block, NULL, registers, block_ys);
+        TRACE_END_PHASE("sample_chunk");
     }
+    stage_end(STAGE_EVALUATE);
 
-    prepare_graph(limits, file, &scale_x, &scale_y);
-    draw_axes(limits, file, &scale_x, &scale_y, &x_cords_for_y_axis, &y_cords_for_x_axis);
-    draw_limits(limits, file, &scale_x, &scale_y);
-    draw_support_lines(limits, file, &scale_x, &scale_y, &x_cords_for_y_axis, &y_cords_for_x_axis);
-    draw_function(limits, file, &scale_x, &scale_y, abstract_syntax_tree);
+    stage_begin(STAGE_EMIT);
+    draw_series(&window, file, &scale_x, &scale_y, offsets, ys, DEEP_ZOOM_SAMPLES, program->result_count, NULL);
     finish(file);
+    stage_end(STAGE_EMIT);
+
+    for (size_t i = 0; i < program->result_count; i++) {
+        free(ys[i]);
+    }
+    free(registers);
+    free(block_ys);
+    free(ys);
+}
+
+void draw_sweep(const Limits *limits, FILE *file, const Program *program, const Sweep *sweep) {
+    const double scale_x = (PAGE_WIDTH - PAGE_MARGIN) / (limits->x_max - limits->x_min); // X-axis scaling
+    const double scale_y = (PAGE_HEIGHT - PAGE_MARGIN) / (limits->y_max - limits->y_min); // Y-axis scaling
+    double x_cords_for_y_axis; // Used for translating y-axis
+    double y_cords_for_x_axis; // Used for translating x-axis
+    double parameters[PARAMETER_COUNT];
+
+    axes_position(limits, scale_x, scale_y, &x_cords_for_y_axis, &y_cords_for_x_axis);
+
+    stage_begin(STAGE_EVALUATE);
+    SweepCache *cache = prepare_sweep(program, limits);
+    stage_end(STAGE_EVALUATE);
+    double **ys = malloc(program->result_count * sizeof(double *));
+    int *proven = malloc(program->result_count * sizeof(int));
+    for (size_t i = 0; i < program->result_count; i++) {
+        ys[i] = malloc((cache->count ? cache->count : 1) * sizeof(double));
+        proven[i] = proven_inside(program, i, limits); // Parameters are unbounded, so only x-only results qualify
+    }
+
+    begin_document(file);
+    for (size_t frame = 0; frame < sweep->frames; frame++) {
+        sweep_frame_parameters(sweep, frame, parameters);
+        trace_job((long) frame); // Every frame is traced as a job of its own
+        stage_begin(STAGE_EVALUATE);
+        evaluate_sweep_frame(cache, parameters, ys);
+        stage_end(STAGE_EVALUATE);
+
+        stage_begin(STAGE_EMIT);
+        prepare_page(limits, file, &scale_x, &scale_y);
+        draw_axes(limits, file, &scale_x, &scale_y, &x_cords_for_y_axis, &y_cords_for_x_axis);
+        draw_limits(limits, file, &scale_x, &scale_y);
+        draw_support_lines(limits, file, &scale_x, &scale_y, &x_cords_for_y_axis, &y_cords_for_x_axis);
+        draw_series(limits, file, &scale_x, &scale_y, cache->xs, ys, cache->count, program->result_count, proven);
+        finish(file);
+        stage_end(STAGE_EMIT);
+    }
+    trace_job(0);
+
+    for (size_t i = 0; i < program->result_count; i++) {
+        free(ys[i]);
+    }
+    free(proven);
+    free(ys);
+    free_sweep_cache(cache);
 }
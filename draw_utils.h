@@ -3,6 +3,12 @@
 
 #include "evaluator.h"
 #include "limits.h"
+#include "sweep.h"
+#include "stats.h"
+#include "trace.h"
+#include "segments.h"
+#include "ranges.h"
+#include "double_double.h"
 
 /**
  * @brief Defines constants used for graph rendering and page layout.
@@ -51,12 +57,55 @@
 #define FONT_SIZE 12.0
 
 /**
- * @brief Step size for evaluating function values.
+ * @brief Encodings of the path data of the curves.
  *
- * This defines the granularity of the evaluation of the function for plotting. A smaller step size gives a more detailed graph.
+ * PATH_ENCODING_TEXT writes every point as an ASCII moveto or lineto. PATH_ENCODING_BINARY writes every run of
+ * valid points as a PostScript Level 2 binary token, a homogeneous array of 32-bit IEEE reals, followed by a
+ * one-letter procedure defined in the document header, which saves most of the bytes and of the parsing time of
+ * the interpreter. Axes, labels and grid lines stay ASCII in both encodings.
  */
-#define X_EVALUATION_STEP 0.01
+typedef enum PathEncoding {
+    PATH_ENCODING_TEXT,
+    PATH_ENCODING_BINARY
+} PathEncoding;
 
+/**
+ * @brief State of the path being drawn from the sampled points.
+ *
+ * The state is carried from one block of samples to the next, so that a curve drawn block by block
+ * produces exactly the same path as a curve drawn point by point.
+ *
+ * @struct PathState
+ * @member first_point 1 if the next valid point starts a new path.
+ * @member out_of_range 1 if the previous point was invalid or outside of the y limits.
+ * @member proven_inside 1 if range analysis proved every point of the curve finite and inside the y limits.
+ */
+typedef struct PathState {
+    int first_point;
+    int out_of_range;
+    int proven_inside;
+} PathState;
+
+/**
+ * @brief Selects the encoding of the path data of all documents written afterwards.
+ *
+ * The file must be opened in binary mode for PATH_ENCODING_BINARY.
+ *
+ * @param encoding The encoding, PATH_ENCODING_TEXT by default.
+ */
+void set_path_encoding(PathEncoding encoding);
+
+/**
+ * @brief Selects how many samples `draw_function()` evaluates at once.
+ *
+ * Smaller blocks keep the registers of long programs in the cache, larger ones spread the interpretation of every
+ * instruction over more samples. The block is rounded down to a multiple of RECURRENCE_RESYNC_PERIOD, so the
+ * recurrences restart at the same samples and the page does not depend on it.
+ *
+ * @param block The number of samples, between RECURRENCE_RESYNC_PERIOD and SAMPLE_BLOCK_SIZE, SAMPLE_BLOCK_SIZE
+ *              by default.
+ */
+void set_evaluation_block(size_t block);
 
 /**
  * @brief Initializes the PostScript file for graph generation, including setting up page size, font, and coordinate system.
@@ -72,6 +121,19 @@
  */
 void prepare_graph(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y);
 
+/**
+ * @brief Sets up one page of the PostScript document.
+ *
+ * This function writes everything `prepare_graph()` writes except for the document header, so that it can be
+ * used for every page of a multi-page document, such as the frames of a parameter sweep.
+ *
+ * @param limits A pointer to a Limits structure containing the minimum and maximum values for the x and y axes.
+ * @param file A pointer to the file where the PostScript content will be written.
+ * @param scale_x A pointer to a double representing the scaling factor for the x-axis.
+ * @param scale_y A pointer to a double representing the scaling factor for the y-axis.
+ */
+void prepare_page(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y);
+
 /**
  * @brief Draws the coordinate axes on a PostScript file.
  *
@@ -141,20 +203,73 @@ void draw_support_lines(const Limits *limits, FILE *file, const double *scale_x,
                         const double *x_cords_for_y_axis, const double *y_cords_for_x_axis);
 
 /**
- * @brief Draws a mathematical function based on an abstract syntax tree in the PostScript format.
+ * @brief Draws the functions of a compiled program in the PostScript format.
  *
- * This function evaluates the mathematical function represented by the given abstract syntax tree for a range of x-values specified by the limits. It generates the corresponding PostScript code to draw the function on a graph, considering scaling factors for both the x and y axes. The function ensures that points falling outside the y-axis limits are skipped, and it only connects points within the valid range.
+ * This function evaluates every result of the program for a range of x-values specified by the limits. All results are
+ * produced together by the fused program, one block of x-values at a time, so subexpressions shared by several functions
+ * are evaluated only once per point. Every function is then drawn as its own curve, considering scaling factors for both
+ * the x and y axes. The function ensures that points falling outside the y-axis limits are skipped, and it only connects
+ * points within the valid range.
  *
  * @param limits A pointer to a Limits structure containing the minimum and maximum values for the x and y axes.
  * @param file A pointer to the file where the PostScript content will be written.
  * @param scale_x A pointer to a double representing the scaling factor for the x-axis.
  * @param scale_y A pointer to a double representing the scaling factor for the y-axis.
- * @param abstract_syntax_tree A pointer to a Node representing the abstract syntax tree of the function to be plotted.
+ * @param program A pointer to the compiled program of the functions to be plotted.
  *
- * @note The function assumes the presence of the constant `X_EVALUATION_STEP`, which defines the step size for the x-values. The function also assumes the availability of an `evaluate` function that computes the y-value for a given x based on the abstract syntax tree.
+ * @note The function assumes the presence of the constant `X_EVALUATION_STEP`, which defines the step size for the x-values.
  */
 void draw_function(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y,
-                   const Node *abstract_syntax_tree);
+                   const Program *program);
+
+/**
+ * @brief Starts the curve of one function of a series.
+ *
+ * The first curve keeps the current color. Every further curve finishes the previous one with a stroke
+ * and switches to the next color of the series palette.
+ *
+ * @param file A pointer to the file where the PostScript content will be written.
+ * @param index The index of the function in the series.
+ */
+void begin_series(FILE *file, size_t index);
+
+/**
+ * @brief Draws several sampled functions over the same x-values, one curve each.
+ *
+ * The first curve is drawn in the current color. Every further curve finishes the previous one with a stroke
+ * and switches to the next color of the series palette. Curves proven inside of the limits by `proven_inside()`
+ * are drawn without classifying their samples.
+ *
+ * @param limits A pointer to a Limits structure containing the minimum and maximum values for the x and y axes.
+ * @param file A pointer to the file where the PostScript content will be written.
+ * @param scale_x A pointer to a double representing the scaling factor for the x-axis.
+ * @param scale_y A pointer to a double representing the scaling factor for the y-axis.
+ * @param xs The x values of the samples.
+ * @param ys Per function: the function values of the samples.
+ * @param count The number of samples.
+ * @param series_count The number of functions.
+ * @param proven Per function: 1 if it is proven inside of the limits, or NULL if none is.
+ */
+void draw_series(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y,
+                 const double *xs, double *const *ys, size_t count, size_t series_count, const int *proven);
+
+/**
+ * @brief Draws a block of sampled points of a function in the PostScript format.
+ *
+ * Points that are NaN or fall outside of the y limits break the curve. Valid points are connected with lines,
+ * and the path is continued across calls through the given path state.
+ *
+ * @param limits A pointer to a Limits structure containing the minimum and maximum values for the x and y axes.
+ * @param file A pointer to the file where the PostScript content will be written.
+ * @param scale_x A pointer to a double representing the scaling factor for the x-axis.
+ * @param scale_y A pointer to a double representing the scaling factor for the y-axis.
+ * @param xs The x values of the samples.
+ * @param ys The function values of the samples.
+ * @param count The number of samples.
+ * @param state The path state, initialized to {1, 0, proven} before the first block of a curve.
+ */
+void draw_samples(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y,
+                  const double *xs, const double *ys, size_t count, PathState *state);
 
 /**
  * @brief Finalizes the PostScript drawing and ends the page.
@@ -178,8 +293,7 @@ void finish(FILE *file);
  * @param limits Pointer to a Limits structure that defines the minimum and maximum
  *               values for the graph's X and Y axes.
  * @param file   Pointer to the output file where PostScript commands will be written.
- * @param abstract_syntax_tree Pointer to a Node structure representing the abstract
- *                             syntax tree of the mathematical function to be graphed.
+ * @param program Pointer to the compiled program of the mathematical functions to be graphed.
  *
  * @note The function calls various helper functions (`prepare_graph`, `draw_axes`,
  *       `draw_limits`, `draw_support_lines`, and `draw_function`) to construct the graph.
@@ -187,8 +301,48 @@ void finish(FILE *file);
  *       based on the provided limits and adjusts the graph's positioning accordingly.
  *
  * @note Ensure the file is already opened in write mode before passing it to this function.
+ * @note Windows too narrow for double precision (see `needs_deep_zoom()`) are drawn by `draw_deep_zoom()`.
+ */
+void draw_graph(const Limits *limits, FILE *file, const Program *program);
+
+/**
+ * @brief Writes everything of a graph page except for the curves: the document header, axes, limits and grid lines.
+ *
+ * @param limits  Pointer to a Limits structure that defines the minimum and maximum
+ *                values for the graph's X and Y axes.
+ * @param file    Pointer to the output file where PostScript commands will be written.
+ * @param scale_x A pointer to a double representing the scaling factor for the x-axis.
+ * @param scale_y A pointer to a double representing the scaling factor for the y-axis.
+ */
+void draw_background(const Limits *limits, FILE *file, const double *scale_x, const double *scale_y);
+
+/**
+ * @brief Draws the graph of a window too narrow for double precision, evaluated in double-double precision.
+ *
+ * The window is sampled with DEEP_ZOOM_SAMPLES evenly spaced points whose x values are exact double-doubles,
+ * and every function is evaluated with `execute_block_dd()`. The page is laid out in offsets from `x_min`,
+ * which double precision resolves at any zoom, and `x_min` is printed below the graph.
+ *
+ * @param limits  Pointer to a Limits structure that defines the window.
+ * @param file    Pointer to the output file where PostScript commands will be written.
+ * @param program Pointer to the compiled program of the mathematical functions to be graphed.
+ */
+void draw_deep_zoom(const Limits *limits, FILE *file, const Program *program);
+
+/**
+ * @brief Draws one page per frame of a parameter sweep.
+ *
+ * Every page contains the same grid lines, axes and limits as a page drawn by `draw_graph()`, and the curve
+ * of the program evaluated with the parameter values of its frame. The parts of the program that do not
+ * depend on the parameters are evaluated only once for all frames.
+ *
+ * @param limits Pointer to a Limits structure that defines the minimum and maximum
+ *               values for the graph's X and Y axes.
+ * @param file   Pointer to the output file where PostScript commands will be written.
+ * @param program Pointer to the compiled program of the functions.
+ * @param sweep  Pointer to the Sweep structure defining the parameter values of every frame.
  */
-void draw_graph(const Limits *limits, FILE *file, const Node *abstract_syntax_tree);
+void draw_sweep(const Limits *limits, FILE *file, const Program *program, const Sweep *sweep);
 
 
 #endif // PLOT_UTILS_H
@@ -15,3 +15,7 @@ void error_exit(const char *message, const int exit_code) {
     fprintf(stderr, "Error: %s.\n", message);
     exit(exit_code);
 }
+
+void print_warning(const char *message) {
+    fprintf(stderr, "Warning: %s.\n", message);
+}
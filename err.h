@@ -47,6 +47,14 @@
  */
 #define ERROR_FILE_TEXT "unable to open output file"
 
+/**
+ * @brief Error message for unreadable expressions.
+ *
+ * This message appears if the expressions are given as @<file> and the file can not be read, or as - and the
+ * standard input can not be read.
+ */
+#define ERROR_SOURCE_TEXT "unable to read the expressions from the file or the standard input"
+
 /**
  * @brief Error message for an invalid limits string.
  *
@@ -61,7 +69,82 @@
  * This message is displayed if the input arguments are invalid. The user should ensure the correct usage:
  * <func> <out-file> [<limits>], where <func> is a valid mathematical function enclosed in quotes if necessary.
  */
-#define ERROR_ARGS_TEXT "invalid input. Correct usage: <func> <out-file> [<limits>].\nEnsure the function is a single-variable mathematical expression and enclosed in quotes if it contains spaces"
+#define ERROR_ARGS_TEXT "invalid input. Correct usage: <func> <out-file> [<limits>] [<options>].\nEnsure the function is a mathematical expression of x and enclosed in quotes if it contains spaces, or @<file> or - to read it from a file or the standard input"
+
+/**
+ * @brief Error message for an unknown command-line option.
+ *
+ * This message is displayed if an argument starting with "--" is not one of the supported options.
+ */
+#define ERROR_OPTION_TEXT "unknown option.\nSupported options: --param=<name>:<value>, --sweep=<name>:<from>:<to>:<frames>, --perf-counters, --stats[=<file.json>], --trace=<file.json>, --profile[=<file.folded>], --recurrences, --narrow-kernels, --binary-paths, --serve[=<requests>], --job-limits=<interactive>:<batch>, --workers[=<n>], --export-samples=<file>, --sample-encoding=<xor|quantised>, --batch-window=<microseconds>, --tune[=<file>]"
+
+/**
+ * @brief Error message for an invalid parameter or sweep definition.
+ *
+ * This message appears if a --param or --sweep option is malformed. Only the parameters a, b and t can be set or swept,
+ * and a sweep needs at least one frame.
+ */
+#define ERROR_SWEEP_TEXT "while parsing parameter definition.\nCorrect usage: --param=⟨name⟩:⟨value⟩ or --sweep=⟨name⟩:⟨from⟩:⟨to⟩:⟨frames⟩\nEnsure that name is a, b or t and frames is positive"
+
+/**
+ * @brief Error message for a malformed request of the long-running mode.
+ *
+ * This message answers a request that does not follow the format <class> <out-file> <limits> <expression>.
+ * The request is skipped and the server continues with the next one.
+ */
+#define ERROR_REQUEST_TEXT "malformed request, expected <interactive|batch> <out-file> <limits|-> <expression>"
+
+/**
+ * @brief Error message for a malformed query in the long-running mode.
+ *
+ * This message answers a value or nearest query that is malformed or asks for a page that is not written yet
+ * or no longer kept. The query is skipped and the server continues with the next request.
+ */
+#define ERROR_QUERY_TEXT "malformed query or unknown page, expected value <id> <page-x>, nearest <id> <page-x> <page-y> or point <id> <x>"
+
+/**
+ * @brief Error message for invalid job limits.
+ *
+ * This message appears if the --job-limits option is malformed.
+ */
+#define ERROR_JOB_LIMITS_TEXT "while parsing job limits.\nCorrect usage: --job-limits=⟨interactive⟩:⟨batch⟩\nEnsure that both limits are positive"
+
+/**
+ * @brief Error message for an invalid number of workers.
+ *
+ * This message appears if the --workers option does not give a positive number.
+ */
+#define ERROR_WORKERS_TEXT "while parsing the number of workers.\nCorrect usage: --workers or --workers=⟨n⟩\nEnsure that n is positive"
+
+/**
+ * @brief Error message for an invalid window of point queries.
+ *
+ * This message appears if the --batch-window option does not give a number of microseconds.
+ */
+#define ERROR_BATCH_WINDOW_TEXT "while parsing the batch window.\nCorrect usage: --batch-window=⟨microseconds⟩\nEnsure that the window is not negative"
+
+/**
+ * @brief Error message for an unknown sample encoding.
+ *
+ * This message appears if the --sample-encoding option names no known encoding.
+ */
+#define ERROR_SAMPLE_ENCODING_TEXT "unknown sample encoding.\nCorrect usage: --sample-encoding=⟨xor|quantised⟩"
+
+/**
+ * @brief Warning message for missing hardware performance counters.
+ *
+ * This message is displayed if --perf-counters was requested, but no counter could be opened, for example because
+ * the system does not support `perf_event_open` or the kernel does not allow it.
+ */
+#define WARNING_PERF_COUNTERS_TEXT "hardware performance counters are not available, continuing without them"
+
+/**
+ * @brief Warning message for an invalid tuning profile.
+ *
+ * This message is displayed if the tuning profile of the machine exists, but was not written by --tune or holds
+ * an invalid value. The built-in settings are used instead.
+ */
+#define WARNING_TUNING_TEXT "the tuning profile is invalid, continuing with the default settings"
 
 /**
  * @brief Error code for invalid arguments.
@@ -91,6 +174,13 @@
  */
 #define ERROR_LIMITS 4
 
+/**
+ * @brief Error code for parameter and sweep parsing issues.
+ *
+ * This error code is used when a --param or --sweep option could not be parsed.
+ */
+#define ERROR_SWEEP 5
+
 /**
  * @brief Prints an error message and exits the program with the specified exit code.
  *
@@ -104,5 +194,14 @@
  */
 void error_exit(const char *message, int exit_code);
 
+/**
+ * @brief Prints a warning message without terminating the program.
+ *
+ * This function is used for problems the program can recover from, such as an optional feature that is not available.
+ *
+ * @param message The warning message to be printed.
+ */
+void print_warning(const char *message);
+
 
 #endif //UTILITIES_H
@@ -20,4 +20,41 @@
  */
 double evaluate(const Node *node, double x_value);
 
+/**
+ * @brief Evaluates the abstract syntax tree at a given `x_value` with explicit values for the named parameters.
+ *
+ * This is the reference evaluator for expressions that reference the parameters 'a', 'b' and 't'. Identifier
+ * nodes other than 'x' are resolved through `parameter_index()` and read from the `parameters` array.
+ * `evaluate()` is equivalent to calling this function with `parameters` set to NULL.
+ *
+ * @param node       Pointer to the root node of the abstract syntax tree (AST) representing the function.
+ * @param x_value    The value of `x` to evaluate the function at.
+ * @param parameters Array of PARAMETER_COUNT parameter values, or NULL to treat every parameter as 0.
+ * @return The evaluated value of the function at the given `x_value`.
+ */
+double evaluate_with_parameters(const Node *node, double x_value, const double *parameters);
+
+/**
+ * @brief Applies a mathematical function to an already evaluated argument.
+ *
+ * @param name      The name of the function as stored in a NODE_FUNC node, e.g. "sin".
+ * @param arg_value The value of the argument.
+ * @return The value of the function.
+ *
+ * @note Exits the program with an error if the function is unknown.
+ */
+double apply_function(const char *name, double arg_value);
+
+/**
+ * @brief Applies a binary operator to already evaluated operands.
+ *
+ * @param op          The operator as stored in a NODE_OP node, e.g. '+'.
+ * @param left_value  The value of the left operand.
+ * @param right_value The value of the right operand.
+ * @return The result of the operation.
+ *
+ * @note Exits the program with an error if the operator is unknown.
+ */
+double apply_operator(char op, double left_value, double right_value);
+
 #endif // EVALUATOR_H
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "generator.h"
+#include "err.h"
+
+/**
+ * @brief Generator of synthetic expression workloads for scaling tests.
+ *
+ * Writes random but valid expressions, one per line, so the lexer, parser and evaluators can be measured on inputs
+ * of any size. A single expression with millions of nodes tests how the stages scale with the size of the input,
+ * many small expressions form a job file for batch runs. The same seed and options always produce the same output.
+ *
+ * Usage: pc_gen [--seed=<n>] [--count=<n>] [--nodes=<n>] [--depth=<n>] [--functions=<fraction>]
+ *               [--constants=<fraction>] [--duplicates=<fraction>] [--poles=<fraction>] [--output=<file>]
+ */
+
+/**
+ * @brief Text of the error printed for invalid arguments.
+ */
+#define GEN_USAGE_TEXT "invalid input. Correct usage: pc_gen [--seed=<n>] [--count=<n>] [--nodes=<n>] [--depth=<n>] " \
+                       "[--functions=<fraction>] [--constants=<fraction>] [--duplicates=<fraction>] " \
+                       "[--poles=<fraction>] [--output=<file>]"
+
+int main(const int argc, char *argv[]) {
+    GeneratorOptions options;
+    Generator generator;
+    unsigned long long seed = 1;
+    unsigned long long count = 1;
+    unsigned long long total_nodes = 0;
+    const char *output_name = NULL;
+
+    initialize_generator_options(&options);
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--count=", 8) == 0) {
+            count = strtoull(argv[i] + 8, NULL, 10);
+        } else if (strncmp(argv[i], "--nodes=", 8) == 0) {
+            options.nodes = (size_t) strtoull(argv[i] + 8, NULL, 10);
+        } else if (strncmp(argv[i], "--depth=", 8) == 0) {
+            options.depth = (size_t) strtoull(argv[i] + 8, NULL, 10);
+        } else if (strncmp(argv[i], "--functions=", 12) == 0) {
+            options.functions = atof(argv[i] + 12);
+        } else if (strncmp(argv[i], "--constants=", 12) == 0) {
+            options.constants = atof(argv[i] + 12);
+        } else if (strncmp(argv[i], "--duplicates=", 13) == 0) {
+            options.duplicates = atof(argv[i] + 13);
+        } else if (strncmp(argv[i], "--poles=", 8) == 0) {
+            options.poles = atof(argv[i] + 8);
+        } else if (strncmp(argv[i], "--output=", 9) == 0) {
+            output_name = argv[i] + 9;
+        } else {
+            error_exit(GEN_USAGE_TEXT, ERROR_ARGS);
+        }
+    }
+    if (options.nodes < 1 || count < 1) {
+        error_exit(GEN_USAGE_TEXT, ERROR_ARGS);
+    }
+
+    FILE *output = output_name ? fopen(output_name, "w") : stdout;
+    if (!output) {
+        error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+    }
+
+    initialize_generator(&generator, &options, seed);
+    for (unsigned long long i = 0; i < count; i++) {
+        size_t nodes;
+        char *expression = generate_expression(&generator, &nodes);
+        fprintf(output, "%s\n", expression);
+        free(expression);
+        total_nodes += nodes;
+    }
+    free_generator(&generator);
+
+    if (output != stdout) {
+        fclose(output);
+    }
+    fprintf(stderr, "generated %llu expressions with %llu nodes\n", count, total_nodes);
+    return 0;
+}
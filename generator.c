@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "generator.h"
+#include "lexer.h"
+
+/**
+ * @brief Functions the generator chooses from. The empty name stands for unary minus.
+ */
+static const char *GENERATOR_FUNCTIONS[] = {SIN, COS, TAN, ABS, LN, LOG, ASIN, ACOS, ATAN, SINH, COSH, TANH, EXP, ""};
+
+/**
+ * @brief Number of entries of GENERATOR_FUNCTIONS.
+ */
+#define GENERATOR_FUNCTION_COUNT (sizeof(GENERATOR_FUNCTIONS) / sizeof(GENERATOR_FUNCTIONS[0]))
+
+/**
+ * @brief Binary operators the generator chooses from.
+ */
+static const char GENERATOR_OPERATORS[] = {PLUS, MINUS, MULT, DIVISION, POWER};
+
+/**
+ * @brief Number of entries of GENERATOR_OPERATORS.
+ */
+#define GENERATOR_OPERATOR_COUNT (sizeof(GENERATOR_OPERATORS) / sizeof(GENERATOR_OPERATORS[0]))
+
+/**
+ * @brief A growing string the expression is written into.
+ */
+typedef struct TextBuffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+} TextBuffer;
+
+/**
+ * @brief Appends a string to a text buffer.
+ *
+ * @param buffer The buffer.
+ * @param text   The string to be appended.
+ * @param length The length of the string.
+ */
+static void append_text(TextBuffer *buffer, const char *text, const size_t length) {
+    if (buffer->length + length + 1 > buffer->capacity) {
+        while (buffer->length + length + 1 > buffer->capacity) {
+            buffer->capacity *= 2;
+        }
+        buffer->data = realloc(buffer->data, buffer->capacity);
+    }
+    memcpy(buffer->data + buffer->length, text, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = END_OF_FILE;
+}
+
+/**
+ * @brief Returns the next pseudo-random number (splitmix64).
+ *
+ * @param generator The generator.
+ * @return A uniformly distributed 64-bit number.
+ */
+static unsigned long long next_random(Generator *generator) {
+    unsigned long long z = generator->state += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ z >> 30) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ z >> 27) * 0x94D049BB133111EBULL;
+    return z ^ z >> 31;
+}
+
+/**
+ * @brief Returns a pseudo-random number in [0, 1).
+ */
+static double random_unit(Generator *generator) {
+    return (double) (next_random(generator) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief Returns a pseudo-random index in [0, count).
+ */
+static size_t random_index(Generator *generator, const size_t count) {
+    return (size_t) (next_random(generator) % count);
+}
+
+/**
+ * @brief Writes a random numeric constant, an integer or a number with two decimals.
+ */
+static void append_constant(Generator *generator, TextBuffer *buffer) {
+    char text[32];
+    int length;
+    if (random_unit(generator) < 0.5) {
+        length = snprintf(text, sizeof(text), "%d", (int) random_index(generator, 9) + 1);
+    } else {
+        length = snprintf(text, sizeof(text), "%d.%02d", (int) random_index(generator, 10),
+                          (int) random_index(generator, 100));
+    }
+    append_text(buffer, text, (size_t) length);
+}
+
+/**
+ * @brief Remembers a generated subtree so it can be repeated later.
+ */
+static void remember_subtree(Generator *generator, const char *text, const size_t length, const size_t nodes) {
+    if (length > GENERATOR_POOL_MAX_LENGTH || nodes < 2) return;
+
+    size_t slot = generator->pool_count;
+    if (slot == GENERATOR_POOL_SIZE) {
+        slot = random_index(generator, GENERATOR_POOL_SIZE);
+        free(generator->pool[slot]);
+    } else {
+        generator->pool_count++;
+    }
+    generator->pool[slot] = malloc(length + 1);
+    memcpy(generator->pool[slot], text, length);
+    generator->pool[slot][length] = END_OF_FILE;
+    generator->pool_nodes[slot] = nodes;
+}
+
+/**
+ * @brief Writes a random subtree.
+ *
+ * @param generator The generator.
+ * @param buffer    The buffer the subtree is appended to.
+ * @param budget    The number of nodes the subtree should have, at least 1.
+ * @param depth     The depth of the subtree in the expression.
+ * @return The number of nodes that were written.
+ */
+static size_t append_subtree(Generator *generator, TextBuffer *buffer, const size_t budget, const size_t depth) {
+    const GeneratorOptions *options = &generator->options;
+    const size_t start = buffer->length;
+    size_t nodes;
+
+    // Repeat an earlier subtree that fits into the budget, combined with a new subtree for the rest of the budget
+    if (generator->pool_count > 0 && budget > 1 && random_unit(generator) < options->duplicates) {
+        const size_t slot = random_index(generator, generator->pool_count);
+        if (generator->pool_nodes[slot] <= budget) {
+            const size_t rest = budget - generator->pool_nodes[slot];
+            nodes = generator->pool_nodes[slot];
+            if (rest == 0) {
+                append_text(buffer, generator->pool[slot], strlen(generator->pool[slot]));
+                return nodes;
+            }
+            append_text(buffer, "(", 1);
+            if (rest == 1) {
+                append_text(buffer, "-", 1);
+                append_text(buffer, generator->pool[slot], strlen(generator->pool[slot]));
+                nodes++;
+            } else {
+                // Any binary operator except the power, whose exponent is always a constant
+                const char operator = GENERATOR_OPERATORS[random_index(generator, GENERATOR_OPERATOR_COUNT - 1)];
+                append_text(buffer, generator->pool[slot], strlen(generator->pool[slot]));
+                append_text(buffer, &operator, 1);
+                nodes += 1 + append_subtree(generator, buffer, rest - 1, depth + 1);
+            }
+            append_text(buffer, ")", 1);
+            return nodes;
+        }
+    }
+
+    if (budget == 1 || depth >= options->depth) {
+        if (random_unit(generator) < options->constants) {
+            append_constant(generator, buffer);
+        } else {
+            append_text(buffer, X, strlen(X));
+        }
+        return 1;
+    }
+
+    if (budget >= 5 && random_unit(generator) < options->poles) {
+        // (<subtree>/(x-c)) has a pole at the grid value c
+        char pole[48];
+        append_text(buffer, "(", 1);
+        nodes = 4 + append_subtree(generator, buffer, budget - 4, depth + 1);
+        const int length = snprintf(pole, sizeof(pole), "/(x-%d.%d))", (int) random_index(generator, 10),
+                                    (int) random_index(generator, 2) * 5);
+        append_text(buffer, pole, (size_t) length);
+    } else if (budget == 2 || random_unit(generator) < options->functions) {
+        const char *function = GENERATOR_FUNCTIONS[random_index(generator, GENERATOR_FUNCTION_COUNT)];
+        if (function[0] == END_OF_FILE) {
+            append_text(buffer, "(-", 2);
+        } else {
+            append_text(buffer, function, strlen(function));
+            append_text(buffer, "(", 1);
+        }
+        nodes = 1 + append_subtree(generator, buffer, budget - 1, depth + 1);
+        append_text(buffer, ")", 1);
+    } else {
+        const char operator = GENERATOR_OPERATORS[random_index(generator, GENERATOR_OPERATOR_COUNT)];
+        append_text(buffer, "(", 1);
+        if (operator == POWER) {
+            // Small integer exponents keep the values finite
+            char exponent[8];
+            nodes = 2 + append_subtree(generator, buffer, budget - 2, depth + 1);
+            const int length = snprintf(exponent, sizeof(exponent), "^%d)", (int) random_index(generator, 4) + 1);
+            append_text(buffer, exponent, (size_t) length);
+        } else {
+            const size_t left_budget = 1 + random_index(generator, budget - 2);
+            nodes = 1 + append_subtree(generator, buffer, left_budget, depth + 1);
+            append_text(buffer, &operator, 1);
+            nodes += append_subtree(generator, buffer, budget - 1 - left_budget, depth + 1);
+            append_text(buffer, ")", 1);
+        }
+    }
+
+    remember_subtree(generator, buffer->data + start, buffer->length - start, nodes);
+    return nodes;
+}
+
+void initialize_generator_options(GeneratorOptions *options) {
+    options->nodes = 100;
+    options->depth = 64;
+    options->functions = 0.3;
+    options->constants = 0.3;
+    options->duplicates = 0.0;
+    options->poles = 0.0;
+}
+
+void initialize_generator(Generator *generator, const GeneratorOptions *options, const unsigned long long seed) {
+    generator->options = *options;
+    generator->state = seed;
+    generator->pool_count = 0;
+}
+
+char *generate_expression(Generator *generator, size_t *nodes) {
+    TextBuffer buffer = {malloc(64), 0, 64};
+    buffer.data[0] = END_OF_FILE;
+
+    // Duplicates are only taken from the same expression
+    for (size_t i = 0; i < generator->pool_count; i++) {
+        free(generator->pool[i]);
+    }
+    generator->pool_count = 0;
+
+    const size_t written = append_subtree(generator, &buffer, generator->options.nodes ? generator->options.nodes : 1, 0);
+    if (nodes) {
+        *nodes = written;
+    }
+    return buffer.data;
+}
+
+void free_generator(Generator *generator) {
+    for (size_t i = 0; i < generator->pool_count; i++) {
+        free(generator->pool[i]);
+    }
+    generator->pool_count = 0;
+}
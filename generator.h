@@ -0,0 +1,93 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stddef.h>
+
+/**
+ * @brief Number of generated subtrees remembered for reuse as duplicated subexpressions.
+ */
+#define GENERATOR_POOL_SIZE 64
+
+/**
+ * @brief Longest subtree (in characters) that is remembered for reuse.
+ */
+#define GENERATOR_POOL_MAX_LENGTH 4096
+
+/**
+ * @brief Shape of the generated expressions.
+ *
+ * @struct GeneratorOptions
+ * @member nodes      The number of nodes of every expression. It is reached exactly unless `depth` is too small.
+ * @member depth      The maximum depth of the tree, subtrees at this depth are single leaves.
+ * @member functions  The fraction of the inner nodes that are functions (or unary minus) instead of binary operators.
+ * @member constants  The fraction of the leaves that are numeric constants instead of 'x'.
+ * @member duplicates The probability that a subtree repeats an earlier subtree of the same expression.
+ * @member poles      The probability that a binary operator is a division by (x - c), which has a pole at x = c.
+ */
+typedef struct GeneratorOptions {
+    size_t nodes;
+    size_t depth;
+    double functions;
+    double constants;
+    double duplicates;
+    double poles;
+} GeneratorOptions;
+
+/**
+ * @brief State of the expression generator.
+ *
+ * The generator uses its own pseudo-random number generator, so the same seed and options produce the same
+ * expressions on every platform.
+ *
+ * @struct Generator
+ * @member options    The shape of the expressions.
+ * @member state      The state of the pseudo-random number generator.
+ * @member pool       Subtrees of the current expression that may be repeated.
+ * @member pool_nodes The number of nodes of every subtree in the pool.
+ * @member pool_count The number of subtrees in the pool.
+ */
+typedef struct Generator {
+    GeneratorOptions options;
+    unsigned long long state;
+    char *pool[GENERATOR_POOL_SIZE];
+    size_t pool_nodes[GENERATOR_POOL_SIZE];
+    size_t pool_count;
+} Generator;
+
+/**
+ * @brief Sets the options to the defaults: 100 nodes, depth 64, 30 % functions, 30 % constants, no duplicates
+ *        and no poles.
+ *
+ * @param options A pointer to the options to be initialized.
+ */
+void initialize_generator_options(GeneratorOptions *options);
+
+/**
+ * @brief Initializes a generator.
+ *
+ * @param generator A pointer to the generator to be initialized.
+ * @param options   The shape of the expressions.
+ * @param seed      The seed of the pseudo-random number generator.
+ */
+void initialize_generator(Generator *generator, const GeneratorOptions *options, unsigned long long seed);
+
+/**
+ * @brief Generates one random expression.
+ *
+ * The expression is valid for `parse()` and uses every supported function and operator. Binary operators are
+ * always parenthesised, so the generated tree does not depend on operator priorities.
+ *
+ * @param generator The generator.
+ * @param nodes     Set to the number of nodes of the parsed expression, may be NULL.
+ * @return The expression, to be released with free().
+ */
+char *generate_expression(Generator *generator, size_t *nodes);
+
+/**
+ * @brief Releases the memory held by a generator.
+ *
+ * @param generator The generator.
+ */
+void free_generator(Generator *generator);
+
+#endif //GENERATOR_H
@@ -1,11 +1,17 @@
 #include "lexer.h"
 
 Lexer *initialize_lexer(const char *text) {
+    return initialize_scratch_lexer(text, NULL);
+}
+
+Lexer *initialize_scratch_lexer(const char *text, Arena *arena) {
     if (!are_brackets_balanced(text)) {
         error_exit(ERROR_BRACKETS_TEXT, ERROR_FUNCTION);
     }
-    Lexer *lexer = malloc(sizeof(Lexer));
+    Lexer *lexer = arena ? arena_allocate(arena, sizeof(Lexer)) : malloc(sizeof(Lexer));
+    lexer->arena = arena;
     lexer->text = text;
+    lexer->length = strlen(text);
     lexer->pos = 0;
     lexer->current_char = text[0];
 
@@ -13,26 +19,36 @@ Lexer *initialize_lexer(const char *text) {
 }
 
 int are_brackets_balanced(const char *expression) {
+    return expression[unbalanced_bracket(expression)] == END_OF_FILE;
+}
+
+size_t unbalanced_bracket(const char *expression) {
     int top = 0;
+    size_t outermost = 0;
 
-    for (int i = 0; expression[i] != END_OF_FILE; i++) {
+    size_t i = 0;
+    for (; expression[i] != END_OF_FILE; i++) {
         const char current = expression[i];
 
         if (current == LEFT_PAREN) {
+            if (top == 0) {
+                outermost = i;
+            }
             top++;
         } else if (current == RIGHT_PAREN) {
             if (top == 0) {
-                return 0;
+                return i;
             }
             top--;
         }
     }
-    return top == 0;
+    // The outermost bracket opened last is the first one that is never closed
+    return top == 0 ? i : outermost;
 }
 
 void advance(Lexer *lexer) {
     lexer->pos++;
-    if (lexer->pos < strlen(lexer->text)) {
+    if (lexer->pos < lexer->length) {
         lexer->current_char = lexer->text[lexer->pos];
     } else {
         lexer->current_char = END_OF_FILE;
@@ -121,7 +137,7 @@ Token process_identifier(Lexer *lexer) {
         return (Token){TOKEN_ERROR};
     }
     token.func[len] = END_OF_FILE;
-    if (strcmp(token.func, X) == 0) {
+    if (strcmp(token.func, X) == 0 || parameter_index(token.func) != -1) {
         token.type = TOKEN_ID;
         return token;
     }
@@ -145,6 +161,12 @@ Token process_identifier(Lexer *lexer) {
     return (Token){TOKEN_ERROR};
 }
 
+int parameter_index(const char *name) {
+    if (strcmp(name, PARAMETER_A) == 0) return 0;
+    if (strcmp(name, PARAMETER_B) == 0) return 1;
+    if (strcmp(name, PARAMETER_T) == 0) return 2;
+    return -1;
+}
 
 int is_operator(const char c) {
     return c == PLUS || c == MINUS || c == MULT || c == DIVISION || c == POWER;
@@ -184,20 +206,21 @@ Token get_next_token(Lexer *lexer) {
             continue;
         }
 
+        const size_t start = lexer->pos;
+        Token token;
         if (isdigit(lexer->current_char) || lexer->current_char == DOT) {
-            return process_number(lexer);
-        }
-
-        if (isalpha(lexer->current_char)) {
-            return process_identifier(lexer);
-        }
-        if (is_operator(lexer->current_char)) {
-            return process_operator(lexer);
-        }
-        if (is_bracket(lexer->current_char)) {
-            return process_bracket(lexer);
+            token = process_number(lexer);
+        } else if (isalpha(lexer->current_char)) {
+            token = process_identifier(lexer);
+        } else if (is_operator(lexer->current_char)) {
+            token = process_operator(lexer);
+        } else if (is_bracket(lexer->current_char)) {
+            token = process_bracket(lexer);
+        } else {
+            token = (Token){TOKEN_ERROR};
         }
-        return (Token){TOKEN_ERROR};
+        token.start = start;
+        return token;
     }
-    return (Token){TOKEN_ERROR};
+    return (Token){TOKEN_ERROR, .start = lexer->pos};
 }
@@ -5,6 +5,7 @@
 #include <math.h>
 #include <string.h>
 #include "err.h"
+#include "arena.h"
 
 /**
  * @brief Defines string constants for mathematical functions.
@@ -48,6 +49,13 @@
 #define RIGHT_PAREN ')'
 #define DOT '.'
 
+/**
+ * @brief Defines the character separating several expressions drawn into one graph.
+ *
+ * The separator is not a token. The expressions are split before lexing and each one is lexed on its own.
+ */
+#define EXPRESSION_SEPARATOR ';'
+
 /**
  * @brief Defines the character for the variable 'x' used in mathematical functions.
  *
@@ -55,6 +63,21 @@
  */
 #define X "x"
 
+/**
+ * @brief Defines the names of the sweepable parameters.
+ *
+ * Besides 'x', an expression may reference the named parameters 'a', 'b' and 't'. Their values are constant
+ * for a whole frame and can be swept over a range to produce one frame per value.
+ */
+#define PARAMETER_A "a"
+#define PARAMETER_B "b"
+#define PARAMETER_T "t"
+
+/**
+ * @brief Number of named parameters an expression may reference.
+ */
+#define PARAMETER_COUNT 3
+
 /**
  * @brief Defines the end-of-file character.
  *
@@ -91,6 +114,13 @@ typedef struct Lexer {
      */
     const char *text;
 
+    /**
+     * @brief Length of the text.
+     *
+     * The text is measured once, so that advancing does not take time proportional to its length.
+     */
+    size_t length;
+
     /**
      * @brief Current position in the text.
      *
@@ -104,6 +134,14 @@ typedef struct Lexer {
      * This is the character currently being examined in the text at the position specified by `pos`.
      */
     char current_char;
+
+    /**
+     * @brief Arena the lexer and the nodes of the parsed tree are allocated from.
+     *
+     * NULL if they are allocated with `malloc()`. A tree allocated from an arena is released with the arena
+     * and must not be passed to `free_node()`.
+     */
+    Arena *arena;
 } Lexer;
 
 
@@ -220,6 +258,13 @@ typedef struct Token {
         char id[MAX_IDENTIFIER_LENGTH]; /**< The identifier name if the token is an identifier. */
         char func[MAX_IDENTIFIER_LENGTH]; /**< The function name if the token is a function. */
     };
+
+    /**
+     * @brief Offset of the first character of the token in the lexed text.
+     *
+     * Set by `get_next_token()` and used to map the nodes of the syntax tree back to the expression.
+     */
+    size_t start;
 } Token;
 
 
@@ -235,6 +280,18 @@ typedef struct Token {
  */
 Lexer *initialize_lexer(const char *text);
 
+/**
+ * @brief Initializes a lexer whose state and parsed tree are allocated from an arena.
+ *
+ * Like `initialize_lexer()`, but neither the lexer nor the nodes created by `parse()` are allocated with
+ * `malloc()`. Both stay valid until the arena is reset and are not freed on their own.
+ *
+ * @param text  The mathematical expression to be tokenized.
+ * @param arena The arena.
+ * @return A pointer to the initialized Lexer structure.
+ */
+Lexer *initialize_scratch_lexer(const char *text, Arena *arena);
+
 /**
  * @brief Advances the lexer to the next character in the text.
  *
@@ -337,6 +394,15 @@ int is_bracket(char c);
  */
 int are_brackets_balanced(const char *expression);
 
+/**
+ * @brief Finds the first bracket of the given expression that has no partner.
+ *
+ * @param expression The expression to be checked for balanced brackets.
+ * @return The offset of the first closing bracket without an opening one or of the first opening bracket that is
+ *         never closed, or the length of the expression if the brackets are balanced.
+ */
+size_t unbalanced_bracket(const char *expression);
+
 /**
  * @brief Retrieves the next token from the expression.
  *
@@ -350,5 +416,16 @@ int are_brackets_balanced(const char *expression);
  */
 Token get_next_token(Lexer *lexer);
 
+/**
+ * @brief Maps an identifier to the index of the named parameter it refers to.
+ *
+ * Parameters are numbered in the order 'a', 'b', 't', which is also the order of the values in every
+ * parameter array used by the evaluator and the compiler.
+ *
+ * @param name The identifier to be looked up.
+ * @return The index of the parameter (0 to PARAMETER_COUNT - 1), or -1 if the identifier is not a parameter.
+ */
+int parameter_index(const char *name);
+
 
 #endif // LEXER_H
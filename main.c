@@ -1,4 +1,10 @@
 #include "draw_utils.h"
+#include "profiler.h"
+#include "serve.h"
+#include "sampler.h"
+#include "sample_codec.h"
+#include "source.h"
+#include "tuning.h"
 
 /**
  * @brief Static variables used for storing global states in the program.
@@ -30,12 +36,145 @@ static FILE *output_file;
 static Lexer *lexer;
 
 /**
- * @brief Pointer to the abstract syntax tree (AST).
+ * @brief Text of the expressions, taken from the argument, a file or the standard input.
+ *
+ * Several expressions separated by ';' are drawn into the same graph. The separators in this text are
+ * replaced by '\0', so every expression can be lexed in place, also in a mapped file.
+ */
+static ExpressionSource expressions;
+
+/**
+ * @brief Array of the abstract syntax trees (AST), one per expression.
  *
  * The AST is used to represent the structure of the mathematical expression, where each node
- * corresponds to an operator, operand, or function. It is used by the evaluator to compute function values.
+ * corresponds to an operator, operand, or function. It is used by the compiler to build the program.
+ */
+static Node **abstract_syntax_trees;
+
+/**
+ * @brief Number of expressions and abstract syntax trees.
+ */
+static size_t expression_count;
+
+/**
+ * @brief Pointer to the compiled program of all expressions.
+ *
+ * All expressions are compiled into one fused program, so subexpressions they share are evaluated once per point.
+ */
+static Program *program;
+
+/**
+ * @brief Values of the named parameters and the optional sweep over one of them.
+ *
+ * Filled from the --param and --sweep options. Without them every parameter is 0 and a single frame is drawn.
+ */
+static Sweep sweep;
+
+/**
+ * @brief Prefixes of the supported command-line options.
+ */
+#define OPTION_PARAM "--param="
+#define OPTION_SWEEP "--sweep="
+#define OPTION_PERF_COUNTERS "--perf-counters"
+#define OPTION_STATS "--stats"
+#define OPTION_TRACE "--trace="
+#define OPTION_PROFILE "--profile"
+#define OPTION_RECURRENCES "--recurrences"
+#define OPTION_NARROW_KERNELS "--narrow-kernels"
+#define OPTION_BINARY_PATHS "--binary-paths"
+#define OPTION_SERVE "--serve"
+#define OPTION_JOB_LIMITS "--job-limits="
+#define OPTION_WORKERS "--workers"
+#define OPTION_EXPORT_SAMPLES "--export-samples="
+#define OPTION_SAMPLE_ENCODING "--sample-encoding="
+#define OPTION_BATCH_WINDOW "--batch-window="
+#define OPTION_TUNE "--tune"
+
+/**
+ * @brief 1 if hardware performance counters are reported per stage.
+ */
+static int perf_counters_requested;
+
+/**
+ * @brief 1 if run statistics are reported, see --stats.
  */
-static Node *abstract_syntax_tree;
+static int stats_requested;
+
+/**
+ * @brief File the statistics are written to as JSON, NULL to print them as a table on the standard error output.
+ */
+static const char *stats_file_name;
+
+/**
+ * @brief File the timeline of the phases is written to in the Chrome trace-event format, NULL if not traced.
+ */
+static const char *trace_file_name;
+
+/**
+ * @brief 1 if the expressions are profiled per node of the abstract syntax tree, see --profile.
+ */
+static int profile_requested;
+
+/**
+ * @brief File the profile is written to as folded stacks, NULL to print it as an annotated tree.
+ */
+static const char *profile_file_name;
+
+/**
+ * @brief 1 if sin, cos and exp of affine arguments are evaluated by recurrence, see --recurrences.
+ */
+static int recurrences_requested;
+
+/**
+ * @brief 1 if sin and cos of arguments proven inside [-pi, pi] use the narrow kernels, see --narrow-kernels.
+ */
+static int narrow_kernels_requested;
+
+/**
+ * @brief 1 if the path data is written as PostScript Level 2 binary tokens, see --binary-paths.
+ */
+static int binary_paths_requested;
+
+/**
+ * @brief File the requests of the long-running mode are read from, "-" for the standard input, NULL if not serving.
+ */
+static const char *serve_input_name;
+
+/**
+ * @brief Settings of the long-running mode, see --serve, --job-limits and --batch-window.
+ */
+static ServeSettings serve_settings = {{DEFAULT_INTERACTIVE_LIMIT, DEFAULT_BATCH_LIMIT}, 0, 0, 0, 0,
+                                      DEFAULT_BATCH_WINDOW * 1e-6};
+
+/**
+ * @brief 1 if the long-running mode uses one worker per usable CPU, see --workers.
+ */
+static int workers_per_cpu;
+
+/**
+ * @brief File the samples of the curves are exported to in the compressed sample format, NULL if not exported.
+ */
+static const char *export_file_name;
+
+/**
+ * @brief Encoding of the exported samples, see --sample-encoding.
+ */
+static SampleEncoding export_encoding = SAMPLE_ENCODING_XOR;
+
+/**
+ * @brief 1 if the settings are measured and written as the tuning profile of this machine, see --tune.
+ */
+static int tune_requested;
+
+/**
+ * @brief File the tuning profile is written to, NULL for the profile of this machine, see `tuning_profile_path()`.
+ */
+static const char *tune_file_name;
+
+/**
+ * @brief Settings loaded from the tuning profile of this machine at startup.
+ */
+static TuningProfile tuning;
 
 /**
  * @brief Cleans up the allocated memory and resources.
@@ -48,8 +187,17 @@ void cleanup() {
     if (lexer) {
         free(lexer);
     }
-    if (abstract_syntax_tree) {
-        free_node(abstract_syntax_tree);
+    if (abstract_syntax_trees) {
+        for (size_t i = 0; i < expression_count; i++) {
+            free_node(abstract_syntax_trees[i]);
+        }
+        free(abstract_syntax_trees);
+    }
+    if (expressions.text) {
+        close_expression_source(&expressions);
+    }
+    if (program) {
+        free_program(program);
     }
 
     if (limits) {
@@ -58,15 +206,302 @@ void cleanup() {
     if (output_file) {
         fclose(output_file);
     }
+    free_trace();
+}
+
+/**
+ * @brief Names of the supported command-line options, as matched by `is_option()`.
+ */
+static const char *OPTION_NAMES[] = {
+    OPTION_PARAM, OPTION_SWEEP, OPTION_PERF_COUNTERS, OPTION_STATS, OPTION_TRACE, OPTION_PROFILE,
+    OPTION_RECURRENCES, OPTION_NARROW_KERNELS, OPTION_BINARY_PATHS, OPTION_SERVE, OPTION_JOB_LIMITS,
+    OPTION_WORKERS, OPTION_EXPORT_SAMPLES, OPTION_SAMPLE_ENCODING, OPTION_BATCH_WINDOW, OPTION_TUNE
+};
+
+/**
+ * @brief Checks whether an argument names a supported option.
+ *
+ * An argument is an option if it starts with the name of one, followed by its value or by '=' or nothing for
+ * names without a value. Everything else is positional, so expressions such as "--x" keep working.
+ *
+ * @param argument The command-line argument.
+ * @return 1 if the argument is an option, 0 otherwise.
+ */
+static int is_option(const char *argument) {
+    for (size_t i = 0; i < sizeof(OPTION_NAMES) / sizeof(OPTION_NAMES[0]); i++) {
+        const size_t length = strlen(OPTION_NAMES[i]);
+        if (strncmp(argument, OPTION_NAMES[i], length) != 0) continue;
+        if (OPTION_NAMES[i][length - 1] == '=' || argument[length] == END_OF_FILE || argument[length] == '=') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Parses one command-line option and stores its value.
+ *
+ * @param option An argument accepted by `is_option()`.
+ *
+ * @note Exits the program with an error if the option is unknown or its value is malformed.
+ */
+static void parse_option(const char *option) {
+    if (strncmp(option, OPTION_PARAM, strlen(OPTION_PARAM)) == 0) {
+        if (parse_parameter(option + strlen(OPTION_PARAM), &sweep) == 1) {
+            error_exit(ERROR_SWEEP_TEXT, ERROR_SWEEP);
+        }
+    } else if (strncmp(option, OPTION_SWEEP, strlen(OPTION_SWEEP)) == 0) {
+        if (parse_sweep(option + strlen(OPTION_SWEEP), &sweep) == 1) {
+            error_exit(ERROR_SWEEP_TEXT, ERROR_SWEEP);
+        }
+    } else if (strcmp(option, OPTION_PERF_COUNTERS) == 0) {
+        perf_counters_requested = 1;
+    } else if (strcmp(option, OPTION_STATS) == 0) {
+        stats_requested = 1;
+    } else if (strncmp(option, OPTION_STATS "=", strlen(OPTION_STATS "=")) == 0 &&
+               option[strlen(OPTION_STATS "=")] != END_OF_FILE) {
+        stats_requested = 1;
+        stats_file_name = option + strlen(OPTION_STATS "=");
+    } else if (strncmp(option, OPTION_TRACE, strlen(OPTION_TRACE)) == 0 && option[strlen(OPTION_TRACE)] != END_OF_FILE) {
+        trace_file_name = option + strlen(OPTION_TRACE);
+    } else if (strcmp(option, OPTION_PROFILE) == 0) {
+        profile_requested = 1;
+    } else if (strncmp(option, OPTION_PROFILE "=", strlen(OPTION_PROFILE "=")) == 0 &&
+               option[strlen(OPTION_PROFILE "=")] != END_OF_FILE) {
+        profile_requested = 1;
+        profile_file_name = option + strlen(OPTION_PROFILE "=");
+    } else if (strcmp(option, OPTION_RECURRENCES) == 0) {
+        recurrences_requested = 1;
+    } else if (strcmp(option, OPTION_NARROW_KERNELS) == 0) {
+        narrow_kernels_requested = 1;
+    } else if (strcmp(option, OPTION_BINARY_PATHS) == 0) {
+        binary_paths_requested = 1;
+    } else if (strcmp(option, OPTION_SERVE) == 0) {
+        serve_input_name = STANDARD_INPUT_NAME;
+    } else if (strncmp(option, OPTION_SERVE "=", strlen(OPTION_SERVE "=")) == 0 &&
+               option[strlen(OPTION_SERVE "=")] != END_OF_FILE) {
+        serve_input_name = option + strlen(OPTION_SERVE "=");
+    } else if (strncmp(option, OPTION_JOB_LIMITS, strlen(OPTION_JOB_LIMITS)) == 0) {
+        if (parse_job_limits(option + strlen(OPTION_JOB_LIMITS), serve_settings.limits) == 1) {
+            error_exit(ERROR_JOB_LIMITS_TEXT, ERROR_ARGS);
+        }
+    } else if (strcmp(option, OPTION_WORKERS) == 0) {
+        workers_per_cpu = 1;
+    } else if (strncmp(option, OPTION_WORKERS "=", strlen(OPTION_WORKERS "=")) == 0) {
+        char *endptr;
+        const long workers = strtol(option + strlen(OPTION_WORKERS "="), &endptr, 10);
+        if (*endptr != END_OF_FILE || workers < 1) {
+            error_exit(ERROR_WORKERS_TEXT, ERROR_ARGS);
+        }
+        serve_settings.workers = (size_t) workers;
+    } else if (strcmp(option, OPTION_TUNE) == 0) {
+        tune_requested = 1;
+    } else if (strncmp(option, OPTION_TUNE "=", strlen(OPTION_TUNE "=")) == 0 &&
+               option[strlen(OPTION_TUNE "=")] != END_OF_FILE) {
+        tune_requested = 1;
+        tune_file_name = option + strlen(OPTION_TUNE "=");
+    } else if (strncmp(option, OPTION_BATCH_WINDOW, strlen(OPTION_BATCH_WINDOW)) == 0) {
+        char *endptr;
+        const double window = strtod(option + strlen(OPTION_BATCH_WINDOW), &endptr);
+        if (endptr == option + strlen(OPTION_BATCH_WINDOW) || *endptr != END_OF_FILE || !(window >= 0.0)) {
+            error_exit(ERROR_BATCH_WINDOW_TEXT, ERROR_ARGS);
+        }
+        serve_settings.batch_window = window * 1e-6;
+    } else if (strncmp(option, OPTION_EXPORT_SAMPLES, strlen(OPTION_EXPORT_SAMPLES)) == 0 &&
+               option[strlen(OPTION_EXPORT_SAMPLES)] != END_OF_FILE) {
+        export_file_name = option + strlen(OPTION_EXPORT_SAMPLES);
+    } else if (strncmp(option, OPTION_SAMPLE_ENCODING, strlen(OPTION_SAMPLE_ENCODING)) == 0) {
+        if (parse_sample_encoding(option + strlen(OPTION_SAMPLE_ENCODING), &export_encoding) == 1) {
+            error_exit(ERROR_SAMPLE_ENCODING_TEXT, ERROR_ARGS);
+        }
+    } else {
+        error_exit(ERROR_OPTION_TEXT, ERROR_ARGS);
+    }
+}
+
+/**
+ * @brief Profiles every expression over the sampling grid and reports the counters of every node.
+ *
+ * The profile is printed as an annotated tree on the standard error output, or written as folded stacks
+ * if a file was given with --profile=<file>. The parameters keep their fixed values.
+ */
+static void profile_expressions(void) {
+    FILE *file = stderr;
+    const char *text = expressions.text;
+
+    if (profile_file_name) {
+        file = fopen(profile_file_name, "w");
+        if (!file) {
+            error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+        }
+    }
+    for (size_t i = 0; i < expression_count; i++) {
+        Profile *profile = create_profile(abstract_syntax_trees[i], text);
+        profile_grid(profile, limits, sweep.parameters);
+        if (profile_file_name) {
+            write_profile_folded(profile, file);
+        } else {
+            print_profile_tree(profile, file);
+        }
+        free_profile(profile);
+        text += strlen(text) + 1; // The expressions were split in place
+    }
+    if (profile_file_name) {
+        fclose(file);
+    }
+}
+
+/**
+ * @brief Exports the samples of all curves over the grid into the file given with --export-samples=<file>.
+ *
+ * The curves are sampled again with the fixed values of the parameters, so a sweep exports its first frame only
+ * if the swept parameter starts at its fixed value.
+ */
+static void export_samples(void) {
+    FILE *file = fopen(export_file_name, "wb");
+    if (!file) {
+        error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+    }
+
+    SamplerOptions options = {{0}, recurrences_requested, narrow_kernels_requested};
+    memcpy(options.parameters, sweep.parameters, sizeof(options.parameters));
+    Sampler *sampler = sampler_open_program(compile_expressions(abstract_syntax_trees, expression_count), limits,
+                                            &options);
+    const size_t result_count = sampler_result_count(sampler);
+    double *xs = malloc(SAMPLE_FILE_BLOCK * sizeof(double));
+    double *ys = malloc((result_count ? result_count : 1) * SAMPLE_FILE_BLOCK * sizeof(double));
+
+    SampleWriter writer;
+    begin_sample_file(&writer, file, limits, result_count, export_encoding);
+    size_t count;
+    while ((count = sampler_next_block(sampler, xs, ys, NULL, SAMPLE_FILE_BLOCK)) > 0) {
+        write_samples(&writer, xs, ys, count, SAMPLE_FILE_BLOCK);
+    }
+    end_sample_file(&writer);
+
+    free(xs);
+    free(ys);
+    sampler_close(sampler);
+    fclose(file);
+}
+
+/**
+ * @brief Writes the statistics, the hardware counters and the trace of the run as requested by the options.
+ */
+static void write_reports(void) {
+    if (stats_requested) {
+        if (stats_file_name) {
+            FILE *stats_file = fopen(stats_file_name, "w");
+            if (!stats_file) {
+                error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+            }
+            write_stats_json(stats_file);
+            fclose(stats_file);
+        } else {
+            print_stats(stderr);
+        }
+    } else if (perf_counters_requested) {
+        print_perf_report(stderr);
+    }
+
+    if (trace_file_name) {
+        FILE *trace_file = fopen(trace_file_name, "w");
+        if (!trace_file) {
+            error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+        }
+        write_trace(trace_file);
+        fclose(trace_file);
+    }
+}
+
+/**
+ * @brief Loads the tuning profile of this machine, if there is one, and applies its settings.
+ */
+static void load_tuning(void) {
+    char *path = tuning_profile_path();
+    initialize_tuning_profile(&tuning);
+    if (path && load_tuning_profile(path, &tuning) == 2) {
+        print_warning(WARNING_TUNING_TEXT);
+        initialize_tuning_profile(&tuning);
+    }
+    free(path);
+    set_evaluation_block(tuning.evaluation_block);
+}
+
+/**
+ * @brief Measures the settings of this machine and writes them as its tuning profile, see --tune.
+ */
+static void run_tuner(void) {
+    char *path = tune_file_name ? NULL : tuning_profile_path();
+    const char *target = tune_file_name ? tune_file_name : path;
+    if (!target) {
+        error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+    }
+
+    tune(&tuning, stderr);
+    if (write_tuning_profile(target, &tuning) == 1) {
+        free(path);
+        error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+    }
+    fprintf(stderr, "tuning profile written to %s\n", target);
+    free(path);
+}
+
+/**
+ * @brief Runs the long-running mode, which renders the requests read from --serve instead of the arguments.
+ */
+static void run_server(void) {
+    serve_settings.recurrences = recurrences_requested;
+    serve_settings.narrow_kernels = narrow_kernels_requested;
+    serve_settings.binary_paths = binary_paths_requested;
+    serve_settings.output_buffer = tuning.output_buffer;
+    if (workers_per_cpu && tuning.workers) {
+        serve_settings.workers = tuning.workers;
+    } else if (workers_per_cpu) {
+        Topology topology;
+        detect_topology(&topology);
+        serve_settings.workers = topology.cpu_count;
+        free_topology(&topology);
+    }
+    if (binary_paths_requested) {
+        set_path_encoding(PATH_ENCODING_BINARY);
+    }
+    if (perf_counters_requested) {
+        enable_perf_counters();
+    }
+    if (trace_file_name) {
+        enable_tracing();
+    }
+
+    serve(serve_input_name, &serve_settings, stats_requested && !stats_file_name);
+    write_reports();
 }
 
 /**
  * @brief Main function for parsing an expression, evaluating it, and generating a graphical representation.
  *
  * The program expects the following command-line arguments:
- * - The mathematical expression to be parsed and evaluated.
+ * - The mathematical expression to be parsed and evaluated. Several expressions separated by ';' are drawn together.
+ *   "@<file>" reads the expressions from a file, "-" from the standard input.
  * - The output file name where the graphical representation will be saved.
  * - Optional argument: A string defining the limits for the graph (in the form of x_min,x_max,y_min,y_max).
+ * - Optional options: --param=<name>:<value> fixes a parameter, --sweep=<name>:<from>:<to>:<frames> draws one page
+ *   per value of a swept parameter, --perf-counters reports hardware counters per stage on the standard error output,
+ *   --stats[=<file.json>] reports time per stage and counts of the run as a table or into a JSON file,
+ *   --trace=<file.json> records the timeline of the phases for chrome://tracing,
+ *   --profile[=<file.folded>] profiles every node of the expressions as an annotated tree or as folded stacks,
+ *   --recurrences evaluates sin, cos and exp of affine arguments by recurrence within a bounded drift,
+ *   --narrow-kernels evaluates sin and cos of arguments proven inside [-pi, pi] without range reduction,
+ *   --binary-paths writes the curves as PostScript Level 2 binary tokens instead of ASCII numbers,
+ *   --serve[=<requests>] renders the requests read from a file or the standard input instead of the arguments,
+ *   --job-limits=<interactive>:<batch> sets how many jobs of every priority class are in progress at once,
+ *   --workers[=<n>] serves with n worker threads pinned to the CPUs across the NUMA nodes, one per CPU by default,
+ *   --export-samples=<file> also writes the samples of the curves into a compressed sample file,
+ *   --sample-encoding=<xor|quantised> stores the exported values losslessly or as rounded page coordinates,
+ *   --batch-window=<microseconds> collects the point queries of the long-running mode for that long and evaluates
+ *   them together, 50 by default,
+ *   --tune[=<file>] measures the fastest settings of this machine and writes them as the tuning profile, which
+ *   every other run loads at startup.
  *
  * The program performs the following tasks:
  * 1. Initializes limits for the graph.
@@ -80,35 +515,144 @@ void cleanup() {
  */
 int main(const int argc, char *argv[]) {
     atexit(cleanup);
+    const char *arguments[3];
+    int argument_count = 0;
+
+    // Known options may appear anywhere, everything else is positional
+    initialize_sweep(&sweep);
+    for (int i = 1; i < argc; i++) {
+        if (is_option(argv[i])) {
+            parse_option(argv[i]);
+        } else if (argument_count < 3) {
+            arguments[argument_count++] = argv[i];
+        } else {
+            error_exit(ERROR_ARGS_TEXT,ERROR_ARGS);
+        }
+    }
+
+    // The tuner measures its own corpus, every other run uses its results
+    if (tune_requested) {
+        if (argument_count != 0) {
+            error_exit(ERROR_ARGS_TEXT,ERROR_ARGS);
+        }
+        run_tuner();
+        return 0;
+    }
+    load_tuning();
+
+    // The long-running mode takes everything else from its requests
+    if (serve_input_name) {
+        if (argument_count != 0) {
+            error_exit(ERROR_ARGS_TEXT,ERROR_ARGS);
+        }
+        run_server();
+        return 0;
+    }
+
     // Necessary arguments check
-    if (argc < 3) {
+    if (argument_count < 2) {
         error_exit(ERROR_ARGS_TEXT,ERROR_ARGS);
     }
 
-    const char *expression = argv[1];
-    const char *output_file_name = argv[2];
+    const char *expression = arguments[0];
+    const char *output_file_name = arguments[1];
 
     // Default values for limits
     limits = initialize_limits();
 
     // If limits were defined in arguments
-    if (argc == 4) {
-        if (parse_limits(argv[3], limits) == 1) {
+    if (argument_count == 3) {
+        if (parse_limits(arguments[2], limits) == 1) {
             error_exit(ERROR_LIMITS_TEXT,ERROR_LIMITS);
         }
     }
 
-    // Open .ps file for write mode
-    output_file = fopen(output_file_name, "w");
+    // Open .ps file for write mode, binary tokens must not be translated
+    output_file = fopen(output_file_name, binary_paths_requested ? "wb" : "w");
     if (!output_file) {
         error_exit(ERROR_FILE_TEXT, ERROR_FILE);
     }
+    if (tuning.output_buffer) {
+        setvbuf(output_file, NULL, _IOFBF, tuning.output_buffer);
+    }
 
-    lexer = initialize_lexer(expression);
+    if (binary_paths_requested) {
+        set_path_encoding(PATH_ENCODING_BINARY);
+    }
+    if (perf_counters_requested) {
+        enable_perf_counters();
+    }
+    if (trace_file_name) {
+        enable_tracing();
+    }
+
+    // Split the text into the individual expressions
+    if (open_expression_source(expression, &expressions) == 1) {
+        error_exit(ERROR_SOURCE_TEXT, ERROR_FILE);
+    }
+    expression_count = 1;
+    for (char *c = expressions.text; *c != END_OF_FILE; c++) {
+        if (*c == EXPRESSION_SEPARATOR) {
+            expression_count++;
+        }
+    }
+    abstract_syntax_trees = calloc(expression_count, sizeof(Node *));
+
+    char *start = expressions.text;
+    for (size_t i = 0; i < expression_count; i++) {
+        char *end = strchr(start, EXPRESSION_SEPARATOR);
+        if (end) {
+            *end = END_OF_FILE;
+        }
 
-    abstract_syntax_tree = parse(lexer);
+        stage_begin(STAGE_LEX);
+        lexer = initialize_lexer(start);
+        stage_end(STAGE_LEX);
 
-    draw_graph(limits, output_file, abstract_syntax_tree);
+        stage_begin(STAGE_PARSE);
+        abstract_syntax_trees[i] = parse(lexer);
+        stage_end(STAGE_PARSE);
+        run_stats.ast_nodes += count_nodes(abstract_syntax_trees[i]);
+        free(lexer);
+        lexer = NULL;
+
+        start = end ? end + 1 : start;
+    }
+
+    stage_begin(STAGE_COMPILE);
+    program = compile_expressions(abstract_syntax_trees, expression_count);
+    if (recurrences_requested) {
+        enable_recurrences(program, X_EVALUATION_STEP);
+    }
+    specialise_ranges(program, limits, narrow_kernels_requested);
+    stage_end(STAGE_COMPILE);
+    run_stats.instructions = program->length;
+
+    int uses_parameters = 0;
+    for (size_t i = 0; i < program->result_count; i++) {
+        uses_parameters |= program->code[program->results[i]].dependency & DEPENDS_ON_PARAMETERS;
+    }
+    if (sweep.parameter == -1 && !uses_parameters) {
+        draw_graph(limits, output_file, program);
+    } else {
+        draw_sweep(limits, output_file, program, &sweep);
+    }
+
+    stage_begin(STAGE_FLUSH);
+    fflush(output_file);
+    stage_end(STAGE_FLUSH);
+    const long bytes_written = ftell(output_file);
+    run_stats.bytes_written = bytes_written > 0 ? (unsigned long long) bytes_written : 0;
+
+    if (export_file_name) {
+        export_samples();
+    }
+
+    write_reports();
+
+    if (profile_requested) {
+        profile_expressions();
+    }
 
     return 0;
 }
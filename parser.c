@@ -1,17 +1,65 @@
 #include "parser.h"
 
 
+/**
+ * @brief Allocates a node of the tree, from the arena of the lexer if it has one.
+ */
+static Node *allocate_node(const Lexer *lexer) {
+    return lexer->arena ? arena_allocate(lexer->arena, sizeof(Node)) : malloc(sizeof(Node));
+}
+
 Node *parse(Lexer *lexer) {
     Node *node = parse_low_priority_expression(lexer);
-    const size_t length = strlen(lexer->text);
-    if (lexer->pos != length - 1) {
-        free_node(node);
+    if (lexer->pos != lexer->length - 1) {
+        if (!lexer->arena) {
+            free_node(node);
+        }
         error_exit(ERROR_EXPRESSION_TEXT, ERROR_FUNCTION);
     }
     return node;
 }
 
+/**
+ * @brief Finds the first node of a tree that can not be compiled.
+ *
+ * @param node           The root of the subtree.
+ * @param error_position Set to the position of the problem in the expression if there is one.
+ * @return 1 if the subtree is malformed, 0 otherwise.
+ */
+static int find_malformed_node(const Node *node, size_t *error_position) {
+    if (node->type == NODE_ERROR) {
+        *error_position = node->start;
+        return 1;
+    }
+    if (node->type == NODE_FUNC) {
+        if (!node->func.arg) {
+            *error_position = node->end; // A function name without an argument
+            return 1;
+        }
+        return find_malformed_node(node->func.arg, error_position);
+    }
+    if (node->type == NODE_OP) {
+        return (node->op.left && find_malformed_node(node->op.left, error_position)) ||
+               find_malformed_node(node->op.right, error_position);
+    }
+    return 0;
+}
 
+Node *try_parse(Lexer *lexer, size_t *error_position) {
+    Node *node = parse_low_priority_expression(lexer);
+    size_t position = lexer->pos;
+    if (lexer->pos == lexer->length - 1 && !find_malformed_node(node, &position)) {
+        return node;
+    }
+
+    if (!lexer->arena) {
+        free_node(node);
+    }
+    if (error_position) {
+        *error_position = position;
+    }
+    return NULL;
+}
 
 Node *parse_low_priority_expression(Lexer *lexer) {
     Node *node = parse_high_priority_expression(lexer);  // Start by parsing high priority expressions
@@ -20,7 +68,7 @@ Node *parse_low_priority_expression(Lexer *lexer) {
 
     // Handle low priority operations: addition and subtraction
     while (token.type == TOKEN_PLUS || token.type == TOKEN_MINUS) {
-        Node *new_node = malloc(sizeof(Node));
+        Node *new_node = allocate_node(lexer);
         new_node->type = NODE_OP;
         if (token.type == TOKEN_PLUS) {
             new_node->op.op = PLUS;
@@ -30,6 +78,8 @@ Node *parse_low_priority_expression(Lexer *lexer) {
         // Continue parsing after the operator
         new_node->op.left = node;
         new_node->op.right = parse_high_priority_expression(lexer);
+        new_node->start = node->start;
+        new_node->end = new_node->op.right->end;
         node = new_node;
         token = get_next_token(lexer);
     }
@@ -48,7 +98,7 @@ Node *parse_high_priority_expression(Lexer *lexer) {
 
     // Handle high priority operations: multiplication, division, exponentiation
     while (token.type == TOKEN_MUL || token.type == TOKEN_DIV || token.type == TOKEN_POW) {
-        Node *new_node = malloc(sizeof(Node));
+        Node *new_node = allocate_node(lexer);
         new_node->type = NODE_OP;
 
         if (token.type == TOKEN_MUL) {
@@ -62,6 +112,8 @@ Node *parse_high_priority_expression(Lexer *lexer) {
         // Continue parsing after the operator
         new_node->op.left = node;
         new_node->op.right = parse_operand(lexer);
+        new_node->start = node->start;
+        new_node->end = new_node->op.right->end;
         node = new_node;
         token = get_next_token(lexer);
     }
@@ -78,26 +130,35 @@ Node *parse_operand(Lexer *lexer) {
 
     // Handle unary minus
     if (token.type == TOKEN_MINUS) {
-        node = (Node *) malloc(sizeof(Node));
+        node = allocate_node(lexer);
         node->type = NODE_OP;
         node->op.op = MINUS;
         node->op.left = NULL;  // No left operand for unary operator
         node->op.right = parse_operand(lexer);  // Parse the right operand
+        node->start = token.start;
+        node->end = node->op.right->end;
     } else if (token.type == TOKEN_NUM) {
         // Handle numeric literals
-        node = (Node *) malloc(sizeof(Node));
+        node = allocate_node(lexer);
         node->type = NODE_NUM;
         node->num = token.num;
+        node->start = token.start;
+        node->end = lexer->pos;
     } else if (token.type == TOKEN_ID) {
         // Handle identifiers
-        node = (Node *) malloc(sizeof(Node));
+        node = allocate_node(lexer);
         node->type = NODE_ID;
         strcpy(node->id, token.id);
+        node->start = token.start;
+        node->end = lexer->pos;
     } else if (token.type == TOKEN_FUNC) {
         // Handle function calls
-        node = (Node *) malloc(sizeof(Node));
+        node = allocate_node(lexer);
         node->type = NODE_FUNC;
         strcpy(node->func.func, token.func);
+        node->func.arg = NULL;
+        node->start = token.start;
+        node->end = lexer->pos;
         // Expect '('
         token = get_next_token(lexer);
         if (token.type != TOKEN_LPAREN) {
@@ -106,21 +167,28 @@ Node *parse_operand(Lexer *lexer) {
         // Parse function argument
         node->func.arg = parse_low_priority_expression(lexer);
         token = get_next_token(lexer);
+        node->end = lexer->pos;
         // Expect ')'
         if (token.type != TOKEN_RPAREN) {
             return node;
         }
     } else if (token.type == TOKEN_LPAREN) {
         // Handle expressions in parentheses
+        const size_t start = token.start;
         node = parse_low_priority_expression(lexer);
         token = get_next_token(lexer);
         // Expect ')'
         if (token.type != TOKEN_RPAREN) {
             return node;
         }
+        // The span of a parenthesised expression includes the brackets
+        node->start = start;
+        node->end = lexer->pos;
     } else {
-        node = (Node *) malloc(sizeof(Node));
+        node = allocate_node(lexer);
         node->type = NODE_ERROR;
+        node->start = token.start;
+        node->end = lexer->pos;
         return node;
     }
     return node;
@@ -138,3 +206,14 @@ void free_node(Node *node) {
     }
     free(node);
 }
+
+size_t count_nodes(const Node *node) {
+    if (node == NULL) return 0;
+    if (node->type == NODE_OP) {
+        return 1 + count_nodes(node->op.left) + count_nodes(node->op.right);
+    }
+    if (node->type == NODE_FUNC) {
+        return 1 + count_nodes(node->func.arg);
+    }
+    return 1;
+}
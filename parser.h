@@ -15,7 +15,7 @@ typedef struct Node {
     // The type of the node (number, variable, function, operator, or error)
     enum type {
         NODE_NUM, /**< Numeric constant */
-        NODE_ID, /**< Variable identifier ("x") */
+        NODE_ID, /**< Variable identifier ("x") or named parameter ("a", "b", "t") */
         NODE_FUNC, /**< Mathematical function (e.g., sin, cos) */
         NODE_OP, /**< Operator (e.g., +, -, *, /) */
         NODE_ERROR /**< Error node */
@@ -24,7 +24,7 @@ typedef struct Node {
     // A union that holds different data depending on the node type
     union {
         double num; /**< For nodes of type NODE_NUM (number) */
-        char id[MAX_IDENTIFIER_LENGTH]; /**< For nodes of type NODE_ID (identifier, e.g., "x") */
+        char id[MAX_IDENTIFIER_LENGTH]; /**< For nodes of type NODE_ID (identifier, e.g., "x" or "t") */
 
         // For function nodes (NODE_FUNC), stores the function name and the argument node
         struct {
@@ -39,6 +39,10 @@ typedef struct Node {
             struct Node *right; /**< Pointer to the right operand */
         } op;
     };
+
+    // Part of the expression string the node was parsed from, used to report results per subexpression
+    size_t start; /**< Offset of the first character of the node in the expression */
+    size_t end; /**< Offset one past the last character of the node in the expression */
 } Node;
 
 /**
@@ -53,6 +57,20 @@ typedef struct Node {
  */
 Node *parse(Lexer *lexer);
 
+/**
+ * @brief Parses a mathematical expression from the lexer without ending the program on malformed input.
+ *
+ * Besides the remaining characters that `parse()` rejects, the parsed tree is checked for every problem that would
+ * end the program later on, such as a missing operand or a function name without an argument. This is the parser
+ * for expressions that arrive while the program runs, e.g. the requests of the long-running mode.
+ *
+ * @param lexer          A pointer to the lexer, which contains the expression to be parsed.
+ * @param error_position Set to the offset of the problem in the expression if it is malformed, or NULL.
+ * @return A pointer to the root node of the parsed abstract syntax tree (AST), or NULL if the expression is
+ *         malformed. A malformed tree allocated with `malloc()` is freed.
+ */
+Node *try_parse(Lexer *lexer, size_t *error_position);
+
 /**
  * @brief Parses low priority expressions (addition and subtraction) in the mathematical expression.
  *
@@ -96,7 +114,17 @@ Node *parse_operand(Lexer *lexer);
  * such as operations (which have left and right children), functions (which have arguments), and leaf nodes (numbers and identifiers).
  *
  * @param node A pointer to the node to be freed.
+ *
+ * @note A tree parsed with a lexer from `initialize_scratch_lexer()` is released with its arena instead.
  */
 void free_node(Node *node);
 
+/**
+ * @brief Counts the nodes of an Abstract Syntax Tree (AST).
+ *
+ * @param node A pointer to the root node of the tree, NULL for an empty tree.
+ * @return The number of nodes in the tree.
+ */
+size_t count_nodes(const Node *node);
+
 #endif //PARSER_H
@@ -0,0 +1,109 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <string.h>
+#include "perf_counters.h"
+
+const char *perf_event_name(const PerfEvent event) {
+    switch (event) {
+        case PERF_CYCLES: return "cycles";
+        case PERF_INSTRUCTIONS: return "instructions";
+        case PERF_BRANCH_MISSES: return "branch_misses";
+        case PERF_L1D_MISSES: return "l1d_misses";
+        case PERF_LLC_MISSES: return "llc_misses";
+        case PERF_FRONTEND_STALLS: return "frontend_stalls";
+        default: return "unknown";
+    }
+}
+
+#ifdef __linux__
+/**
+ * @brief Opens a single user-space counter of the calling thread.
+ *
+ * @param type   The perf event type.
+ * @param config The perf event configuration.
+ * @return The file descriptor of the counter, or -1 if it could not be opened.
+ */
+static int open_counter(const unsigned int type, const unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    const long fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    return fd < 0 ? -1 : (int) fd;
+}
+
+int open_perf_counters(PerfCounters *counters) {
+    counters->fds[PERF_CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counters->fds[PERF_INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counters->fds[PERF_BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    counters->fds[PERF_L1D_MISSES] = open_counter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                                                      PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                                                      PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    counters->fds[PERF_LLC_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    counters->fds[PERF_FRONTEND_STALLS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND);
+
+    counters->available = 0;
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (counters->fds[i] != -1) {
+            counters->available++;
+        }
+    }
+    return counters->available;
+}
+
+void read_perf_counters(const PerfCounters *counters, long long *values) {
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        unsigned long long data[3]; // value, time enabled, time running
+        values[i] = PERF_UNAVAILABLE;
+        if (counters->fds[i] == -1 || read(counters->fds[i], data, sizeof(data)) != sizeof(data)) {
+            continue;
+        }
+        if (data[2] == 0) {
+            values[i] = 0;
+        } else if (data[2] < data[1]) {
+            // The counter was multiplexed, extrapolate to the whole time it was enabled
+            values[i] = (long long) ((double) data[0] * (double) data[1] / (double) data[2]);
+        } else {
+            values[i] = (long long) data[0];
+        }
+    }
+}
+
+void close_perf_counters(PerfCounters *counters) {
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (counters->fds[i] != -1) {
+            close(counters->fds[i]);
+            counters->fds[i] = -1;
+        }
+    }
+    counters->available = 0;
+}
+#else
+int open_perf_counters(PerfCounters *counters) {
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        counters->fds[i] = -1;
+    }
+    counters->available = 0;
+    return 0;
+}
+
+void read_perf_counters(const PerfCounters *counters, long long *values) {
+    (void) counters;
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        values[i] = PERF_UNAVAILABLE;
+    }
+}
+
+void close_perf_counters(PerfCounters *counters) {
+    counters->available = 0;
+}
+#endif
@@ -0,0 +1,76 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdio.h>
+
+/**
+ * @brief Hardware events counted by the performance counters.
+ *
+ * The events show what limits a stage: the instructions per cycle, branch mispredictions, cache misses
+ * at the first and the last level, and cycles in which the front end could not deliver instructions.
+ */
+typedef enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_FRONTEND_STALLS,
+    PERF_EVENT_COUNT
+} PerfEvent;
+
+/**
+ * @brief Value of a counter that could not be opened or read.
+ */
+#define PERF_UNAVAILABLE (-1LL)
+
+/**
+ * @brief A set of open performance counters of the calling thread.
+ *
+ * @struct PerfCounters
+ * @member fds The file descriptors of the counters, -1 for counters that are not available.
+ * @member available The number of counters that were opened.
+ */
+typedef struct PerfCounters {
+    int fds[PERF_EVENT_COUNT];
+    int available;
+} PerfCounters;
+
+/**
+ * @brief Opens one counter per event for the calling thread through `perf_event_open`.
+ *
+ * Only user-space events are counted, so no special privileges are needed on the usual kernel settings.
+ * Events the CPU or the kernel does not support are left unavailable without affecting the others.
+ * On systems without `perf_event_open` no counter is available.
+ *
+ * @param counters A pointer to the structure to be initialized.
+ * @return The number of counters that were opened, 0 if none is available.
+ */
+int open_perf_counters(PerfCounters *counters);
+
+/**
+ * @brief Reads the current values of all counters.
+ *
+ * Values are scaled up when the kernel had to multiplex the counters.
+ *
+ * @param counters The open counters.
+ * @param values   Output array of PERF_EVENT_COUNT values, PERF_UNAVAILABLE for counters that are not available.
+ */
+void read_perf_counters(const PerfCounters *counters, long long *values);
+
+/**
+ * @brief Closes all counters.
+ *
+ * @param counters The counters to be closed.
+ */
+void close_perf_counters(PerfCounters *counters);
+
+/**
+ * @brief Returns the name of an event as used in reports.
+ *
+ * @param event The event.
+ * @return The name of the event, e.g. "branch_misses".
+ */
+const char *perf_event_name(PerfEvent event);
+
+#endif //PERF_COUNTERS_H
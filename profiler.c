@@ -0,0 +1,266 @@
+#include "profiler.h"
+#include "timer.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define HAS_CYCLE_COUNTER 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_CYCLE_COUNTER 1
+#else
+#define HAS_CYCLE_COUNTER 0
+#endif
+
+/**
+ * @brief Unit of the values returned by `read_cycle_counter()`.
+ */
+#if HAS_CYCLE_COUNTER
+#define CYCLE_UNIT "cycles"
+#else
+#define CYCLE_UNIT "ns"
+#endif
+
+/**
+ * @brief Reads the time stamp counter, or the monotonic clock in nanoseconds where there is none.
+ *
+ * @return The current value of the counter.
+ */
+static unsigned long long read_cycle_counter(void) {
+#if HAS_CYCLE_COUNTER
+    return __rdtsc();
+#else
+    return (unsigned long long) (monotonic_seconds() * 1e9);
+#endif
+}
+
+/**
+ * @brief Adds the entries of a subtree to the profile in pre-order.
+ *
+ * @param profile The profile being built.
+ * @param node    The root of the subtree.
+ * @param depth   The depth of the node.
+ * @param parent  The index of the entry of the parent.
+ */
+static void add_entries(Profile *profile, const Node *node, const size_t depth, const size_t parent) {
+    if (node == NULL) return;
+
+    const size_t index = profile->count++;
+    ProfileEntry *entry = &profile->entries[index];
+    entry->node = node;
+    entry->depth = depth;
+    entry->parent = parent;
+    entry->evaluations = 0;
+    entry->cycles = 0;
+    entry->child_cycles = 0;
+    entry->nan_results = 0;
+    entry->domain_errors = 0;
+
+    if (node->type == NODE_OP) {
+        add_entries(profile, node->op.left, depth + 1, index);
+        add_entries(profile, node->op.right, depth + 1, index);
+    } else if (node->type == NODE_FUNC) {
+        add_entries(profile, node->func.arg, depth + 1, index);
+    }
+}
+
+Profile *create_profile(const Node *tree, const char *text) {
+    Profile *profile = malloc(sizeof(Profile));
+    const size_t count = count_nodes(tree);
+
+    profile->text = text;
+    profile->entries = malloc((count ? count : 1) * sizeof(ProfileEntry));
+    profile->count = 0;
+    add_entries(profile, tree, 0, 0);
+    return profile;
+}
+
+/**
+ * @brief Checks whether the argument of a function lies outside of its domain.
+ *
+ * @param name The name of the function.
+ * @param arg_value The value of the argument.
+ * @return 1 if the function is not defined (or has a pole) at the argument, 0 otherwise.
+ */
+static int function_domain_error(const char *name, const double arg_value) {
+    if (strcmp(name, LN) == 0 || strcmp(name, LOG) == 0) return arg_value <= 0.0;
+    if (strcmp(name, ASIN) == 0 || strcmp(name, ACOS) == 0) return fabs(arg_value) > 1.0;
+    return 0;
+}
+
+/**
+ * @brief Checks whether the operands of an operator lie outside of its domain.
+ *
+ * @param op The operator.
+ * @param left_value The value of the left operand.
+ * @param right_value The value of the right operand.
+ * @return 1 for a division by zero or a power that is not a real number, 0 otherwise.
+ */
+static int operator_domain_error(const char op, const double left_value, const double right_value) {
+    if (op == DIVISION) return right_value == 0.0;
+    if (op == POWER) {
+        return (left_value < 0.0 && right_value != floor(right_value)) || (left_value == 0.0 && right_value < 0.0);
+    }
+    return 0;
+}
+
+/**
+ * @brief Evaluates the subtree of an entry and updates the counters of all its entries.
+ *
+ * @param profile    The profile being filled.
+ * @param index      The index of the entry, it is advanced past the subtree.
+ * @param x_value    The value of 'x'.
+ * @param parameters The parameter values, or NULL.
+ * @param timed      1 if the cycles of this sample are measured.
+ * @return The value of the subtree.
+ */
+static double profile_node(Profile *profile, size_t *index, const double x_value, const double *parameters,
+                           const int timed) {
+    ProfileEntry *entry = &profile->entries[(*index)++];
+    const Node *node = entry->node;
+    const unsigned long long start = timed ? read_cycle_counter() : 0;
+    double result;
+    int arguments_nan = 0;
+
+    entry->evaluations++;
+    switch (node->type) {
+        case NODE_NUM:
+        case NODE_ID:
+            result = evaluate_with_parameters(node, x_value, parameters);
+            break;
+
+        case NODE_FUNC: {
+            const double arg_value = profile_node(profile, index, x_value, parameters, timed);
+            arguments_nan = isnan(arg_value);
+            if (!arguments_nan && function_domain_error(node->func.func, arg_value)) {
+                entry->domain_errors++;
+            }
+            result = apply_function(node->func.func, arg_value);
+            break;
+        }
+
+        case NODE_OP: {
+            const double left_value = node->op.left ? profile_node(profile, index, x_value, parameters, timed) : 0.0;
+            const double right_value = profile_node(profile, index, x_value, parameters, timed);
+            if (node->op.left == NULL) {
+                arguments_nan = isnan(right_value);
+                result = -right_value;
+                break;
+            }
+            arguments_nan = isnan(left_value) || isnan(right_value);
+            if (!arguments_nan && operator_domain_error(node->op.op, left_value, right_value)) {
+                entry->domain_errors++;
+            }
+            result = apply_operator(node->op.op, left_value, right_value);
+            break;
+        }
+
+        default:
+            error_exit(ERROR_UNKNOWN_NODE_TEXT, ERROR_FUNCTION);
+            return 0;
+    }
+
+    if (isnan(result) && !arguments_nan) {
+        entry->nan_results++;
+    }
+    if (timed) {
+        const unsigned long long cycles = read_cycle_counter() - start;
+        entry->cycles += cycles;
+        if (entry != profile->entries) {
+            profile->entries[entry->parent].child_cycles += cycles;
+        }
+    }
+    return result;
+}
+
+void profile_grid(Profile *profile, const Limits *limits, const double *parameters) {
+    double xs[SAMPLE_BLOCK_SIZE];
+    double cursor = limits->x_min;
+    size_t sample = 0;
+    size_t block;
+
+    if (profile->count == 0) return;
+    while ((block = next_sample_block(limits, &cursor, xs, SAMPLE_BLOCK_SIZE)) > 0) {
+        for (size_t i = 0; i < block; i++, sample++) {
+            size_t index = 0;
+            profile_node(profile, &index, xs[i], parameters, sample % PROFILE_TIMING_PERIOD == 0);
+        }
+    }
+}
+
+/**
+ * @brief Returns the cycles spent in an entry itself, scaled to all samples.
+ *
+ * @param entry The entry.
+ * @return The estimated cycles of the entry without its children.
+ */
+static unsigned long long self_cycles(const ProfileEntry *entry) {
+    if (entry->child_cycles > entry->cycles) return 0; // Counter noise on very cheap nodes
+    return (entry->cycles - entry->child_cycles) * PROFILE_TIMING_PERIOD;
+}
+
+/**
+ * @brief Writes the part of the expression a node was parsed from, shortened to PROFILE_LABEL_LENGTH.
+ *
+ * @param profile The profile.
+ * @param entry   The entry of the node.
+ * @param file    The file the label is written to.
+ */
+static void write_label(const Profile *profile, const ProfileEntry *entry, FILE *file) {
+    const size_t length = entry->node->end - entry->node->start;
+
+    if (length <= PROFILE_LABEL_LENGTH) {
+        fprintf(file, "%.*s", (int) length, profile->text + entry->node->start);
+    } else {
+        fprintf(file, "%.*s...", PROFILE_LABEL_LENGTH - 3, profile->text + entry->node->start);
+    }
+}
+
+void print_profile_tree(const Profile *profile, FILE *file) {
+    const unsigned long long total = profile->count ? profile->entries[0].cycles * PROFILE_TIMING_PERIOD : 0;
+
+    fprintf(file, "profile of \"%s\" (%s sampled every %d samples)\n", profile->text, CYCLE_UNIT,
+            PROFILE_TIMING_PERIOD);
+    fprintf(file, "%12s %14s %14s %7s %10s %10s  %s\n", "evaluations", "total", "self", "self%", "nan", "domain",
+            "node");
+    for (size_t i = 0; i < profile->count; i++) {
+        const ProfileEntry *entry = &profile->entries[i];
+        const unsigned long long self = self_cycles(entry);
+        fprintf(file, "%12llu %14llu %14llu %6.1f%% %10llu %10llu  %*s", entry->evaluations,
+                entry->cycles * PROFILE_TIMING_PERIOD, self, total ? 100.0 * (double) self / (double) total : 0.0,
+                entry->nan_results, entry->domain_errors, (int) (2 * entry->depth), "");
+        write_label(profile, entry, file);
+        fprintf(file, " [%zu:%zu]\n", entry->node->start, entry->node->end);
+    }
+}
+
+/**
+ * @brief Writes the stack of an entry, the labels of its ancestors and its own label separated by ';'.
+ *
+ * @param profile The profile.
+ * @param index   The index of the entry.
+ * @param file    The file the stack is written to.
+ */
+static void write_stack(const Profile *profile, const size_t index, FILE *file) {
+    const ProfileEntry *entry = &profile->entries[index];
+    if (index != 0) {
+        write_stack(profile, entry->parent, file);
+        fprintf(file, ";");
+    }
+    write_label(profile, entry, file);
+    fprintf(file, " [%zu:%zu]", entry->node->start, entry->node->end);
+}
+
+void write_profile_folded(const Profile *profile, FILE *file) {
+    for (size_t i = 0; i < profile->count; i++) {
+        const unsigned long long self = self_cycles(&profile->entries[i]);
+        if (self == 0) continue;
+        write_stack(profile, i, file);
+        fprintf(file, " %llu\n", self);
+    }
+}
+
+void free_profile(Profile *profile) {
+    if (profile == NULL) return;
+    free(profile->entries);
+    free(profile);
+}
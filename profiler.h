@@ -0,0 +1,108 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+#include "evaluator.h"
+#include "sampling.h"
+
+/**
+ * @brief Every how many samples of the grid the cycle counter is read.
+ *
+ * Reading the counter around every node would cost more than evaluating most nodes, so only every
+ * PROFILE_TIMING_PERIOD-th sample is timed and the cycles are scaled up by the period in the reports.
+ */
+#define PROFILE_TIMING_PERIOD 8
+
+/**
+ * @brief Maximum number of characters of the expression shown for one node in the reports.
+ */
+#define PROFILE_LABEL_LENGTH 60
+
+/**
+ * @brief Counters collected for one node of the abstract syntax tree.
+ *
+ * @struct ProfileEntry
+ * @member node The node, its span maps the entry back to the expression.
+ * @member depth The depth of the node in the tree, 0 for the root.
+ * @member parent The index of the parent entry, the own index for the root.
+ * @member evaluations How many times the node was evaluated.
+ * @member cycles The cycles spent in the node and its children during the timed samples.
+ * @member child_cycles The part of `cycles` that was spent in the children.
+ * @member nan_results How many times the node produced NaN from arguments that were not NaN.
+ * @member domain_errors How many times an argument was outside of the domain of the function or operator,
+ *                       e.g. ln of a negative number or a division by zero.
+ */
+typedef struct ProfileEntry {
+    const Node *node;
+    size_t depth;
+    size_t parent;
+    unsigned long long evaluations;
+    unsigned long long cycles;
+    unsigned long long child_cycles;
+    unsigned long long nan_results;
+    unsigned long long domain_errors;
+} ProfileEntry;
+
+/**
+ * @brief Execution profile of one expression.
+ *
+ * The entries are stored in pre-order, so the entries of the subtree of an entry directly follow it.
+ *
+ * @struct Profile
+ * @member text The expression the tree was parsed from, the node spans index into it.
+ * @member entries One entry per node of the tree.
+ * @member count The number of entries.
+ */
+typedef struct Profile {
+    const char *text;
+    ProfileEntry *entries;
+    size_t count;
+} Profile;
+
+/**
+ * @brief Creates an empty profile for an abstract syntax tree.
+ *
+ * @param tree The root of the tree to be profiled.
+ * @param text The expression the tree was parsed from.
+ * @return A pointer to the new profile, released with `free_profile()`.
+ */
+Profile *create_profile(const Node *tree, const char *text);
+
+/**
+ * @brief Evaluates the tree of the profile over the whole sampling grid and collects the counters.
+ *
+ * The tree is evaluated like `evaluate_with_parameters()`, one node at a time, so the counters of every
+ * node can be updated.
+ *
+ * @param profile    The profile to be filled.
+ * @param limits     A pointer to the Limits structure defining the sampling grid.
+ * @param parameters Array of PARAMETER_COUNT parameter values, or NULL to treat every parameter as 0.
+ */
+void profile_grid(Profile *profile, const Limits *limits, const double *parameters);
+
+/**
+ * @brief Prints the profile as a tree annotated with the counters of every node.
+ *
+ * @param profile The profile to be printed.
+ * @param file    The file the report is written to.
+ */
+void print_profile_tree(const Profile *profile, FILE *file);
+
+/**
+ * @brief Writes the profile as folded stacks, one line per node with the cycles spent in the node itself.
+ *
+ * The output can be turned into a flame graph with flamegraph.pl or loaded into speedscope.
+ *
+ * @param profile The profile to be written.
+ * @param file    The file the stacks are written to.
+ */
+void write_profile_folded(const Profile *profile, FILE *file);
+
+/**
+ * @brief Releases a profile.
+ *
+ * @param profile The profile to be released, may be NULL.
+ */
+void free_profile(Profile *profile);
+
+#endif //PROFILER_H
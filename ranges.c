@@ -0,0 +1,297 @@
+#include "ranges.h"
+#include "sampling.h"
+
+/**
+ * @brief Units in the last place every bound computed with libm is widened by.
+ *
+ * The basic operations are correctly rounded and rounding is monotonic, so their bounds need no widening.
+ * The functions of libm are not guaranteed to be either, but stay within one unit in the last place, and the
+ * narrow sin and cos kernels within two units of libm.
+ */
+#define LIBM_ULPS 4
+
+/**
+ * @brief Largest argument of the narrow sin and cos kernels, the double nearest to pi.
+ */
+#define NARROW_LIMIT 3.141592653589793116
+
+/**
+ * @brief Interval of a value about which nothing is known.
+ */
+static const Interval UNKNOWN = {-INFINITY, INFINITY, 1};
+
+/**
+ * @brief Moves a bound outwards by a number of units in the last place.
+ *
+ * @param value     The bound.
+ * @param direction -INFINITY for a lower bound, INFINITY for an upper bound.
+ * @param ulps      The number of units in the last place.
+ * @return The widened bound.
+ */
+static double widen(double value, const double direction, const int ulps) {
+    for (int i = 0; i < ulps; i++) {
+        value = nextafter(value, direction);
+    }
+    return value;
+}
+
+/**
+ * @brief Creates the interval of a libm function from the values at its extremes.
+ *
+ * @param lo  The smallest value of the function, as computed by libm.
+ * @param hi  The largest value of the function, as computed by libm.
+ * @param nan 1 if the function may return NaN.
+ * @return The widened interval.
+ */
+static Interval libm_interval(const double lo, const double hi, const int nan) {
+    return (Interval){widen(lo, -INFINITY, LIBM_ULPS), widen(hi, INFINITY, LIBM_ULPS), nan};
+}
+
+/**
+ * @brief Checks whether an interval contains a value.
+ */
+static int contains(const Interval a, const double value) {
+    return a.lo <= value && value <= a.hi;
+}
+
+/**
+ * @brief Checks whether a bound of an interval is infinite.
+ */
+static int unbounded(const Interval a) {
+    return isinf(a.lo) || isinf(a.hi);
+}
+
+/**
+ * @brief Checks whether an interval contains `offset + k * 2 * pi` for an integer k.
+ *
+ * A point missed through rounding lies within a few units in the last place of a bound, where the periodic
+ * functions are flat enough for the widened value at the bound to cover it.
+ */
+static int contains_period_point(const Interval a, const double offset) {
+    const double period = 2.0 * M_PI;
+    return floor((a.hi - offset) / period) >= ceil((a.lo - offset) / period);
+}
+
+/**
+ * @brief Creates the smallest interval containing four values of a monotonic operation at the corners.
+ *
+ * @param values The values at the corners of the operand intervals.
+ * @param nan    1 if the operation may return NaN.
+ * @return The interval, UNKNOWN if a corner is NaN.
+ */
+static Interval corners(const double values[4], const int nan) {
+    Interval result = {values[0], values[0], nan};
+    for (int i = 0; i < 4; i++) {
+        if (isnan(values[i])) return UNKNOWN;
+        result.lo = fmin(result.lo, values[i]);
+        result.hi = fmax(result.hi, values[i]);
+    }
+    return result;
+}
+
+/**
+ * @brief Computes the interval of a power.
+ *
+ * Integer exponents are handled for every base, other exponents only for positive bases.
+ */
+static Interval power_interval(const Interval base, const Interval exponent) {
+    const int nan = base.nan || exponent.nan;
+
+    if (exponent.lo == exponent.hi && exponent.lo == nearbyint(exponent.lo) && fabs(exponent.lo) < 1e15) {
+        const double n = exponent.lo;
+        const int even = fmod(n, 2.0) == 0.0;
+        if (n < 0.0 && contains(base, 0.0)) return UNKNOWN;
+        if (n == 0.0) return (Interval){1.0, 1.0, nan};
+
+        const double at_lo = pow(base.lo, n);
+        const double at_hi = pow(base.hi, n);
+        if (even && contains(base, 0.0)) {
+            return (Interval){0.0, widen(fmax(at_lo, at_hi), INFINITY, LIBM_ULPS), nan};
+        }
+        return libm_interval(fmin(at_lo, at_hi), fmax(at_lo, at_hi), nan);
+    }
+
+    if (base.lo > 0.0 && !unbounded(exponent)) {
+        // pow is monotonic in each operand for positive bases, so the extremes are at the corners
+        const double values[4] = {
+            pow(base.lo, exponent.lo), pow(base.lo, exponent.hi), pow(base.hi, exponent.lo), pow(base.hi, exponent.hi)
+        };
+        const Interval result = corners(values, nan);
+        return libm_interval(result.lo, result.hi, result.nan);
+    }
+    return UNKNOWN;
+}
+
+/**
+ * @brief Computes the interval of sin or cos.
+ *
+ * @param a      The interval of the argument.
+ * @param offset pi / 2 for sin, 0 for cos: the offset of the maxima from multiples of 2 * pi.
+ * @param at_lo  The function at the lower bound.
+ * @param at_hi  The function at the upper bound.
+ */
+static Interval periodic_interval(const Interval a, const double offset, const double at_lo, const double at_hi) {
+    if (unbounded(a)) return (Interval){-1.0, 1.0, 1};
+    if (a.hi - a.lo >= 2.0 * M_PI) return (Interval){-1.0, 1.0, a.nan};
+
+    Interval result = libm_interval(fmin(at_lo, at_hi), fmax(at_lo, at_hi), a.nan);
+    if (contains_period_point(a, offset)) result.hi = 1.0;
+    if (contains_period_point(a, offset + M_PI)) result.lo = -1.0;
+    result.lo = fmax(result.lo, -1.0);
+    result.hi = fmin(result.hi, 1.0);
+    return result;
+}
+
+/**
+ * @brief Computes the interval of tan, which is finite for every finite double.
+ */
+static Interval tan_interval(const Interval a) {
+    if (unbounded(a)) return UNKNOWN;
+
+    // Both bounds have to lie between the same two poles, which are at pi / 2 + k * pi
+    const double branch_lo = floor((a.lo + M_PI_2) / M_PI);
+    const double branch_hi = floor((a.hi + M_PI_2) / M_PI);
+    const double distance = fmin(a.lo - (branch_lo * M_PI - M_PI_2), (branch_hi + 1.0) * M_PI - M_PI_2 - a.hi);
+    if (branch_lo != branch_hi || distance < 1e-9) return (Interval){-INFINITY, INFINITY, a.nan};
+    return libm_interval(tan(a.lo), tan(a.hi), a.nan);
+}
+
+/**
+ * @brief Computes the interval of one instruction from the intervals of its operands.
+ *
+ * @param instruction The instruction.
+ * @param a           The interval of the first operand.
+ * @param b           The interval of the second operand of binary operations.
+ * @param limits      The limits defining the grid.
+ * @return The interval of the instruction.
+ */
+static Interval instruction_interval(const Instruction *instruction, const Interval a, const Interval b,
+                                     const Limits *limits) {
+    const int nan = a.nan || (operand_count(instruction->code) == 2 && b.nan);
+
+    switch (instruction->code) {
+        case OP_CONST:
+            return isnan(instruction->value)
+                       ? UNKNOWN
+                       : (Interval){instruction->value, instruction->value, 0};
+        case OP_X: return (Interval){limits->x_min, limits->x_max, 0};
+        case OP_PARAMETER: return UNKNOWN;
+        case OP_NEG: return (Interval){-a.hi, -a.lo, a.nan};
+        case OP_ADD:
+        case OP_SUB: {
+            // Subtraction adds the negated second operand, inf - inf is the only source of NaN
+            const Interval c = instruction->code == OP_ADD ? b : (Interval){-b.hi, -b.lo, b.nan};
+            const int infinite = (a.lo == -INFINITY && c.hi == INFINITY) || (a.hi == INFINITY && c.lo == -INFINITY);
+            if (infinite) return UNKNOWN;
+            return (Interval){a.lo + c.lo, a.hi + c.hi, nan};
+        }
+        case OP_MUL: {
+            const double values[4] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+            const int zero_times_infinity = (contains(a, 0.0) && unbounded(b)) || (contains(b, 0.0) && unbounded(a));
+            return corners(values, nan || zero_times_infinity);
+        }
+        case OP_DIV: {
+            if (contains(b, 0.0)) return UNKNOWN;
+            const double values[4] = {a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi};
+            return corners(values, nan || (unbounded(a) && unbounded(b)));
+        }
+        case OP_POW: return power_interval(a, b);
+        case OP_SIN:
+        case OP_SIN_NARROW: return periodic_interval(a, M_PI_2, sin(a.lo), sin(a.hi));
+        case OP_COS:
+        case OP_COS_NARROW: return periodic_interval(a, 0.0, cos(a.lo), cos(a.hi));
+        case OP_TAN: return tan_interval(a);
+        case OP_ABS:
+            if (a.lo >= 0.0) return a;
+            if (a.hi <= 0.0) return (Interval){-a.hi, -a.lo, a.nan};
+            return (Interval){0.0, fmax(-a.lo, a.hi), a.nan};
+        case OP_LN:
+        case OP_LOG: {
+            if (!(a.hi >= 0.0)) return UNKNOWN;
+            const double hi = instruction->code == OP_LN ? log(a.hi) : log10(a.hi);
+            if (a.lo <= 0.0) return (Interval){-INFINITY, widen(hi, INFINITY, LIBM_ULPS), nan || a.lo < 0.0};
+            return libm_interval(instruction->code == OP_LN ? log(a.lo) : log10(a.lo), hi, nan);
+        }
+        case OP_ASIN:
+        case OP_ACOS: {
+            if (!(a.hi >= -1.0 && a.lo <= 1.0)) return UNKNOWN;
+            const double lo = fmax(a.lo, -1.0);
+            const double hi = fmin(a.hi, 1.0);
+            const int outside = nan || a.lo < -1.0 || a.hi > 1.0;
+            return instruction->code == OP_ASIN
+                       ? libm_interval(asin(lo), asin(hi), outside)
+                       : libm_interval(acos(hi), acos(lo), outside);
+        }
+        case OP_ATAN: return libm_interval(atan(a.lo), atan(a.hi), nan);
+        case OP_SINH: return libm_interval(sinh(a.lo), sinh(a.hi), nan);
+        case OP_COSH:
+            if (contains(a, 0.0)) return libm_interval(1.0, fmax(cosh(a.lo), cosh(a.hi)), nan);
+            return libm_interval(fmin(cosh(a.lo), cosh(a.hi)), fmax(cosh(a.lo), cosh(a.hi)), nan);
+        case OP_TANH: return libm_interval(tanh(a.lo), tanh(a.hi), nan);
+        case OP_EXP: return libm_interval(exp(a.lo), exp(a.hi), nan);
+    }
+    return UNKNOWN;
+}
+
+/**
+ * @brief Widens the interval of an instruction evaluated by a recurrence by its drift bound.
+ */
+static Interval widen_recurrence(const Interval a, const Recurrence *recurrence, const Limits *limits) {
+    const double max_abs_x = fmax(fabs(limits->x_min), fabs(limits->x_max));
+    const double bound = recurrence_drift_bound(recurrence, X_EVALUATION_STEP, max_abs_x);
+    if (recurrence->kind == RECURRENCE_GROWTH) {
+        return (Interval){a.lo * (1.0 - bound), a.hi * (1.0 + bound), a.nan};
+    }
+    return (Interval){a.lo - bound, a.hi + bound, a.nan};
+}
+
+size_t specialise_ranges(Program *program, const Limits *limits, const int narrow) {
+    size_t specialised = 0;
+
+    // The length of a program never changes, so the intervals of an earlier call are overwritten
+    widen_kernels(program);
+    if (!program->ranges) {
+        program->ranges = malloc((program->length ? program->length : 1) * sizeof(Interval));
+    }
+
+    for (size_t i = 0; i < program->length; i++) {
+        Instruction *instruction = &program->code[i];
+        const int operands = operand_count(instruction->code);
+        const Interval a = operands >= 1 ? program->ranges[instruction->left] : UNKNOWN;
+        const Interval b = operands == 2 ? program->ranges[instruction->right] : UNKNOWN;
+        const int recurrent = program->recurrences && program->recurrences[i].kind != RECURRENCE_NONE;
+
+        program->ranges[i] = instruction_interval(instruction, a, b, limits);
+        if (recurrent) {
+            program->ranges[i] = widen_recurrence(program->ranges[i], &program->recurrences[i], limits);
+            continue;
+        }
+
+        if (narrow && (instruction->code == OP_SIN || instruction->code == OP_COS) && a.lo >= -NARROW_LIMIT &&
+            a.hi <= NARROW_LIMIT) {
+            instruction->code = instruction->code == OP_SIN ? OP_SIN_NARROW : OP_COS_NARROW;
+            specialised++;
+        }
+    }
+    return specialised;
+}
+
+size_t widen_kernels(Program *program) {
+    size_t widened = 0;
+
+    for (size_t i = 0; i < program->length; i++) {
+        Instruction *instruction = &program->code[i];
+        if (instruction->code == OP_SIN_NARROW || instruction->code == OP_COS_NARROW) {
+            instruction->code = instruction->code == OP_SIN_NARROW ? OP_SIN : OP_COS;
+            widened++;
+        }
+    }
+    return widened;
+}
+
+int proven_inside(const Program *program, const size_t result, const Limits *limits) {
+    if (program->ranges == NULL) return 0;
+
+    const Interval range = program->ranges[program->results[result]];
+    return !range.nan && range.lo >= limits->y_min && range.hi <= limits->y_max;
+}
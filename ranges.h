@@ -0,0 +1,51 @@
+#ifndef RANGES_H
+#define RANGES_H
+
+#include "compiler.h"
+#include "limits.h"
+
+/**
+ * @brief Proves the range of every instruction over the grid of the limits and specialises the program to it.
+ *
+ * The interval of 'x' given by the limits is pushed through the program in evaluation order with outward
+ * rounding, so every sample of the grid is guaranteed to lie inside the interval of its instruction. Parameters
+ * are not bounded. The intervals are stored in `program->ranges`.
+ *
+ * If requested, `sin` and `cos` whose argument is proven inside [-pi, pi] are switched to OP_SIN_NARROW and
+ * OP_COS_NARROW, which evaluate a polynomial without range reduction and without branches. Their results stay
+ * within a few units in the last place of libm, but not bit-identical to it.
+ *
+ * After this call the program must only be executed on x values inside of the limits. It may be specialised
+ * again for other limits: the kernels narrowed before are switched back first and the intervals are stored in
+ * the memory of the earlier call.
+ *
+ * @param program The compiled program.
+ * @param limits  The limits defining the grid.
+ * @param narrow  1 to switch sin and cos to the narrow kernels, 0 to only analyse the ranges.
+ * @return The number of instructions switched to a narrow kernel.
+ */
+size_t specialise_ranges(Program *program, const Limits *limits, int narrow);
+
+/**
+ * @brief Switches the narrow kernels of a specialised program back to sin and cos.
+ *
+ * The program may be executed on any x value again.
+ *
+ * @param program The program.
+ * @return The number of instructions switched back.
+ */
+size_t widen_kernels(Program *program);
+
+/**
+ * @brief Checks whether a result of the program is proven finite and inside the y limits on the whole grid.
+ *
+ * Such a result can not break its curve, so it is drawn without classifying its samples.
+ *
+ * @param program The program, specialised with `specialise_ranges()` or not.
+ * @param result  The index of the result.
+ * @param limits  The limits defining the grid.
+ * @return 1 if every value of the result is proven to be drawn, 0 otherwise (always 0 without ranges).
+ */
+int proven_inside(const Program *program, size_t result, const Limits *limits);
+
+#endif //RANGES_H
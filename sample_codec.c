@@ -0,0 +1,667 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sample_codec.h"
+#include "sampler.h"
+#include "sampling.h"
+#include "draw_utils.h"
+
+/**
+ * @brief Size of an entry of the block directory: the offset and the length of the block.
+ */
+#define DIRECTORY_ENTRY_SIZE 16
+
+/**
+ * @brief Names of the encodings, in the order of SampleEncoding.
+ */
+static const char *SAMPLE_ENCODING_NAMES[] = {"xor", "quantised"};
+
+int parse_sample_encoding(const char *name, SampleEncoding *encoding) {
+    for (int i = 0; i < 2; i++) {
+        if (strcmp(name, SAMPLE_ENCODING_NAMES[i]) == 0) {
+            *encoding = (SampleEncoding) i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Makes room for `extra` more bytes in a buffer.
+ */
+static void reserve_bytes(ByteBuffer *buffer, const size_t extra) {
+    if (buffer->length + extra <= buffer->capacity) return;
+    while (buffer->length + extra > buffer->capacity) {
+        buffer->capacity = buffer->capacity ? 2 * buffer->capacity : 4096;
+    }
+    buffer->data = realloc(buffer->data, buffer->capacity);
+}
+
+/**
+ * @brief Appends an unsigned integer of `size` bytes in little endian order.
+ */
+static void put_uint(ByteBuffer *buffer, uint64_t value, const size_t size) {
+    reserve_bytes(buffer, size);
+    for (size_t i = 0; i < size; i++) {
+        buffer->data[buffer->length++] = (unsigned char) value;
+        value >>= 8;
+    }
+}
+
+/**
+ * @brief Appends a double by its bits in little endian order.
+ */
+static void put_double(ByteBuffer *buffer, const double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_uint(buffer, bits, 8);
+}
+
+/**
+ * @brief Overwrites a 32-bit length that was reserved earlier.
+ */
+static void patch_length(ByteBuffer *buffer, const size_t at) {
+    uint64_t length = buffer->length - at - 4;
+    for (size_t i = 0; i < 4; i++) {
+        buffer->data[at + i] = (unsigned char) length;
+        length >>= 8;
+    }
+}
+
+/**
+ * @brief Appends an unsigned integer as LEB128 varint, 7 bits per byte.
+ */
+static void put_varint(ByteBuffer *buffer, uint64_t value) {
+    reserve_bytes(buffer, 10);
+    while (value >= 0x80) {
+        buffer->data[buffer->length++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    buffer->data[buffer->length++] = (unsigned char) value;
+}
+
+/**
+ * @brief Reads an unsigned integer of `size` bytes in little endian order.
+ */
+static uint64_t get_uint(const unsigned char *data, const size_t size) {
+    uint64_t value = 0;
+    for (size_t i = size; i-- > 0;) {
+        value = value << 8 | data[i];
+    }
+    return value;
+}
+
+/**
+ * @brief Reads a double by its bits in little endian order.
+ */
+static double get_double(const unsigned char *data) {
+    const uint64_t bits = get_uint(data, 8);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Writes bits most significant first into a buffer.
+ *
+ * @struct BitWriter
+ * @member buffer The buffer.
+ * @member bits The bits not yet appended, right aligned.
+ * @member count The number of bits in `bits`.
+ */
+typedef struct BitWriter {
+    ByteBuffer *buffer;
+    uint64_t bits;
+    int count;
+} BitWriter;
+
+/**
+ * @brief Writes the lowest `n` bits of a value, 1 <= n <= 64.
+ */
+static void put_bits(BitWriter *writer, const uint64_t value, int n) {
+    while (n > 0) {
+        const int take = n < 64 - writer->count ? n : 64 - writer->count;
+        const uint64_t chunk = take == 64 ? value : value >> (n - take) & ((1ULL << take) - 1);
+        writer->bits = take == 64 ? chunk : writer->bits << take | chunk;
+        writer->count += take;
+        n -= take;
+        if (writer->count == 64) {
+            reserve_bytes(writer->buffer, 8);
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                writer->buffer->data[writer->buffer->length++] = (unsigned char) (writer->bits >> shift);
+            }
+            writer->bits = 0;
+            writer->count = 0;
+        }
+    }
+}
+
+/**
+ * @brief Appends the remaining bits, padded with zeros to a whole byte.
+ */
+static void flush_bits(BitWriter *writer) {
+    if (writer->count % 8) {
+        put_bits(writer, 0, 8 - writer->count % 8);
+    }
+    reserve_bytes(writer->buffer, 8);
+    for (int shift = writer->count - 8; shift >= 0; shift -= 8) {
+        writer->buffer->data[writer->buffer->length++] = (unsigned char) (writer->bits >> shift);
+    }
+    writer->bits = 0;
+    writer->count = 0;
+}
+
+/**
+ * @brief Reads bits most significant first.
+ *
+ * @struct BitReader
+ * @member data The bytes.
+ * @member size The number of bytes.
+ * @member bit The position of the next bit.
+ */
+typedef struct BitReader {
+    const unsigned char *data;
+    size_t size;
+    size_t bit;
+} BitReader;
+
+/**
+ * @brief Reads the next `n` bits, 1 <= n <= 57, as zeros past the end of the data.
+ */
+static uint64_t get_bits(BitReader *reader, const int n) {
+    const size_t byte = reader->bit >> 3;
+    uint64_t word = 0;
+    if (byte + 8 <= reader->size) {
+        const unsigned char *bytes = reader->data + byte;
+        word = (uint64_t) bytes[0] << 56 | (uint64_t) bytes[1] << 48 | (uint64_t) bytes[2] << 40 |
+               (uint64_t) bytes[3] << 32 | (uint64_t) bytes[4] << 24 | (uint64_t) bytes[5] << 16 |
+               (uint64_t) bytes[6] << 8 | bytes[7];
+    } else {
+        for (size_t i = 0; i < 8; i++) word = word << 8 | (byte + i < reader->size ? reader->data[byte + i] : 0);
+    }
+    const uint64_t value = word << (reader->bit & 7) >> (64 - n);
+    reader->bit += (size_t) n;
+    return value;
+}
+
+/**
+ * @brief Reads the next `n` bits, 1 <= n <= 64.
+ */
+static uint64_t get_long_bits(BitReader *reader, const int n) {
+    if (n <= 57) return get_bits(reader, n);
+    const uint64_t high = get_bits(reader, n - 32);
+    return high << 32 | get_bits(reader, 32);
+}
+
+/**
+ * @brief Predicts a value from the two before it: their linear extrapolation, or the last value if it is not
+ * finite. Smooth curves leave a small difference whose XOR with the value has many leading zero bits.
+ */
+static double predict(const double last, const double before) {
+    if (!isfinite(last) || !isfinite(before)) return last;
+    const double prediction = 2.0 * last - before;
+    return isfinite(prediction) ? prediction : last;
+}
+
+/**
+ * @brief Leading and trailing zero bits of the XOR of the previous value that was not predicted exactly.
+ *
+ * @struct XorWindow
+ * @member leading The leading zero bits.
+ * @member trailing The trailing zero bits, 64 before the first window.
+ */
+typedef struct XorWindow {
+    int leading;
+    int trailing;
+} XorWindow;
+
+/**
+ * @brief Counts the leading zero bits of a nonzero value.
+ */
+static int leading_zeros(uint64_t value) {
+    int count = 0;
+    for (int shift = 32; shift > 0; shift /= 2) {
+        if (!(value >> (64 - shift))) {
+            value <<= shift;
+            count += shift;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Counts the trailing zero bits of a nonzero value.
+ */
+static int trailing_zeros(uint64_t value) {
+    int count = 0;
+    for (int shift = 32; shift > 0; shift /= 2) {
+        if (!(value << (64 - shift))) {
+            value >>= shift;
+            count += shift;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Encodes values losslessly as the XOR with their prediction, in the control codes of Gorilla.
+ *
+ * '0' stands for an exact prediction. '10' is followed by the meaningful bits of an XOR that fits the window
+ * of the previous one, '11' by 5 bits of leading zeros, 6 bits of the number of meaningful bits minus 1
+ * and the meaningful bits.
+ */
+static void encode_xor(ByteBuffer *buffer, const double *values, const size_t count) {
+    BitWriter writer = {buffer, 0, 0};
+    XorWindow window = {0, 64};
+    double last = 0.0;
+    double before = 0.0;
+
+    for (size_t i = 0; i < count; i++) {
+        const double prediction = predict(last, before);
+        uint64_t bits;
+        uint64_t predicted;
+        memcpy(&bits, &values[i], sizeof(bits));
+        memcpy(&predicted, &prediction, sizeof(predicted));
+        const uint64_t difference = bits ^ predicted;
+
+        if (!difference) {
+            put_bits(&writer, 0, 1);
+        } else {
+            int leading = leading_zeros(difference);
+            const int trailing = trailing_zeros(difference);
+            leading = leading > 31 ? 31 : leading;
+            if (window.trailing < 64 && leading >= window.leading && trailing >= window.trailing) {
+                put_bits(&writer, 2, 2);
+                const int meaningful = 64 - window.leading - window.trailing;
+                put_bits(&writer, difference >> window.trailing, meaningful);
+            } else {
+                const int meaningful = 64 - leading - trailing;
+                put_bits(&writer, 3, 2);
+                put_bits(&writer, (uint64_t) leading, 5);
+                put_bits(&writer, (uint64_t) (meaningful - 1), 6);
+                put_bits(&writer, difference >> trailing, meaningful);
+                window = (XorWindow) {leading, trailing};
+            }
+        }
+        before = last;
+        last = values[i];
+    }
+    flush_bits(&writer);
+}
+
+/**
+ * @brief Decodes values written by `encode_xor()`.
+ *
+ * @return 0 on success, 1 if the data ends early.
+ */
+static int decode_xor(const unsigned char *data, const size_t size, double *values, const size_t count) {
+    BitReader reader = {data, size, 0};
+    XorWindow window = {0, 64};
+    double last = 0.0;
+    double before = 0.0;
+
+    for (size_t i = 0; i < count; i++) {
+        const double prediction = predict(last, before);
+        uint64_t bits;
+        memcpy(&bits, &prediction, sizeof(bits));
+
+        if (get_bits(&reader, 1)) {
+            if (get_bits(&reader, 1)) {
+                window.leading = (int) get_bits(&reader, 5);
+                const int meaningful = (int) get_bits(&reader, 6) + 1;
+                window.trailing = 64 - window.leading - meaningful;
+                if (window.trailing < 0) return 1;
+            } else if (window.trailing == 64) {
+                return 1; // No window yet
+            }
+            const int meaningful = 64 - window.leading - window.trailing;
+            bits ^= get_long_bits(&reader, meaningful) << window.trailing;
+        }
+        memcpy(&values[i], &bits, sizeof(bits));
+        before = last;
+        last = values[i];
+    }
+    return reader.bit > 8 * size;
+}
+
+/**
+ * @brief Returns the scaling factor for the y-axis of the page.
+ */
+static double page_scale_y(const Limits *limits) {
+    return (PAGE_HEIGHT - PAGE_MARGIN) / (limits->y_max - limits->y_min);
+}
+
+/**
+ * @brief Encodes the drawn values as page coordinates in steps of 1 / SAMPLE_QUANTUM, as zigzag varints of their
+ * second differences, which are close to 0 along smooth curves.
+ */
+static void encode_quantised(ByteBuffer *buffer, const Limits *limits, const double *values,
+                             const unsigned char *flags, const size_t count) {
+    const double factor = page_scale_y(limits) * SAMPLE_QUANTUM;
+    int64_t last = 0;
+    int64_t delta = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!(flags[i] & SAMPLE_DRAWN)) continue;
+        const int64_t quantised = llround((values[i] - limits->y_min) * factor);
+        const int64_t second = quantised - last - delta;
+        put_varint(buffer, (uint64_t) second << 1 ^ (uint64_t) (second >> 63));
+        delta = quantised - last;
+        last = quantised;
+    }
+}
+
+/**
+ * @brief Decodes values written by `encode_quantised()`, NaN where a curve is not drawn.
+ *
+ * @return 0 on success, 1 if the data ends early.
+ */
+static int decode_quantised(const unsigned char *data, const size_t size, const Limits *limits, double *values,
+                            const unsigned char *flags, const size_t count) {
+    const double step = 1.0 / (page_scale_y(limits) * SAMPLE_QUANTUM);
+    size_t position = 0;
+    int64_t last = 0;
+    int64_t delta = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!(flags[i] & SAMPLE_DRAWN)) {
+            values[i] = NAN;
+            continue;
+        }
+        uint64_t zigzag = 0;
+        int shift = 0;
+        unsigned char byte;
+        do {
+            if (position == size || shift > 63) return 1;
+            byte = data[position++];
+            zigzag |= (uint64_t) (byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        delta += (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+        last += delta;
+        values[i] = limits->y_min + (double) last * step;
+    }
+    return 0;
+}
+
+/**
+ * @brief Encodes flags as runs of a flag byte and a varint length.
+ */
+static void encode_flags(ByteBuffer *buffer, const unsigned char *flags, const size_t count) {
+    for (size_t i = 0; i < count;) {
+        size_t end = i + 1;
+        while (end < count && flags[end] == flags[i]) end++;
+        put_uint(buffer, flags[i], 1);
+        put_varint(buffer, end - i);
+        i = end;
+    }
+}
+
+/**
+ * @brief Decodes flags written by `encode_flags()`.
+ *
+ * @return 0 on success, 1 if the runs do not cover exactly `count` flags.
+ */
+static int decode_flags(const unsigned char *data, const size_t size, unsigned char *flags, const size_t count) {
+    size_t position = 0;
+    size_t filled = 0;
+
+    while (position < size) {
+        const unsigned char flag = data[position++];
+        uint64_t length = 0;
+        int shift = 0;
+        unsigned char byte;
+        do {
+            if (position == size || shift > 63) return 1;
+            byte = data[position++];
+            length |= (uint64_t) (byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        if (length > count - filled) return 1;
+        memset(flags + filled, flag, (size_t) length);
+        filled += (size_t) length;
+    }
+    return filled != count;
+}
+
+/**
+ * @brief Writes bytes to the file of a writer.
+ */
+static void write_bytes(SampleWriter *writer, const ByteBuffer *bytes) {
+    fwrite(bytes->data, 1, bytes->length, writer->file);
+    writer->position += bytes->length;
+}
+
+void begin_sample_file(SampleWriter *writer, FILE *file, const Limits *limits, const size_t result_count,
+                       const SampleEncoding encoding) {
+    memset(writer, 0, sizeof(*writer));
+    writer->file = file;
+    writer->limits = *limits;
+    writer->result_count = result_count;
+    writer->encoding = encoding;
+    writer->xs = malloc(SAMPLE_FILE_BLOCK * sizeof(double));
+    writer->ys = malloc((result_count ? result_count : 1) * SAMPLE_FILE_BLOCK * sizeof(double));
+    writer->flags = malloc((result_count ? result_count : 1) * SAMPLE_FILE_BLOCK);
+    writer->first_point = malloc((result_count ? result_count : 1) * sizeof(int));
+    for (size_t i = 0; i < result_count; i++) {
+        writer->first_point[i] = 1;
+    }
+
+    ByteBuffer *header = &writer->block;
+    reserve_bytes(header, SAMPLE_HEADER_SIZE);
+    memcpy(header->data, SAMPLE_FILE_MAGIC, 4);
+    header->length = 4;
+    put_uint(header, (uint64_t) encoding, 4);
+    put_double(header, limits->x_min);
+    put_double(header, limits->x_max);
+    put_double(header, limits->y_min);
+    put_double(header, limits->y_max);
+    put_double(header, X_EVALUATION_STEP);
+    put_uint(header, result_count, 4);
+    put_uint(header, SAMPLE_FILE_BLOCK, 4);
+    write_bytes(writer, header);
+    header->length = 0;
+}
+
+/**
+ * @brief Encodes and writes the current block and records it in the directory.
+ */
+static void flush_sample_block(SampleWriter *writer) {
+    ByteBuffer *block = &writer->block;
+    const size_t count = writer->pending;
+    if (!count) return;
+
+    // The x values are implicit if repeated addition reproduces them
+    int explicit_xs = 0;
+    double x = writer->xs[0];
+    for (size_t i = 0; i < count && !explicit_xs; i++) {
+        explicit_xs = memcmp(&x, &writer->xs[i], sizeof(double)) != 0;
+        x += X_EVALUATION_STEP;
+    }
+
+    block->length = 0;
+    put_double(block, writer->xs[0]);
+    put_uint(block, count, 4);
+    put_uint(block, (uint64_t) explicit_xs, 1);
+    if (explicit_xs) {
+        const size_t at = block->length;
+        put_uint(block, 0, 4);
+        encode_xor(block, writer->xs, count);
+        patch_length(block, at);
+    }
+    for (size_t r = 0; r < writer->result_count; r++) {
+        const double *ys = writer->ys + r * SAMPLE_FILE_BLOCK;
+        const unsigned char *flags = writer->flags + r * SAMPLE_FILE_BLOCK;
+
+        size_t at = block->length;
+        put_uint(block, 0, 4);
+        encode_flags(block, flags, count);
+        patch_length(block, at);
+
+        at = block->length;
+        put_uint(block, 0, 4);
+        if (writer->encoding == SAMPLE_ENCODING_QUANTISED) {
+            encode_quantised(block, &writer->limits, ys, flags, count);
+        } else {
+            encode_xor(block, ys, count);
+        }
+        patch_length(block, at);
+    }
+
+    put_uint(&writer->directory, writer->position, 8);
+    put_uint(&writer->directory, block->length, 8);
+    write_bytes(writer, block);
+    writer->block_count++;
+    writer->sample_count += count;
+    writer->pending = 0;
+}
+
+void write_samples(SampleWriter *writer, const double *xs, const double *ys, const size_t count,
+                   const size_t stride) {
+    size_t done = 0;
+
+    while (done < count) {
+        size_t take = SAMPLE_FILE_BLOCK - writer->pending;
+        take = take < count - done ? take : count - done;
+        take = take < SAMPLE_BLOCK_SIZE ? take : SAMPLE_BLOCK_SIZE;
+
+        memcpy(writer->xs + writer->pending, xs + done, take * sizeof(double));
+        for (size_t r = 0; r < writer->result_count; r++) {
+            double *block_ys = writer->ys + r * SAMPLE_FILE_BLOCK + writer->pending;
+            memcpy(block_ys, ys + r * stride + done, take * sizeof(double));
+            flag_samples(&writer->limits, block_ys, take, 0, &writer->first_point[r],
+                         writer->flags + r * SAMPLE_FILE_BLOCK + writer->pending);
+        }
+        writer->pending += take;
+        done += take;
+        if (writer->pending == SAMPLE_FILE_BLOCK) {
+            flush_sample_block(writer);
+        }
+    }
+}
+
+uint64_t end_sample_file(SampleWriter *writer) {
+    flush_sample_block(writer);
+
+    const uint64_t directory_offset = writer->position;
+    write_bytes(writer, &writer->directory);
+
+    ByteBuffer *footer = &writer->block;
+    footer->length = 0;
+    put_uint(footer, directory_offset, 8);
+    put_uint(footer, writer->block_count, 8);
+    put_uint(footer, writer->sample_count, 8);
+    reserve_bytes(footer, 4);
+    memcpy(footer->data + footer->length, SAMPLE_FILE_MAGIC, 4);
+    footer->length += 4;
+    write_bytes(writer, footer);
+
+    free(writer->xs);
+    free(writer->ys);
+    free(writer->flags);
+    free(writer->first_point);
+    free(writer->block.data);
+    free(writer->directory.data);
+    return writer->position;
+}
+
+int open_sample_file(SampleReader *reader, const unsigned char *data, const size_t size) {
+    if (size < SAMPLE_HEADER_SIZE + SAMPLE_FOOTER_SIZE || memcmp(data, SAMPLE_FILE_MAGIC, 4) != 0 ||
+        memcmp(data + size - 4, SAMPLE_FILE_MAGIC, 4) != 0) {
+        return 1;
+    }
+
+    reader->data = data;
+    reader->size = size;
+    reader->encoding = (SampleEncoding) get_uint(data + 4, 4);
+    reader->limits.x_min = get_double(data + 8);
+    reader->limits.x_max = get_double(data + 16);
+    reader->limits.y_min = get_double(data + 24);
+    reader->limits.y_max = get_double(data + 32);
+    reader->step = get_double(data + 40);
+    reader->result_count = (size_t) get_uint(data + 48, 4);
+    reader->block_samples = (size_t) get_uint(data + 52, 4);
+
+    const unsigned char *footer = data + size - SAMPLE_FOOTER_SIZE;
+    const uint64_t directory_offset = get_uint(footer, 8);
+    const uint64_t block_count = get_uint(footer + 8, 8);
+    reader->sample_count = get_uint(footer + 16, 8);
+    // Readers size their buffers from the header, so the counts must be those a writer can produce
+    if (reader->encoding > SAMPLE_ENCODING_QUANTISED || reader->block_samples == 0 ||
+        reader->block_samples > SAMPLE_FILE_BLOCK || reader->result_count > size / 8 ||
+        directory_offset < SAMPLE_HEADER_SIZE ||
+        directory_offset > size - SAMPLE_FOOTER_SIZE ||
+        block_count > (size - SAMPLE_FOOTER_SIZE - directory_offset) / DIRECTORY_ENTRY_SIZE) {
+        return 1;
+    }
+    reader->block_count = (size_t) block_count;
+    reader->directory = data + directory_offset;
+    return 0;
+}
+
+/**
+ * @brief Takes the next section of a block, a 32-bit length followed by that many bytes.
+ *
+ * @return 0 on success, 1 if the section exceeds the block.
+ */
+static int next_section(const unsigned char **cursor, const unsigned char *end, const unsigned char **section,
+                        size_t *length) {
+    if (end - *cursor < 4) return 1;
+    *length = (size_t) get_uint(*cursor, 4);
+    if ((size_t) (end - *cursor - 4) < *length) return 1;
+    *section = *cursor + 4;
+    *cursor += 4 + *length;
+    return 0;
+}
+
+size_t decode_sample_block(const SampleReader *reader, const size_t block, double *xs, double *ys,
+                           unsigned char *flags) {
+    const uint64_t offset = get_uint(reader->directory + block * DIRECTORY_ENTRY_SIZE, 8);
+    const uint64_t length = get_uint(reader->directory + block * DIRECTORY_ENTRY_SIZE + 8, 8);
+    if (offset > reader->size || length > reader->size - offset || length < 13) {
+        return 0;
+    }
+
+    const unsigned char *cursor = reader->data + offset;
+    const unsigned char *end = cursor + length;
+    const double first_x = get_double(cursor);
+    const size_t count = (size_t) get_uint(cursor + 8, 4);
+    const int explicit_xs = cursor[12];
+    cursor += 13;
+    if (count == 0 || count > reader->block_samples) {
+        return 0;
+    }
+
+    const unsigned char *section;
+    size_t section_length;
+    if (explicit_xs) {
+        if (next_section(&cursor, end, &section, &section_length) ||
+            decode_xor(section, section_length, xs, count)) {
+            return 0;
+        }
+    } else {
+        double x = first_x;
+        for (size_t i = 0; i < count; i++) {
+            xs[i] = x;
+            x += reader->step;
+        }
+    }
+
+    for (size_t r = 0; r < reader->result_count; r++) {
+        double *result_ys = ys + r * reader->block_samples;
+        unsigned char *result_flags = flags + r * reader->block_samples;
+        if (next_section(&cursor, end, &section, &section_length) ||
+            decode_flags(section, section_length, result_flags, count) ||
+            next_section(&cursor, end, &section, &section_length)) {
+            return 0;
+        }
+        const int corrupt = reader->encoding == SAMPLE_ENCODING_QUANTISED
+                                ? decode_quantised(section, section_length, &reader->limits, result_ys,
+                                                   result_flags, count)
+                                : decode_xor(section, section_length, result_ys, count);
+        if (corrupt) {
+            return 0;
+        }
+    }
+    return count;
+}
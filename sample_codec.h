@@ -0,0 +1,197 @@
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "limits.h"
+
+/**
+ * @brief Magic bytes at the start and at the end of a sample file.
+ */
+#define SAMPLE_FILE_MAGIC "PCS1"
+
+/**
+ * @brief Number of samples per block of a sample file. Every block can be decoded on its own.
+ */
+#define SAMPLE_FILE_BLOCK 4096
+
+/**
+ * @brief Steps per page unit of the quantised encoding, far below what a printer resolves.
+ */
+#define SAMPLE_QUANTUM 1024.0
+
+/**
+ * @brief Size of the fixed header of a sample file in bytes.
+ */
+#define SAMPLE_HEADER_SIZE 56
+
+/**
+ * @brief Size of the footer of a sample file in bytes.
+ */
+#define SAMPLE_FOOTER_SIZE 28
+
+/**
+ * @brief Encoding of the values of a sample file.
+ */
+typedef enum SampleEncoding {
+    SAMPLE_ENCODING_XOR, /**< Lossless: every value XORed with its prediction, Gorilla style */
+    SAMPLE_ENCODING_QUANTISED /**< Drawn values as page coordinates in steps of 1 / SAMPLE_QUANTUM, others dropped */
+} SampleEncoding;
+
+/**
+ * @brief Growable array of bytes.
+ *
+ * @struct ByteBuffer
+ * @member data The bytes.
+ * @member length The number of bytes.
+ * @member capacity The allocated number of bytes.
+ */
+typedef struct ByteBuffer {
+    unsigned char *data;
+    size_t length;
+    size_t capacity;
+} ByteBuffer;
+
+/**
+ * @brief Writes samples into the compressed columnar sample format.
+ *
+ * A sample file holds the x values, the values of every curve and the flags of `flag_samples()` over the grid of
+ * some limits. It starts with a header with the limits, the step of the grid and the encoding, followed by
+ * blocks of SAMPLE_FILE_BLOCK samples, a directory of the blocks and a footer pointing to the directory, so it
+ * can be written in one pass and read from any block. All numbers are little endian.
+ *
+ * Every block starts with its first x value. The other x values follow by repeated addition of the step, like
+ * in `next_sample_block()`, and are only stored if they differ from that. The flags are stored as runs, the
+ * values per curve in the encoding of the file.
+ *
+ * @struct SampleWriter
+ * @member file The file being written.
+ * @member limits The limits of the grid.
+ * @member result_count The number of curves.
+ * @member encoding The encoding of the values.
+ * @member xs The x values of the current block.
+ * @member ys Per curve: SAMPLE_FILE_BLOCK values of the current block.
+ * @member flags Per curve: SAMPLE_FILE_BLOCK flags of the current block.
+ * @member first_point Per curve: the path state carried from one block of flags to the next.
+ * @member pending The number of samples of the current block.
+ * @member block The encoded current block.
+ * @member directory The offset and length of every written block, 16 bytes each.
+ * @member block_count The number of written blocks.
+ * @member sample_count The number of written samples.
+ * @member position The number of bytes written.
+ */
+typedef struct SampleWriter {
+    FILE *file;
+    Limits limits;
+    size_t result_count;
+    SampleEncoding encoding;
+    double *xs;
+    double *ys;
+    unsigned char *flags;
+    int *first_point;
+    size_t pending;
+    ByteBuffer block;
+    ByteBuffer directory;
+    size_t block_count;
+    uint64_t sample_count;
+    uint64_t position;
+} SampleWriter;
+
+/**
+ * @brief A sample file in memory, ready to decode any of its blocks.
+ *
+ * @struct SampleReader
+ * @member data The bytes of the file.
+ * @member size The number of bytes.
+ * @member limits The limits of the grid.
+ * @member step The step of the grid.
+ * @member encoding The encoding of the values.
+ * @member result_count The number of curves.
+ * @member block_samples The number of samples per block.
+ * @member block_count The number of blocks.
+ * @member sample_count The number of samples.
+ * @member directory The directory of the blocks.
+ */
+typedef struct SampleReader {
+    const unsigned char *data;
+    size_t size;
+    Limits limits;
+    double step;
+    SampleEncoding encoding;
+    size_t result_count;
+    size_t block_samples;
+    size_t block_count;
+    uint64_t sample_count;
+    const unsigned char *directory;
+} SampleReader;
+
+/**
+ * @brief Parses the name of an encoding, "xor" or "quantised".
+ *
+ * @param name     The name.
+ * @param encoding Set to the encoding.
+ * @return 0 on success, 1 if the name is unknown.
+ */
+int parse_sample_encoding(const char *name, SampleEncoding *encoding);
+
+/**
+ * @brief Starts a sample file and writes its header.
+ *
+ * @param writer       The writer.
+ * @param file         The file, opened in binary mode.
+ * @param limits       The limits of the grid.
+ * @param result_count The number of curves.
+ * @param encoding     The encoding of the values.
+ */
+void begin_sample_file(SampleWriter *writer, FILE *file, const Limits *limits, size_t result_count,
+                       SampleEncoding encoding);
+
+/**
+ * @brief Adds the next samples of the grid, e.g. a block of `sampler_next_block()`.
+ *
+ * @param writer The writer.
+ * @param xs     The x values.
+ * @param ys     The values, the values of curve r start at `ys + r * stride`.
+ * @param count  The number of samples.
+ * @param stride The distance of the values of consecutive curves.
+ */
+void write_samples(SampleWriter *writer, const double *xs, const double *ys, size_t count, size_t stride);
+
+/**
+ * @brief Writes the last block, the directory and the footer, and frees the writer. The file stays open.
+ *
+ * @param writer The writer.
+ * @return The size of the sample file in bytes.
+ */
+uint64_t end_sample_file(SampleWriter *writer);
+
+/**
+ * @brief Checks the header, footer and directory of a sample file in memory.
+ *
+ * Callers may size their buffers from the header: a file with more than SAMPLE_FILE_BLOCK samples per block, or
+ * with more curves than the 8 bytes each needs per block could hold, is rejected.
+ *
+ * @param reader The reader.
+ * @param data   The bytes of the file, they must stay valid while the reader is used.
+ * @param size   The number of bytes.
+ * @return 0 on success, 1 if the data is not a valid sample file.
+ */
+int open_sample_file(SampleReader *reader, const unsigned char *data, size_t size);
+
+/**
+ * @brief Decodes one block of a sample file, independently of the other blocks.
+ *
+ * The values of the quantised encoding are rounded to their page coordinates, and are NaN where a curve is not
+ * drawn; the flags still tell NaN from out of range.
+ *
+ * @param reader The reader.
+ * @param block  The block, below `reader->block_count`.
+ * @param xs     Output array of `reader->block_samples` x values.
+ * @param ys     Output array of `reader->block_samples` values per curve, the values of curve r at
+ *               `ys + r * reader->block_samples`.
+ * @param flags  Output array of `reader->block_samples` flags per curve, laid out like `ys`.
+ * @return The number of samples of the block, 0 if the block is corrupt.
+ */
+size_t decode_sample_block(const SampleReader *reader, size_t block, double *xs, double *ys, unsigned char *flags);
+
+#endif //SAMPLE_CODEC_H
@@ -0,0 +1,245 @@
+#include <string.h>
+#include "sampler.h"
+#include "parser.h"
+#include "sampling.h"
+#include "segments.h"
+#include "ranges.h"
+#include "stats.h"
+
+/**
+ * @brief Counts the expressions of a text, which are separated by EXPRESSION_SEPARATOR.
+ */
+static size_t count_expressions(const char *text) {
+    size_t expression_count = 1;
+    for (const char *c = text; *c != END_OF_FILE; c++) {
+        if (*c == EXPRESSION_SEPARATOR) {
+            expression_count++;
+        }
+    }
+    return expression_count;
+}
+
+/**
+ * @brief Lexes and parses the expressions of a copy of the text, which is split in place.
+ *
+ * @param expressions      The copy of the text.
+ * @param expression_count The number of expressions, see `count_expressions()`.
+ * @param trees            Output array of the trees, one per expression.
+ * @param offsets          Output array of the offsets of the expressions in the text.
+ * @param scratch          The arena for the lexers and the trees, NULL to allocate them with `malloc()`.
+ * @param error_position   Set to the offset of the problem in the text if an expression is malformed, or NULL.
+ * @return 0 on success, 1 if an expression is malformed. Trees allocated with `malloc()` are freed then.
+ */
+static int parse_expression_text(char *expressions, const size_t expression_count, Node **trees, size_t *offsets,
+                                 Arena *scratch, size_t *error_position) {
+    char *start = expressions;
+    for (size_t i = 0; i < expression_count; i++) {
+        char *end = strchr(start, EXPRESSION_SEPARATOR);
+        if (end) {
+            *end = END_OF_FILE;
+        }
+        offsets[i] = (size_t) (start - expressions);
+
+        // The brackets are checked per expression, initialize_scratch_lexer() would end the program
+        size_t position = unbalanced_bracket(start);
+        trees[i] = NULL;
+        if (start[position] == END_OF_FILE) {
+            stage_begin(STAGE_LEX);
+            Lexer *lexer = initialize_scratch_lexer(start, scratch);
+            stage_end(STAGE_LEX);
+
+            stage_begin(STAGE_PARSE);
+            trees[i] = try_parse(lexer, &position);
+            stage_end(STAGE_PARSE);
+            if (!scratch) {
+                free(lexer);
+            }
+        }
+
+        if (!trees[i]) {
+            if (error_position) {
+                *error_position = offsets[i] + position;
+            }
+            for (size_t j = 0; !scratch && j < i; j++) {
+                free_node(trees[j]);
+            }
+            return 1;
+        }
+        start = end ? end + 1 : start;
+    }
+    return 0;
+}
+
+Program *compile_expression_text(const char *text, const int patchable, Arena *scratch, size_t *error_position) {
+    const size_t expression_count = count_expressions(text);
+    const size_t length = strlen(text);
+    char *expressions = scratch ? arena_allocate(scratch, length + 1) : malloc(length + 1);
+    Node **trees = scratch ? arena_allocate(scratch, expression_count * sizeof(Node *))
+                           : malloc(expression_count * sizeof(Node *));
+    size_t *offsets = scratch ? arena_allocate(scratch, expression_count * sizeof(size_t))
+                              : malloc(expression_count * sizeof(size_t));
+    memcpy(expressions, text, length + 1);
+
+    Program *program = NULL;
+    if (parse_expression_text(expressions, expression_count, trees, offsets, scratch, error_position) == 0) {
+        for (size_t i = 0; i < expression_count; i++) {
+            run_stats.ast_nodes += count_nodes(trees[i]);
+        }
+
+        stage_begin(STAGE_COMPILE);
+        program = patchable ? compile_patchable(trees, expression_count) : compile_expressions(trees, expression_count);
+        stage_end(STAGE_COMPILE);
+        run_stats.instructions += program->length;
+
+        // The spans of the literals become offsets into the whole text
+        for (size_t i = 0; program->pool && i < program->pool->count; i++) {
+            program->pool->spans[i].start += offsets[program->pool->spans[i].expression];
+            program->pool->spans[i].end += offsets[program->pool->spans[i].expression];
+        }
+    }
+
+    if (scratch) {
+        reset_arena(scratch);
+        return program;
+    }
+    for (size_t i = 0; program && i < expression_count; i++) {
+        free_node(trees[i]);
+    }
+    free(trees);
+    free(offsets);
+    free(expressions);
+    return program;
+}
+
+int check_expression_text(const char *text, Arena *scratch, size_t *error_position) {
+    const size_t expression_count = count_expressions(text);
+    char *expressions = arena_copy(scratch, text, strlen(text));
+    Node **trees = arena_allocate(scratch, expression_count * sizeof(Node *));
+    size_t *offsets = arena_allocate(scratch, expression_count * sizeof(size_t));
+    return parse_expression_text(expressions, expression_count, trees, offsets, scratch, error_position);
+}
+
+Sampler *sampler_open(const char *expression, const Limits *limits, const SamplerOptions *options,
+                      size_t *error_position) {
+    Program *program = compile_expression_text(expression, 1, NULL, error_position);
+    return program ? sampler_open_program(program, limits, options) : NULL;
+}
+
+/**
+ * @brief Specialises the program of a sampler to its options and limits and starts over at the beginning of the grid.
+ */
+static void restart_sampler(Sampler *sampler) {
+    if (sampler->options.recurrences) {
+        enable_recurrences(sampler->program, X_EVALUATION_STEP);
+    }
+    specialise_ranges(sampler->program, &sampler->limits, sampler->options.narrow_kernels);
+
+    sampler->cursor = sampler->limits.x_min;
+    for (size_t i = 0; i < sampler->program->result_count; i++) {
+        sampler->first_point[i] = 1;
+        sampler->proven[i] = proven_inside(sampler->program, i, &sampler->limits);
+    }
+}
+
+Sampler *sampler_open_program(Program *program, const Limits *limits, const SamplerOptions *options) {
+    Sampler *sampler = malloc(sizeof(Sampler));
+    const size_t result_count = program->result_count;
+
+    sampler->program = program;
+    sampler->limits = *limits;
+    if (options) {
+        sampler->options = *options;
+    } else {
+        memset(&sampler->options, 0, sizeof(sampler->options));
+    }
+    sampler->first_point = malloc(result_count * sizeof(int));
+    sampler->proven = malloc(result_count * sizeof(int));
+    sampler->registers = malloc(program->length * SAMPLE_BLOCK_SIZE * sizeof(double));
+    sampler->block_ys = malloc(result_count * sizeof(double *));
+    restart_sampler(sampler);
+    return sampler;
+}
+
+size_t sampler_result_count(const Sampler *sampler) {
+    return sampler->program->result_count;
+}
+
+size_t sampler_constant_count(const Sampler *sampler) {
+    return sampler->program->pool ? sampler->program->pool->count : 0;
+}
+
+int sampler_set_constant(Sampler *sampler, const size_t slot, const double value) {
+    if (slot >= sampler_constant_count(sampler)) return 1;
+
+    patch_constant(sampler->program, slot, value);
+    restart_sampler(sampler);
+    return 0;
+}
+
+void flag_samples(const Limits *limits, const double *ys, const size_t count, const int proven, int *first_point,
+                  unsigned char *flags) {
+    uint64_t valid[SEGMENT_MASK_WORDS(SAMPLE_BLOCK_SIZE)];
+    uint64_t nan[SEGMENT_MASK_WORDS(SAMPLE_BLOCK_SIZE)];
+    SampleRun runs[SAMPLE_BLOCK_SIZE];
+    size_t run_count;
+
+    if (proven) {
+        runs[0] = (SampleRun){0, count, RUN_VALID};
+        run_count = count ? 1 : 0;
+    } else {
+        classify_samples(ys, count, limits->y_min, limits->y_max, valid, nan);
+        run_count = find_sample_runs(valid, nan, count, runs);
+    }
+
+    for (size_t r = 0; r < run_count; r++) {
+        const SampleRun *run = &runs[r];
+        if (run->kind == RUN_VALID) {
+            memset(flags + run->start, SAMPLE_DRAWN, run->length);
+            if (*first_point) {
+                flags[run->start] |= SAMPLE_BREAK;
+            }
+            *first_point = 0;
+            continue;
+        }
+        for (size_t i = run->start; i < run->start + run->length; i++) {
+            flags[i] = nan[i / 64] >> (i % 64) & 1 ? SAMPLE_NAN : 0;
+        }
+        *first_point = 1;
+    }
+}
+
+size_t sampler_next_block(Sampler *sampler, double *xs, double *ys, unsigned char *flags, const size_t capacity) {
+    const Program *program = sampler->program;
+    size_t produced = 0;
+
+    while (produced < capacity) {
+        const size_t room = capacity - produced < SAMPLE_BLOCK_SIZE ? capacity - produced : SAMPLE_BLOCK_SIZE;
+        const size_t block = next_sample_block(&sampler->limits, &sampler->cursor, xs + produced, room);
+        if (!block) {
+            break; // End of the grid
+        }
+
+        for (size_t i = 0; i < program->result_count; i++) {
+            sampler->block_ys[i] = ys + i * capacity + produced;
+        }
+        execute_block(program, xs + produced, block, sampler->options.parameters, sampler->registers,
+                      sampler->block_ys);
+        if (flags) {
+            for (size_t i = 0; i < program->result_count; i++) {
+                flag_samples(&sampler->limits, sampler->block_ys[i], block, sampler->proven[i], &sampler->first_point[i],
+                             flags + i * capacity + produced);
+            }
+        }
+        produced += block;
+    }
+    return produced;
+}
+
+void sampler_close(Sampler *sampler) {
+    free_program(sampler->program);
+    free(sampler->first_point);
+    free(sampler->proven);
+    free(sampler->registers);
+    free(sampler->block_ys);
+    free(sampler);
+}
@@ -0,0 +1,180 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "compiler.h"
+#include "limits.h"
+#include "arena.h"
+
+/**
+ * @brief Flags of a sample produced by `sampler_next_block()`.
+ *
+ * A sample that is neither drawn nor NaN lies outside of the y limits. A curve is the sequence of drawn samples,
+ * broken wherever a sample is not drawn; SAMPLE_BREAK marks the drawn samples that start a new piece, where
+ * `draw_samples()` writes a moveto.
+ */
+#define SAMPLE_DRAWN 0x1 /**< The value is finite and inside of the y limits */
+#define SAMPLE_NAN 0x2 /**< The function can not be evaluated at the sample */
+#define SAMPLE_BREAK 0x4 /**< A drawn sample that starts a new piece of the curve */
+
+/**
+ * @brief Options of a sampler.
+ *
+ * @struct SamplerOptions
+ * @member parameters The values of the parameters a, b and t.
+ * @member recurrences 1 to evaluate sin, cos and exp of affine arguments by recurrence, see `enable_recurrences()`.
+ * @member narrow_kernels 1 to switch sin and cos to the narrow kernels, see `specialise_ranges()`.
+ */
+typedef struct SamplerOptions {
+    double parameters[PARAMETER_COUNT];
+    int recurrences;
+    int narrow_kernels;
+} SamplerOptions;
+
+/**
+ * @brief Iterator over the samples of expressions on the grid of some limits.
+ *
+ * The samples are produced on demand, block by block, in the order of the grid and without any output formatting.
+ * Every block continues where the previous one ended, so the caller can consume them at its own pace and stop at
+ * any point.
+ *
+ * @struct Sampler
+ * @member program The compiled program of the expressions.
+ * @member limits The limits defining the grid.
+ * @member options The options, which also give the values of the parameters.
+ * @member cursor The next x value of the grid.
+ * @member first_point Per result: 1 if its next drawn sample starts a new piece.
+ * @member proven Per result: 1 if range analysis proved every sample drawn.
+ * @member registers Scratch memory for one block of every instruction.
+ * @member block_ys Per result: the output position of the current block.
+ */
+typedef struct Sampler {
+    Program *program;
+    Limits limits;
+    SamplerOptions options;
+    double cursor;
+    int *first_point;
+    int *proven;
+    double *registers;
+    double **block_ys;
+} Sampler;
+
+/**
+ * @brief Lexes, parses and compiles expressions separated by ';' into one fused program.
+ *
+ * With a scratch arena, the copy of the text, the lexers and the trees are allocated from it and the arena is
+ * reset before returning, so only the program itself is allocated with `malloc()`.
+ *
+ * A malformed expression never ends the process, the text is parsed with `try_parse()`.
+ *
+ * @param text           The expressions.
+ * @param patchable      1 to compile with `compile_patchable()`. The spans of the literals are offsets into `text`.
+ * @param scratch        The arena for the intermediate results, NULL to allocate them with `malloc()`.
+ * @param error_position Set to the offset of the problem in `text` if an expression is malformed, or NULL.
+ * @return The program, or NULL if an expression is malformed.
+ */
+Program *compile_expression_text(const char *text, int patchable, Arena *scratch, size_t *error_position);
+
+/**
+ * @brief Lexes and parses expressions separated by ';' to check that `compile_expression_text()` accepts them.
+ *
+ * @param text           The expressions.
+ * @param scratch        The arena the lexers and the trees are allocated from. It is not reset.
+ * @param error_position Set to the offset of the problem in `text` if an expression is malformed, or NULL.
+ * @return 0 if every expression is well-formed, 1 otherwise.
+ */
+int check_expression_text(const char *text, Arena *scratch, size_t *error_position);
+
+/**
+ * @brief Sets the flags of a block of samples of one curve and carries its path state to the next block.
+ *
+ * The runs are found exactly like in `draw_samples()`, so SAMPLE_BREAK marks the samples drawn with a moveto.
+ *
+ * @param limits      The limits of the graph.
+ * @param ys          The values, at most SAMPLE_BLOCK_SIZE.
+ * @param count       The number of values.
+ * @param proven      1 if range analysis proved every value drawn, see `proven_inside()`.
+ * @param first_point 1 if the next drawn sample starts a new piece, updated for the next block.
+ * @param flags       Output array of `count` flags.
+ */
+void flag_samples(const Limits *limits, const double *ys, size_t count, int proven, int *first_point,
+                  unsigned char *flags);
+
+/**
+ * @brief Opens a sampler over expressions.
+ *
+ * The literals of the expressions can be changed with `sampler_set_constant()`. A malformed expression never ends
+ * the process, so the sampler can be opened on untrusted input.
+ *
+ * @param expression     The expressions separated by ';', one result each.
+ * @param limits         The limits defining the grid.
+ * @param options        The options, NULL for parameters 0 and no approximations.
+ * @param error_position Set to the offset of the problem in `expression` if it is malformed, or NULL.
+ * @return The sampler, or NULL if an expression is malformed.
+ */
+Sampler *sampler_open(const char *expression, const Limits *limits, const SamplerOptions *options,
+                      size_t *error_position);
+
+/**
+ * @brief Opens a sampler over a compiled program.
+ *
+ * @param program The program, owned by the sampler from now on. It is specialised to the limits.
+ * @param limits  The limits defining the grid.
+ * @param options The options, NULL for parameters 0 and no approximations.
+ * @return The sampler.
+ */
+Sampler *sampler_open_program(Program *program, const Limits *limits, const SamplerOptions *options);
+
+/**
+ * @brief Returns the number of results, one per expression.
+ *
+ * @param sampler The sampler.
+ * @return The number of results.
+ */
+size_t sampler_result_count(const Sampler *sampler);
+
+/**
+ * @brief Returns the number of numeric literals that can be changed, 0 unless the program is patchable.
+ *
+ * The position of every literal in the expression text is in `sampler->program->pool->spans`.
+ *
+ * @param sampler The sampler.
+ * @return The number of literals.
+ */
+size_t sampler_constant_count(const Sampler *sampler);
+
+/**
+ * @brief Changes a numeric literal, e.g. for a slider, and starts over at the beginning of the grid.
+ *
+ * The program is patched with `patch_constant()` and specialised again, nothing is parsed or compiled, so the
+ * next pass over the grid is the only real cost.
+ *
+ * @param sampler The sampler.
+ * @param slot    The literal, below `sampler_constant_count()`.
+ * @param value   The new value.
+ * @return 0 on success, 1 if there is no such literal.
+ */
+int sampler_set_constant(Sampler *sampler, size_t slot, double value);
+
+/**
+ * @brief Produces the next samples of the grid.
+ *
+ * The arrays hold `capacity` entries per result: the samples of result r start at `ys + r * capacity` and
+ * `flags + r * capacity`.
+ *
+ * @param sampler  The sampler.
+ * @param xs       Output array of `capacity` x values.
+ * @param ys       Output array of `capacity` values per result.
+ * @param flags    Output array of `capacity` flags per result, see SAMPLE_DRAWN, or NULL if not needed.
+ * @param capacity The maximum number of samples to produce.
+ * @return The number of samples produced, less than `capacity` only at the end of the grid, 0 once it ended.
+ */
+size_t sampler_next_block(Sampler *sampler, double *xs, double *ys, unsigned char *flags, size_t capacity);
+
+/**
+ * @brief Closes a sampler, also before the end of its grid.
+ *
+ * @param sampler The sampler.
+ */
+void sampler_close(Sampler *sampler);
+
+#endif //SAMPLER_H
@@ -0,0 +1,22 @@
+#include "sampling.h"
+
+size_t next_sample_block(const Limits *limits, double *cursor, double *xs, const size_t capacity) {
+    size_t count = 0;
+    double x = *cursor;
+
+    while (count < capacity && x <= limits->x_max) {
+        xs[count++] = x;
+        x += X_EVALUATION_STEP;
+    }
+    *cursor = x;
+
+    return count;
+}
+
+size_t count_samples(const Limits *limits) {
+    size_t count = 0;
+    for (double x = limits->x_min; x <= limits->x_max; x += X_EVALUATION_STEP) {
+        count++;
+    }
+    return count;
+}
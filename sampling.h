@@ -0,0 +1,45 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include "limits.h"
+
+/**
+ * @brief Step size for evaluating function values.
+ *
+ * This defines the granularity of the evaluation of the function for plotting. A smaller step size gives a more detailed graph.
+ */
+#define X_EVALUATION_STEP 0.01
+
+/**
+ * @brief Number of samples evaluated together as one block.
+ *
+ * The sampling grid is walked in blocks of this size, so that evaluation and output can work on
+ * contiguous arrays of x and y values instead of one point at a time.
+ */
+#define SAMPLE_BLOCK_SIZE 256
+
+/**
+ * @brief Fills the next block of x values of the sampling grid.
+ *
+ * The grid starts at `limits->x_min` and advances by `X_EVALUATION_STEP` while the value does not exceed
+ * `limits->x_max`. The values are produced by repeated addition, exactly like the original plotting loop,
+ * so every consumer of the grid sees bit-identical x values.
+ *
+ * @param limits   A pointer to the Limits structure defining the x range.
+ * @param cursor   A pointer to the next x value of the grid. It has to be set to `limits->x_min` before the
+ *                 first call and is advanced by this function.
+ * @param xs       Output array for the x values.
+ * @param capacity Maximum number of values written to `xs`.
+ * @return The number of values written, 0 once the whole grid has been produced.
+ */
+size_t next_sample_block(const Limits *limits, double *cursor, double *xs, size_t capacity);
+
+/**
+ * @brief Counts the samples of the grid defined by the limits.
+ *
+ * @param limits A pointer to the Limits structure defining the x range.
+ * @return The number of x values `next_sample_block()` produces for these limits.
+ */
+size_t count_samples(const Limits *limits);
+
+#endif //SAMPLING_H
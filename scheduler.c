@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "scheduler.h"
+#include "timer.h"
+#include "trace.h"
+
+/**
+ * @brief Names of the priority classes, in the order of JobClass.
+ */
+static const char *JOB_CLASS_NAMES[JOB_CLASS_COUNT] = {"interactive", "batch"};
+
+const char *job_class_name(const JobClass job_class) {
+    return JOB_CLASS_NAMES[job_class];
+}
+
+int parse_job_class(const char *name, JobClass *job_class) {
+    for (int i = 0; i < JOB_CLASS_COUNT; i++) {
+        if (strcmp(name, JOB_CLASS_NAMES[i]) == 0) {
+            *job_class = (JobClass) i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int parse_job_limits(const char *limits_str, size_t *limits) {
+    char *endptr;
+
+    const long interactive = strtol(limits_str, &endptr, 10);
+    if (endptr == limits_str || *endptr != ':' || interactive < 1) return 1;
+
+    const char *batch_str = endptr + 1;
+    const long batch = strtol(batch_str, &endptr, 10);
+    if (endptr == batch_str || *endptr != '\0' || batch < 1) return 1;
+
+    limits[JOB_INTERACTIVE] = (size_t) interactive;
+    limits[JOB_BATCH] = (size_t) batch;
+
+    return 0; // Success
+}
+
+void push_job(JobQueue *queue, Job *job) {
+    job->next = NULL;
+    if (queue->tail) {
+        queue->tail->next = job;
+    } else {
+        queue->head = job;
+    }
+    queue->tail = job;
+    queue->length++;
+}
+
+Job *pop_job(JobQueue *queue) {
+    Job *job = queue->head;
+    queue->head = job->next;
+    if (!queue->head) {
+        queue->tail = NULL;
+    }
+    queue->length--;
+    return job;
+}
+
+void initialize_scheduler(Scheduler *scheduler, const JobStep step, const size_t *limits) {
+    memset(scheduler, 0, sizeof(*scheduler));
+    scheduler->step = step;
+    scheduler->next_id = 1;
+    for (int i = 0; i < JOB_CLASS_COUNT; i++) {
+        scheduler->limits[i] = limits[i];
+    }
+}
+
+Job *create_job(const long id, const JobClass job_class, void *data) {
+    Job *job = malloc(sizeof(Job));
+    initialize_job(job, id, job_class, data);
+    return job;
+}
+
+void initialize_job(Job *job, const long id, const JobClass job_class, void *data) {
+    job->id = id;
+    job->job_class = job_class;
+    job->arrival = monotonic_seconds();
+    job->latency = 0.0;
+    job->data = data;
+    job->next = NULL;
+}
+
+void enqueue_job(Scheduler *scheduler, Job *job) {
+    push_job(&scheduler->pending[job->job_class], job);
+}
+
+long submit_job(Scheduler *scheduler, const JobClass job_class, void *data) {
+    Job *job = create_job(scheduler->next_id++, job_class, data);
+    enqueue_job(scheduler, job);
+    return job->id;
+}
+
+int scheduler_idle(const Scheduler *scheduler) {
+    for (int i = 0; i < JOB_CLASS_COUNT; i++) {
+        if (scheduler->pending[i].length || scheduler->active[i].length) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Counts a latency in the histogram of a class.
+ */
+static void add_latency(Scheduler *scheduler, const JobClass job_class, const double latency) {
+    const double bucket = latency > LATENCY_HISTOGRAM_MIN
+                              ? floor(log2(latency / LATENCY_HISTOGRAM_MIN) * LATENCY_BUCKETS_PER_OCTAVE)
+                              : 0.0;
+    scheduler->latencies[job_class][bucket < LATENCY_BUCKETS ? (size_t) bucket : LATENCY_BUCKETS - 1]++;
+    scheduler->finished[job_class]++;
+    if (latency > scheduler->max_latency[job_class]) {
+        scheduler->max_latency[job_class] = latency;
+    }
+}
+
+void merge_latencies(Scheduler *scheduler, const Scheduler *other) {
+    for (int i = 0; i < JOB_CLASS_COUNT; i++) {
+        for (size_t j = 0; j < LATENCY_BUCKETS; j++) {
+            scheduler->latencies[i][j] += other->latencies[i][j];
+        }
+        scheduler->finished[i] += other->finished[i];
+        if (other->max_latency[i] > scheduler->max_latency[i]) {
+            scheduler->max_latency[i] = other->max_latency[i];
+        }
+    }
+}
+
+Job *run_slice(Scheduler *scheduler) {
+    for (int i = 0; i < JOB_CLASS_COUNT; i++) {
+        JobQueue *active = &scheduler->active[i];
+        JobQueue *pending = &scheduler->pending[i];
+
+        while (active->length < scheduler->limits[i] && pending->length) {
+            push_job(active, pop_job(pending));
+        }
+        if (!active->length) {
+            continue;
+        }
+
+        // Higher classes are idle, so the first active job of this class gets the slice
+        Job *job = pop_job(active);
+        trace_job(job->id);
+        const int finished = scheduler->step(job->data);
+        trace_job(0);
+        if (finished) {
+            job->latency = monotonic_seconds() - job->arrival;
+            add_latency(scheduler, job->job_class, job->latency);
+            return job;
+        }
+        push_job(active, job); // Round robin within the class
+        return NULL;
+    }
+    return NULL;
+}
+
+double latency_percentile(const Scheduler *scheduler, const JobClass job_class, const double fraction) {
+    const size_t count = scheduler->finished[job_class];
+    if (!count) {
+        return 0.0;
+    }
+
+    // Nearest rank, found by accumulating the buckets
+    size_t rank = (size_t) (fraction * (double) count + 0.5);
+    rank = rank < 1 ? 1 : rank > count ? count : rank;
+    const size_t *histogram = scheduler->latencies[job_class];
+    size_t bucket = 0;
+    for (size_t seen = histogram[0]; seen < rank; seen += histogram[bucket]) {
+        bucket++;
+    }
+    const double bound = LATENCY_HISTOGRAM_MIN * exp2((double) (bucket + 1) / LATENCY_BUCKETS_PER_OCTAVE);
+    return bound < scheduler->max_latency[job_class] ? bound : scheduler->max_latency[job_class];
+}
+
+void print_scheduler_stats(const Scheduler *scheduler, FILE *file) {
+    fprintf(file, "%-12s %8s %12s %12s %12s\n", "class", "jobs", "p50 [ms]", "p99 [ms]", "max [ms]");
+    for (int i = 0; i < JOB_CLASS_COUNT; i++) {
+        fprintf(file, "%-12s %8zu %12.3f %12.3f %12.3f\n", JOB_CLASS_NAMES[i], scheduler->finished[i],
+                1e3 * latency_percentile(scheduler, (JobClass) i, 0.5),
+                1e3 * latency_percentile(scheduler, (JobClass) i, 0.99),
+                1e3 * latency_percentile(scheduler, (JobClass) i, 1.0));
+    }
+}
+
+void free_scheduler(Scheduler *scheduler) {
+    // The latencies are counted in place, nothing is allocated besides the jobs
+    (void) scheduler;
+}
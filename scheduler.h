@@ -0,0 +1,249 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+ * @brief Priority classes of the jobs, from the highest to the lowest priority.
+ */
+typedef enum JobClass {
+    JOB_INTERACTIVE, /**< Renders somebody is waiting for, e.g. a dashboard */
+    JOB_BATCH, /**< Bulk renders that only need to finish eventually */
+    JOB_CLASS_COUNT
+} JobClass;
+
+/**
+ * @brief Default number of jobs of every class that are in progress at the same time.
+ */
+#define DEFAULT_INTERACTIVE_LIMIT 4
+#define DEFAULT_BATCH_LIMIT 1
+
+/**
+ * @brief Range and resolution of the recorded latencies.
+ *
+ * The latencies are counted in buckets whose bounds grow geometrically from LATENCY_HISTOGRAM_MIN seconds on,
+ * LATENCY_BUCKETS_PER_OCTAVE buckets per doubling, so a percentile is off by less than 2.2% of its value while
+ * the memory stays the same for any number of jobs. Shorter and longer latencies count in the first and the last
+ * bucket.
+ */
+#define LATENCY_HISTOGRAM_MIN 1e-6
+#define LATENCY_BUCKETS_PER_OCTAVE 32
+#define LATENCY_BUCKETS (30 * LATENCY_BUCKETS_PER_OCTAVE)
+
+/**
+ * @brief Performs the next slice of the work of a job.
+ *
+ * A slice should be short, e.g. one block of samples, because the scheduler can only switch to another job
+ * between slices.
+ *
+ * @param data The data of the job, as submitted.
+ * @return 1 if the job is finished, 0 if it needs further slices.
+ */
+typedef int (*JobStep)(void *data);
+
+/**
+ * @brief A job known to the scheduler.
+ *
+ * @struct Job
+ * @member id The id of the job, assigned in the order of submission starting with 1.
+ * @member job_class The priority class of the job.
+ * @member arrival The time of the submission in seconds of the monotonic clock.
+ * @member latency The time from the submission to the end of the last slice in seconds, set once finished.
+ * @member data The data passed to the step function.
+ * @member next The next job in the same queue.
+ */
+typedef struct Job {
+    long id;
+    JobClass job_class;
+    double arrival;
+    double latency;
+    void *data;
+    struct Job *next;
+} Job;
+
+/**
+ * @brief A queue of jobs, first in first out.
+ */
+typedef struct JobQueue {
+    Job *head;
+    Job *tail;
+    size_t length;
+} JobQueue;
+
+/**
+ * @brief Appends a job to the end of a queue.
+ *
+ * @param queue The queue.
+ * @param job   The job.
+ */
+void push_job(JobQueue *queue, Job *job);
+
+/**
+ * @brief Removes the first job of a non-empty queue.
+ *
+ * @param queue The queue.
+ * @return The job.
+ */
+Job *pop_job(JobQueue *queue);
+
+/**
+ * @brief Cooperative scheduler of jobs with priority classes.
+ *
+ * Every class has a queue of pending jobs and a queue of active jobs, which have been started and are in progress.
+ * Every slice goes to the active jobs of the highest class that has any, round robin within the class. A pending
+ * job becomes active as soon as its class has less active jobs than its limit. A job of a lower class is thus
+ * preempted after its current slice as soon as a job of a higher class arrives, and resumes where it stopped once
+ * the higher classes are idle.
+ *
+ * The latency of every finished job, from its submission to its last slice, is counted per class in a histogram
+ * of LATENCY_BUCKETS buckets, so a long-running scheduler does not grow.
+ *
+ * @struct Scheduler
+ * @member step The step function of all jobs.
+ * @member limits Per class: the maximum number of active jobs.
+ * @member pending Per class: the jobs waiting to be started.
+ * @member active Per class: the started jobs, the next one to run first.
+ * @member next_id The id of the next submitted job.
+ * @member latencies Per class: the number of finished jobs per latency bucket.
+ * @member finished Per class: the number of finished jobs.
+ * @member max_latency Per class: the longest latency of a finished job in seconds.
+ */
+typedef struct Scheduler {
+    JobStep step;
+    size_t limits[JOB_CLASS_COUNT];
+    JobQueue pending[JOB_CLASS_COUNT];
+    JobQueue active[JOB_CLASS_COUNT];
+    long next_id;
+    size_t latencies[JOB_CLASS_COUNT][LATENCY_BUCKETS];
+    size_t finished[JOB_CLASS_COUNT];
+    double max_latency[JOB_CLASS_COUNT];
+} Scheduler;
+
+/**
+ * @brief Returns the name of a priority class.
+ *
+ * @param job_class The class.
+ * @return The name, e.g. "interactive".
+ */
+const char *job_class_name(JobClass job_class);
+
+/**
+ * @brief Parses the name of a priority class.
+ *
+ * @param name      The name, e.g. "batch".
+ * @param job_class Set to the class.
+ * @return 0 if the name is a class, 1 otherwise.
+ */
+int parse_job_class(const char *name, JobClass *job_class);
+
+/**
+ * @brief Parses the limits of active jobs in the format "interactive:batch", e.g. "4:1".
+ *
+ * @param limits_str The string with the limits.
+ * @param limits     Output array of JOB_CLASS_COUNT limits.
+ * @return 0 if the parsing was successful, or 1 if the format is invalid or a limit is not positive.
+ */
+int parse_job_limits(const char *limits_str, size_t *limits);
+
+/**
+ * @brief Initializes an empty scheduler.
+ *
+ * @param scheduler The scheduler.
+ * @param step      The step function of all jobs.
+ * @param limits    Per class: the maximum number of active jobs, at least 1.
+ */
+void initialize_scheduler(Scheduler *scheduler, JobStep step, const size_t *limits);
+
+/**
+ * @brief Creates a job that arrives now.
+ *
+ * @param id        The id of the job.
+ * @param job_class The priority class of the job.
+ * @param data      The data passed to the step function.
+ * @return The job, to be enqueued with `enqueue_job()`.
+ */
+Job *create_job(long id, JobClass job_class, void *data);
+
+/**
+ * @brief Initializes a job that arrives now in memory owned by the caller, e.g. embedded in its data.
+ *
+ * @param job       The job.
+ * @param id        The id of the job.
+ * @param job_class The priority class of the job.
+ * @param data      The data passed to the step function.
+ */
+void initialize_job(Job *job, long id, JobClass job_class, void *data);
+
+/**
+ * @brief Enqueues a created job, which is pending until its class has room for it.
+ *
+ * @param scheduler The scheduler.
+ * @param job       The job.
+ */
+void enqueue_job(Scheduler *scheduler, Job *job);
+
+/**
+ * @brief Merges the recorded latencies of another scheduler into a scheduler.
+ *
+ * @param scheduler The scheduler receiving the latencies.
+ * @param other     The scheduler whose latencies are added.
+ */
+void merge_latencies(Scheduler *scheduler, const Scheduler *other);
+
+/**
+ * @brief Submits a job, which is pending until its class has room for it.
+ *
+ * @param scheduler The scheduler.
+ * @param job_class The priority class of the job.
+ * @param data      The data passed to the step function.
+ * @return The id of the job.
+ */
+long submit_job(Scheduler *scheduler, JobClass job_class, void *data);
+
+/**
+ * @brief Checks whether the scheduler has no pending or active job.
+ *
+ * @param scheduler The scheduler.
+ * @return 1 if it is idle, 0 otherwise.
+ */
+int scheduler_idle(const Scheduler *scheduler);
+
+/**
+ * @brief Runs one slice of the job that is next in turn.
+ *
+ * @param scheduler The scheduler.
+ * @return The job if this slice finished it, NULL otherwise. The caller frees the job with `free()` after
+ *         releasing its data.
+ */
+Job *run_slice(Scheduler *scheduler);
+
+/**
+ * @brief Returns a percentile of the latencies of the finished jobs of a class.
+ *
+ * The percentile is the upper bound of its bucket, or the longest latency if that is shorter, so the maximum is
+ * exact.
+ *
+ * @param scheduler The scheduler.
+ * @param job_class The class.
+ * @param fraction  The percentile as a fraction, e.g. 0.99.
+ * @return The latency in seconds, 0 if no job of the class has finished.
+ */
+double latency_percentile(const Scheduler *scheduler, JobClass job_class, double fraction);
+
+/**
+ * @brief Prints the number of jobs and the latency percentiles of every class as a table.
+ *
+ * @param scheduler The scheduler.
+ * @param file      The file the report is written to.
+ */
+void print_scheduler_stats(const Scheduler *scheduler, FILE *file);
+
+/**
+ * @brief Releases the resources of a scheduler. The scheduler must be idle.
+ *
+ * @param scheduler The scheduler.
+ */
+void free_scheduler(Scheduler *scheduler);
+
+#endif //SCHEDULER_H
@@ -0,0 +1,113 @@
+#include <string.h>
+#include "segments.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAS_SSE2 1
+#else
+#define HAS_SSE2 0
+#endif
+
+/**
+ * @brief Returns the index of the lowest set bit of a non-zero word.
+ */
+static unsigned lowest_bit(const uint64_t word) {
+#if defined(__GNUC__)
+    return (unsigned) __builtin_ctzll(word);
+#else
+    unsigned index = 0;
+    while (!(word >> index & 1)) index++;
+    return index;
+#endif
+}
+
+/**
+ * @brief Returns the number of set bits of a word.
+ */
+static unsigned bit_count(uint64_t word) {
+#if defined(__GNUC__)
+    return (unsigned) __builtin_popcountll(word);
+#else
+    unsigned count = 0;
+    for (; word; word &= word - 1) count++;
+    return count;
+#endif
+}
+
+void classify_samples(const double *ys, const size_t count, const double y_min, const double y_max,
+                      uint64_t *valid, uint64_t *nan) {
+    const size_t words = SEGMENT_MASK_WORDS(count);
+    size_t i = 0;
+
+    memset(valid, 0, words * sizeof(uint64_t));
+    memset(nan, 0, words * sizeof(uint64_t));
+
+#if HAS_SSE2
+    const __m128d low = _mm_set1_pd(y_min);
+    const __m128d high = _mm_set1_pd(y_max);
+    for (; i + 2 <= count; i += 2) {
+        const __m128d y = _mm_loadu_pd(ys + i);
+        // Comparisons with NaN are false, so NaN is never inside of the limits
+        const __m128d inside = _mm_and_pd(_mm_cmpge_pd(y, low), _mm_cmple_pd(y, high));
+        const __m128d unordered = _mm_cmpunord_pd(y, y);
+        valid[i / 64] |= (uint64_t) _mm_movemask_pd(inside) << (i % 64);
+        nan[i / 64] |= (uint64_t) _mm_movemask_pd(unordered) << (i % 64);
+    }
+#endif
+    for (; i < count; i++) {
+        const double y = ys[i];
+        valid[i / 64] |= (uint64_t) (y >= y_min && y <= y_max) << (i % 64);
+        nan[i / 64] |= (uint64_t) (y != y) << (i % 64);
+    }
+}
+
+/**
+ * @brief Finds the first sample at or after `start` whose bit in the mask differs from `value`.
+ *
+ * @return The index of the sample, `count` if there is none.
+ */
+static size_t next_change(const uint64_t *mask, const size_t count, const size_t start, const int value) {
+    size_t word_index = start / 64;
+    const size_t words = SEGMENT_MASK_WORDS(count);
+    uint64_t word = (value ? ~mask[word_index] : mask[word_index]) & (~0ULL << (start % 64));
+
+    while (word == 0) {
+        if (++word_index == words) return count;
+        word = value ? ~mask[word_index] : mask[word_index];
+    }
+    const size_t index = word_index * 64 + lowest_bit(word);
+    return index < count ? index : count;
+}
+
+size_t find_sample_runs(const uint64_t *valid, const uint64_t *nan, const size_t count, SampleRun *runs) {
+    size_t run_count = 0;
+    size_t start = 0;
+
+    while (start < count) {
+        const int is_valid = (int) (valid[start / 64] >> (start % 64) & 1);
+        const size_t end = next_change(valid, count, start, is_valid);
+        SampleRun *run = &runs[run_count++];
+        run->start = start;
+        run->length = end - start;
+        if (is_valid) {
+            run->kind = RUN_VALID;
+        } else {
+            run->kind = nan[start / 64] >> (start % 64) & 1 ? RUN_NAN : RUN_OUT_OF_RANGE;
+        }
+        start = end;
+    }
+    return run_count;
+}
+
+size_t count_mask_bits(const uint64_t *mask, const size_t count) {
+    const size_t words = SEGMENT_MASK_WORDS(count);
+    size_t bits = 0;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t word = mask[i];
+        if (i == words - 1 && count % 64) {
+            word &= (1ULL << (count % 64)) - 1;
+        }
+        bits += bit_count(word);
+    }
+    return bits;
+}
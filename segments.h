@@ -0,0 +1,76 @@
+#ifndef SEGMENTS_H
+#define SEGMENTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of 64-bit mask words needed for `count` samples.
+ */
+#define SEGMENT_MASK_WORDS(count) (((count) + 63) / 64)
+
+/**
+ * @brief Kind of a run of consecutive samples.
+ *
+ * Runs of samples that can not be drawn may mix NaN and out-of-range samples. Only the first sample of such
+ * a run decides whether the current path is closed, so the run takes the kind of its first sample.
+ */
+typedef enum RunKind {
+    RUN_VALID, /**< Samples inside of the y limits */
+    RUN_NAN, /**< Samples that could not be evaluated, starting with a NaN */
+    RUN_OUT_OF_RANGE /**< Samples that could not be drawn, starting with one outside of the y limits */
+} RunKind;
+
+/**
+ * @brief A run of consecutive samples of the same kind.
+ *
+ * @struct SampleRun
+ * @member start The index of the first sample of the run.
+ * @member length The number of samples of the run.
+ * @member kind The kind of the run.
+ */
+typedef struct SampleRun {
+    size_t start;
+    size_t length;
+    RunKind kind;
+} SampleRun;
+
+/**
+ * @brief Classifies a block of y values into validity masks without branching on the values.
+ *
+ * Bit i of `valid` is set if `ys[i]` lies within [y_min, y_max], bit i of `nan` is set if `ys[i]` is NaN.
+ * Values that are neither are out of range. On x86 the comparisons are done two values at a time with SSE2.
+ *
+ * @param ys    The y values.
+ * @param count The number of values.
+ * @param y_min The lower y limit.
+ * @param y_max The upper y limit.
+ * @param valid Output mask of SEGMENT_MASK_WORDS(count) words.
+ * @param nan   Output mask of SEGMENT_MASK_WORDS(count) words.
+ */
+void classify_samples(const double *ys, size_t count, double y_min, double y_max, uint64_t *valid, uint64_t *nan);
+
+/**
+ * @brief Turns validity masks into runs of valid and invalid samples.
+ *
+ * Run boundaries are found by counting trailing zeros of the mask words, so the work is proportional to the
+ * number of runs rather than the number of samples.
+ *
+ * @param valid The mask of valid samples.
+ * @param nan   The mask of NaN samples.
+ * @param count The number of samples.
+ * @param runs  Output array with room for `count` runs.
+ * @return The number of runs written.
+ */
+size_t find_sample_runs(const uint64_t *valid, const uint64_t *nan, size_t count, SampleRun *runs);
+
+/**
+ * @brief Counts the set bits of a mask.
+ *
+ * @param mask  The mask.
+ * @param count The number of samples covered by the mask.
+ * @return The number of set bits.
+ */
+size_t count_mask_bits(const uint64_t *mask, size_t count);
+
+#endif //SEGMENTS_H
@@ -0,0 +1,1239 @@
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#define open _open
+#define read _read
+#define close _close
+#define flockfile _lock_file
+#define funlockfile _unlock_file
+#else
+#include <poll.h>
+#include <sys/select.h>
+#include <unistd.h>
+#endif
+#include <pthread.h>
+#include "serve.h"
+#include "err.h"
+#include "timer.h"
+#include "ranges.h"
+#include "allocations.h"
+
+/**
+ * @brief Initial capacity of the buffer of the request reader.
+ */
+#define REQUEST_BUFFER_CAPACITY 4096
+
+/**
+ * @brief Reads the requests line by line without blocking while jobs are in progress.
+ *
+ * The input is read with `read()` instead of stdio, so that no complete request can hide in a stdio buffer
+ * while `poll()` reports the descriptor as not readable.
+ *
+ * @struct RequestReader
+ * @member fd The descriptor of the input.
+ * @member buffer The bytes read and not yet consumed.
+ * @member length The number of bytes in the buffer.
+ * @member capacity The capacity of the buffer.
+ * @member eof 1 once the input ended.
+ * @member line The number of requests read so far.
+ * @member request The last request taken out of the buffer.
+ * @member request_capacity The allocated size of `request`.
+ * @member fields The arena the fields of the last request are copied to.
+ */
+typedef struct RequestReader {
+    int fd;
+    char *buffer;
+    size_t length;
+    size_t capacity;
+    int eof;
+    long line;
+    char *request;
+    size_t request_capacity;
+    Arena fields;
+} RequestReader;
+
+/**
+ * @brief Curve indexes of the last finished pages, shared by the workers finishing pages and the reading thread.
+ *
+ * The program of a page is specialised to its grid, so point queries take a program for the expressions of the
+ * page from the pool of the reading thread.
+ *
+ * A page is kept by swapping its index with the one of the page it replaces, which the buffers of the job reuse
+ * for their next page, so keeping a page allocates nothing.
+ *
+ * @struct IndexTable
+ * @member ids Per slot: the id of the job of the kept index, 0 if the slot is empty.
+ * @member indexes Per slot: the kept index.
+ * @member expressions Per slot: the expressions of the page.
+ * @member capacities Per slot: the allocated size of `expressions`.
+ * @member mutex Protects the table.
+ */
+typedef struct IndexTable {
+    long ids[KEPT_INDEX_COUNT];
+    CurveIndex indexes[KEPT_INDEX_COUNT];
+    char *expressions[KEPT_INDEX_COUNT];
+    size_t capacities[KEPT_INDEX_COUNT];
+    pthread_mutex_t mutex;
+} IndexTable;
+
+static IndexTable kept_indexes = {{0}, {{{0}}}, {0}, {0}, PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * @brief The memory a render job samples into and writes from, kept by the pool of a thread between jobs.
+ *
+ * Every array only grows, so buffers that served a job serve every job that is not larger without allocating.
+ *
+ * @struct RenderBuffers
+ * @member xs The x values of the grid.
+ * @member ys Per result: its values over the grid.
+ * @member block_ys Per result: the position of the current block in `ys`.
+ * @member registers Scratch memory for one block of every instruction.
+ * @member sample_capacity The number of samples `xs` and every array of `ys` have room for.
+ * @member result_capacity The number of results `ys` and `block_ys` have room for.
+ * @member register_capacity The number of instructions `registers` has room for.
+ * @member index The spatial index of the curves, built block by block while sampling.
+ * @member page The stream of the last page, reused for the next one, NULL if there is none (always on Windows).
+ * @member next The next idle buffers of the pool.
+ */
+typedef struct RenderBuffers {
+    double *xs;
+    double **ys;
+    double **block_ys;
+    double *registers;
+    size_t sample_capacity;
+    size_t result_capacity;
+    size_t register_capacity;
+    CurveIndex index;
+    FILE *page;
+    struct RenderBuffers *next;
+} RenderBuffers;
+
+/**
+ * @brief A compiled program kept for its expressions being requested again.
+ *
+ * @struct CachedProgram
+ * @member expressions The expressions the program was compiled from.
+ * @member capacity The allocated size of `expressions`, which is kept when the entry is empty.
+ * @member recurrences 1 if recurrences are enabled in the program.
+ * @member program The program, NULL if the entry is empty.
+ * @member used When the program was last given back, for replacing the least recently used one.
+ */
+typedef struct CachedProgram {
+    char *expressions;
+    size_t capacity;
+    int recurrences;
+    Program *program;
+    unsigned long long used;
+} CachedProgram;
+
+/**
+ * @brief Scratch memory of one thread, reused by the jobs and queries it runs one after the other.
+ *
+ * Every thread running jobs has its own pool, so taking from it and giving back needs no lock. A job stays on
+ * its thread, so it gives back to the pool it took from.
+ *
+ * @struct ScratchPool
+ * @member arena The arena the expressions are parsed in.
+ * @member programs The programs of the last expressions, a program in use by a job is taken out.
+ * @member clock Counts the programs given back, for `CachedProgram.used`.
+ * @member idle The buffers not in use by a job.
+ * @member next The next pool of the list of all pools.
+ */
+typedef struct ScratchPool {
+    Arena arena;
+    CachedProgram programs[PROGRAM_CACHE_SIZE];
+    unsigned long long clock;
+    RenderBuffers *idle;
+    struct ScratchPool *next;
+} ScratchPool;
+
+/**
+ * @brief The pool of the calling thread, NULL before its first job.
+ */
+static THREAD_LOCAL ScratchPool *thread_pool;
+
+/**
+ * @brief Every pool, freed when the server ends.
+ */
+static ScratchPool *scratch_pools;
+
+/**
+ * @brief Protects `scratch_pools`.
+ */
+static pthread_mutex_t scratch_pools_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Finished render jobs kept for the next requests.
+ *
+ * Jobs are taken by the reading thread and given back by the threads running them.
+ *
+ * @struct IdleJobs
+ * @member first The first idle job.
+ * @member count The number of idle jobs.
+ * @member mutex Protects the list.
+ */
+typedef struct IdleJobs {
+    RenderJob *first;
+    size_t count;
+    pthread_mutex_t mutex;
+} IdleJobs;
+
+static IdleJobs idle_jobs = {NULL, 0, PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * @brief A point query waiting for its batch.
+ *
+ * @struct PointQuery
+ * @member id The id of the page.
+ * @member x The x value.
+ * @member line The number of the request, for rejecting it.
+ * @member ys The values of the curves at x in the scratch arena of the batch, NULL until the batch is evaluated
+ *            or if the page is unknown.
+ */
+typedef struct PointQuery {
+    long id;
+    double x;
+    long line;
+    double *ys;
+} PointQuery;
+
+/**
+ * @brief Point queries collected within the current window.
+ *
+ * @struct PointBatch
+ * @member window The time in seconds that queries are collected.
+ * @member deadline The time the current window closes, valid while queries are pending.
+ * @member queries The pending queries in the order they arrived.
+ * @member count The number of pending queries.
+ * @member query_count The number of queries answered so far.
+ * @member batch_count The number of blocks of queries evaluated together so far.
+ * @member scratch The arena of the registers and the values of the batch, reset after answering it.
+ * @member allocations The heap allocations made for answering the queries so far.
+ */
+typedef struct PointBatch {
+    double window;
+    double deadline;
+    PointQuery queries[POINT_BATCH_CAPACITY];
+    size_t count;
+    size_t query_count;
+    size_t batch_count;
+    Arena scratch;
+    size_t allocations;
+} PointBatch;
+
+/**
+ * @brief Checks whether reading the input would not block.
+ *
+ * @param fd The descriptor of the input.
+ * @return 1 if the input has data or ended, 0 otherwise (always 0 on Windows).
+ */
+static int input_ready(const int fd) {
+#ifdef _WIN32
+    (void) fd;
+    return 0;
+#else
+    struct pollfd descriptor = {fd, POLLIN, 0};
+    return poll(&descriptor, 1, 0) > 0;
+#endif
+}
+
+/**
+ * @brief Waits until reading the input would not block, at most for a time.
+ *
+ * @param fd      The descriptor of the input.
+ * @param timeout The longest wait in seconds.
+ * @return 1 if the input has data or ended, 0 if the time is up (always 0 on Windows, without waiting).
+ */
+static int wait_input(const int fd, const double timeout) {
+#ifdef _WIN32
+    (void) fd;
+    (void) timeout;
+    return 0;
+#else
+    fd_set descriptors;
+    FD_ZERO(&descriptors);
+    FD_SET(fd, &descriptors);
+    struct timeval wait = {(long) timeout, (long) (1e6 * (timeout - floor(timeout)))};
+    return select(fd + 1, &descriptors, NULL, NULL, &wait) > 0;
+#endif
+}
+
+/**
+ * @brief Reads the next chunk of the input into the buffer, blocking until it arrives.
+ */
+static void read_input(RequestReader *reader) {
+    if (reader->length == reader->capacity) {
+        reader->capacity *= 2;
+        reader->buffer = realloc(reader->buffer, reader->capacity);
+    }
+    const long bytes = (long) read(reader->fd, reader->buffer + reader->length,
+                                   (unsigned) (reader->capacity - reader->length));
+    if (bytes <= 0) {
+        reader->eof = 1;
+    } else {
+        reader->length += (size_t) bytes;
+    }
+}
+
+/**
+ * @brief Takes the next complete request out of the buffer.
+ *
+ * After the end of the input the remaining bytes count as the last request. The fields of the request before
+ * are released.
+ *
+ * @param reader The reader.
+ * @return The request without its line break, valid until the next call, or NULL if there is none.
+ */
+static char *next_request(RequestReader *reader) {
+    char *end = memchr(reader->buffer, '\n', reader->length);
+    size_t length;
+    size_t consumed;
+
+    if (end) {
+        length = (size_t) (end - reader->buffer);
+        consumed = length + 1;
+    } else if (reader->eof && reader->length) {
+        length = reader->length;
+        consumed = length;
+    } else {
+        return NULL;
+    }
+    if (length && reader->buffer[length - 1] == '\r') {
+        length--;
+    }
+
+    if (length + 1 > reader->request_capacity) {
+        reader->request_capacity = length + 1 > 2 * reader->request_capacity ? length + 1
+                                                                              : 2 * reader->request_capacity;
+        reader->request = realloc(reader->request, reader->request_capacity);
+    }
+    memcpy(reader->request, reader->buffer, length);
+    reader->request[length] = '\0';
+    memmove(reader->buffer, reader->buffer + consumed, reader->length - consumed);
+    reader->length -= consumed;
+    reader->line++;
+    reset_arena(&reader->fields);
+    return reader->request;
+}
+
+/**
+ * @brief Copies the next field of a request, which ends at a REQUEST_SEPARATOR or at the end of the line.
+ *
+ * @param cursor Pointer to the position in the request, advanced behind the field and the separators after it.
+ * @param fields The arena the field is copied to.
+ * @return The field, or NULL if the request has no further field.
+ */
+static char *next_field(const char **cursor, Arena *fields) {
+    const char *start = *cursor;
+    while (*start == REQUEST_SEPARATOR) {
+        start++;
+    }
+    const char *end = start;
+    while (*end != '\0' && *end != REQUEST_SEPARATOR) {
+        end++;
+    }
+    if (end == start) {
+        return NULL;
+    }
+
+    char *field = arena_copy(fields, start, (size_t) (end - start));
+    while (*end == REQUEST_SEPARATOR) {
+        end++;
+    }
+    *cursor = end;
+    return field;
+}
+
+/**
+ * @brief Copies a string into a buffer that is only allocated again when the string does not fit.
+ *
+ * @param buffer   The buffer, NULL if none is allocated yet.
+ * @param capacity The allocated size of the buffer.
+ * @param text     The string.
+ */
+static void copy_into(char **buffer, size_t *capacity, const char *text) {
+    const size_t size = strlen(text) + 1;
+    if (size > *capacity) {
+        free(*buffer);
+        *capacity = size > 2 * *capacity ? size : 2 * *capacity;
+        *buffer = malloc(*capacity);
+    }
+    memcpy(*buffer, text, size);
+}
+
+RenderJob *parse_render_request(const char *line, const ServeSettings *settings, JobClass *job_class,
+                                Arena *fields) {
+    const char *cursor = line;
+    char *class_field = next_field(&cursor, fields);
+    char *output_field = next_field(&cursor, fields);
+    char *limits_field = next_field(&cursor, fields);
+    int valid = class_field && output_field && limits_field && *cursor != '\0';
+    Limits limits = {-DEFAULT_LIMIT_VALUE, DEFAULT_LIMIT_VALUE, -DEFAULT_LIMIT_VALUE, DEFAULT_LIMIT_VALUE};
+
+    if (valid) {
+        valid = parse_job_class(class_field, job_class) == 0 &&
+                (strcmp(limits_field, DEFAULT_LIMITS_FIELD) == 0 || parse_limits(limits_field, &limits) == 0) &&
+                check_expression_text(cursor, fields, NULL) == 0;
+    }
+    if (!valid) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&idle_jobs.mutex);
+    RenderJob *job = idle_jobs.first;
+    if (job) {
+        idle_jobs.first = job->next;
+        idle_jobs.count--;
+    }
+    pthread_mutex_unlock(&idle_jobs.mutex);
+
+    if (!job) {
+        job = calloc(1, sizeof(RenderJob));
+    }
+    job->settings = settings;
+    copy_into(&job->output_file_name, &job->name_capacity, output_field);
+    copy_into(&job->expressions, &job->expressions_capacity, cursor);
+    job->limits = limits;
+    job->program = NULL;
+    job->buffers = NULL;
+    job->offset = 0;
+    job->file = NULL;
+    job->series = 0;
+    job->emitted = 0;
+    job->failed = 0;
+    job->allocations = 0;
+    job->next = NULL;
+    return job;
+}
+
+/**
+ * @brief Returns the pool of the calling thread, creating it on the first call of the thread.
+ */
+static ScratchPool *scratch_pool(void) {
+    if (!thread_pool) {
+        thread_pool = calloc(1, sizeof(ScratchPool));
+        initialize_arena(&thread_pool->arena, 0);
+        pthread_mutex_lock(&scratch_pools_mutex);
+        thread_pool->next = scratch_pools;
+        scratch_pools = thread_pool;
+        pthread_mutex_unlock(&scratch_pools_mutex);
+    }
+    return thread_pool;
+}
+
+/**
+ * @brief Takes a program for expressions out of a pool, compiling them if the pool has none.
+ *
+ * A taken program is not shared, so a job may specialise it to its own limits. The expressions must have been
+ * checked with `check_expression_text()`, so compiling them can not fail.
+ *
+ * @param pool        The pool.
+ * @param expressions The expressions.
+ * @param recurrences 1 for a program with recurrences, see `enable_recurrences()`.
+ * @return The program, given back with `give_program()`.
+ */
+static Program *take_program(ScratchPool *pool, const char *expressions, const int recurrences) {
+    for (size_t i = 0; i < PROGRAM_CACHE_SIZE; i++) {
+        CachedProgram *entry = &pool->programs[i];
+        if (entry->program && entry->recurrences == recurrences && strcmp(entry->expressions, expressions) == 0) {
+            Program *program = entry->program;
+            entry->program = NULL;
+            return program;
+        }
+    }
+
+    Program *program = compile_expression_text(expressions, 0, &pool->arena, NULL);
+    if (recurrences) {
+        stage_begin(STAGE_COMPILE);
+        enable_recurrences(program, X_EVALUATION_STEP);
+        stage_end(STAGE_COMPILE);
+    }
+    return program;
+}
+
+/**
+ * @brief Gives a program back to a pool, replacing the least recently used one if the pool is full.
+ *
+ * If the pool is full and holds a copy of the program already, the program is freed instead.
+ *
+ * @param pool        The pool.
+ * @param expressions The expressions the program was compiled from.
+ * @param recurrences 1 if recurrences are enabled in the program.
+ * @param program     The program, taken with `take_program()`.
+ */
+static void give_program(ScratchPool *pool, const char *expressions, const int recurrences, Program *program) {
+    CachedProgram *entry = &pool->programs[0];
+    int duplicate = 0;
+    for (size_t i = 0; i < PROGRAM_CACHE_SIZE; i++) {
+        const CachedProgram *other = &pool->programs[i];
+        duplicate = duplicate || (other->program && other->recurrences == recurrences &&
+                                  strcmp(other->expressions, expressions) == 0);
+        if (entry->program && (!other->program || other->used < entry->used)) {
+            entry = &pool->programs[i];
+        }
+    }
+
+    // A second copy for jobs of the same expressions at once only takes an empty entry
+    if (entry->program && duplicate) {
+        free_program(program);
+        return;
+    }
+    free_program(entry->program);
+    copy_into(&entry->expressions, &entry->capacity, expressions);
+    entry->recurrences = recurrences;
+    entry->program = program;
+    entry->used = ++pool->clock;
+}
+
+/**
+ * @brief Takes buffers with room for a render out of a pool, growing them if they are too small.
+ *
+ * @param pool         The pool.
+ * @param result_count The number of results.
+ * @param count        The number of samples.
+ * @param length       The number of instructions of the program.
+ * @return The buffers, given back with `give_buffers()`.
+ */
+static RenderBuffers *take_buffers(ScratchPool *pool, const size_t result_count, size_t count, const size_t length) {
+    RenderBuffers *buffers = pool->idle;
+    if (buffers) {
+        pool->idle = buffers->next;
+    } else {
+        buffers = calloc(1, sizeof(RenderBuffers));
+    }
+
+    count = count ? count : 1;
+    if (result_count > buffers->result_capacity) {
+        buffers->ys = realloc(buffers->ys, result_count * sizeof(double *));
+        buffers->block_ys = realloc(buffers->block_ys, result_count * sizeof(double *));
+        for (size_t i = buffers->result_capacity; i < result_count; i++) {
+            buffers->ys[i] = malloc(buffers->sample_capacity * sizeof(double));
+        }
+        buffers->result_capacity = result_count;
+    }
+    if (count > buffers->sample_capacity) {
+        buffers->xs = realloc(buffers->xs, count * sizeof(double));
+        for (size_t i = 0; i < buffers->result_capacity; i++) {
+            buffers->ys[i] = realloc(buffers->ys[i], count * sizeof(double));
+        }
+        buffers->sample_capacity = count;
+    }
+    if (length > buffers->register_capacity) {
+        buffers->registers = realloc(buffers->registers, length * SAMPLE_BLOCK_SIZE * sizeof(double));
+        buffers->register_capacity = length;
+    }
+    return buffers;
+}
+
+/**
+ * @brief Gives buffers back to a pool.
+ *
+ * @param pool    The pool.
+ * @param buffers The buffers, taken with `take_buffers()`.
+ */
+static void give_buffers(ScratchPool *pool, RenderBuffers *buffers) {
+    buffers->next = pool->idle;
+    pool->idle = buffers;
+}
+
+/**
+ * @brief Frees every pool, once no thread uses them any more.
+ */
+static void free_scratch_pools(void) {
+    while (scratch_pools) {
+        ScratchPool *pool = scratch_pools;
+        scratch_pools = pool->next;
+        for (size_t i = 0; i < PROGRAM_CACHE_SIZE; i++) {
+            free_program(pool->programs[i].program);
+            free(pool->programs[i].expressions);
+        }
+        while (pool->idle) {
+            RenderBuffers *buffers = pool->idle;
+            pool->idle = buffers->next;
+            for (size_t i = 0; i < buffers->result_capacity; i++) {
+                free(buffers->ys[i]);
+            }
+            free(buffers->xs);
+            free(buffers->ys);
+            free(buffers->block_ys);
+            free(buffers->registers);
+            free_curve_index(&buffers->index);
+            if (buffers->page) {
+                fclose(buffers->page);
+            }
+            free(buffers);
+        }
+        free_arena(&pool->arena);
+        free(pool);
+    }
+    thread_pool = NULL;
+}
+
+/**
+ * @brief Compiles the expressions of a render job and allocates its samples, the first slice of the job.
+ *
+ * The program and the buffers are taken from the pool of the thread, so nothing is compiled or allocated if the
+ * thread rendered the expressions before.
+ */
+static void start_render_job(RenderJob *job) {
+    ScratchPool *pool = scratch_pool();
+    job->program = take_program(pool, job->expressions, job->settings->recurrences);
+
+    stage_begin(STAGE_COMPILE);
+    specialise_ranges(job->program, &job->limits, job->settings->narrow_kernels);
+    stage_end(STAGE_COMPILE);
+
+    // A deep zoom is drawn in one piece by draw_graph(), so nothing is sampled ahead
+    const size_t result_count = job->program->result_count;
+    job->count = needs_deep_zoom(&job->limits) ? 0 : count_samples(&job->limits);
+    job->cursor = job->limits.x_min;
+    job->scale_x = (PAGE_WIDTH - PAGE_MARGIN) / (job->limits.x_max - job->limits.x_min);
+    job->scale_y = (PAGE_HEIGHT - PAGE_MARGIN) / (job->limits.y_max - job->limits.y_min);
+    job->buffers = take_buffers(pool, result_count, job->count, job->program->length);
+    reuse_curve_index(&job->buffers->index, &job->limits, job->scale_x, job->scale_y, result_count, job->count);
+}
+
+/**
+ * @brief Opens the page of a render job for writing.
+ *
+ * The stream of the last page of the buffers is reused: the new file takes the place of the last one under the
+ * descriptor of the stream, which closes the last one, and the stream is rewound. Only the first page of the
+ * buffers opens a stream with `fopen()`.
+ *
+ * @return The stream, NULL if the file can not be opened.
+ */
+static FILE *open_render_page(const RenderJob *job) {
+    RenderBuffers *buffers = job->buffers;
+#ifndef _WIN32
+    if (buffers->page) {
+        const int fd = open(job->output_file_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            return NULL;
+        }
+        dup2(fd, fileno(buffers->page));
+        close(fd);
+        rewind(buffers->page);
+        return buffers->page;
+    }
+#endif
+    FILE *file = fopen(job->output_file_name, job->settings->binary_paths ? "wb" : "w");
+    if (file && job->settings->output_buffer) {
+        setvbuf(file, NULL, _IOFBF, job->settings->output_buffer);
+    }
+    return file;
+}
+
+/**
+ * @brief Flushes the page of a render job, so it is complete before the job is answered.
+ *
+ * The stream is kept by the buffers of the job for the next page, on Windows it is closed.
+ */
+static void close_render_page(RenderJob *job) {
+    stage_begin(STAGE_FLUSH);
+    fflush(job->file);
+    stage_end(STAGE_FLUSH);
+    const long bytes_written = ftell(job->file);
+    run_stats.bytes_written += bytes_written > 0 ? (unsigned long long) bytes_written : 0;
+#ifdef _WIN32
+    fclose(job->file);
+#else
+    job->buffers->page = job->file;
+#endif
+    job->file = NULL;
+}
+
+/**
+ * @brief Opens the page of a render job and writes its background, once all samples are evaluated.
+ *
+ * A deep zoom is written completely by `draw_graph()`.
+ *
+ * @return 0 if the curves follow, 1 if the job is finished.
+ */
+static int begin_render_page(RenderJob *job) {
+    finish_curve_index(&job->buffers->index);
+    job->file = open_render_page(job);
+    if (!job->file) {
+        job->failed = 1;
+        return 1;
+    }
+    if (needs_deep_zoom(&job->limits)) {
+        draw_graph(&job->limits, job->file, job->program);
+        close_render_page(job);
+        return 1;
+    }
+
+    stage_begin(STAGE_EMIT);
+    draw_background(&job->limits, job->file, &job->scale_x, &job->scale_y);
+    stage_end(STAGE_EMIT);
+    return 0;
+}
+
+/**
+ * @brief Writes the next block of the current curve of a render job.
+ */
+static void write_render_block(RenderJob *job) {
+    const size_t remaining = job->count - job->emitted;
+    const size_t block = remaining < SAMPLE_BLOCK_SIZE ? remaining : SAMPLE_BLOCK_SIZE;
+
+    stage_begin(STAGE_EMIT);
+    if (job->emitted == 0) {
+        begin_series(job->file, job->series);
+        job->path = (PathState) {1, 0, proven_inside(job->program, job->series, &job->limits)};
+    }
+    TRACE_BEGIN_PHASE("format_chunk");
+    draw_samples(&job->limits, job->file, &job->scale_x, &job->scale_y, job->buffers->xs + job->emitted,
+                 job->buffers->ys[job->series] + job->emitted, block, &job->path);
+    TRACE_END_PHASE("format_chunk");
+    stage_end(STAGE_EMIT);
+
+    job->emitted += block;
+    if (job->emitted == job->count) {
+        job->series++;
+        job->emitted = 0;
+    }
+}
+
+/**
+ * @brief Finishes and closes the page of a render job.
+ */
+static void end_render_page(RenderJob *job) {
+    stage_begin(STAGE_EMIT);
+    finish(job->file);
+    stage_end(STAGE_EMIT);
+    close_render_page(job);
+}
+
+/**
+ * @brief Performs the next slice of a render job.
+ *
+ * @return 1 if the page is written or could not be opened, 0 otherwise.
+ */
+static int run_render_slice(RenderJob *job) {
+    if (!job->program) {
+        start_render_job(job);
+        return 0;
+    }
+    RenderBuffers *buffers = job->buffers;
+    if (job->offset < job->count) {
+        stage_begin(STAGE_EVALUATE);
+        TRACE_BEGIN_PHASE("sample_chunk");
+        const size_t block = next_sample_block(&job->limits, &job->cursor, buffers->xs + job->offset,
+                                               SAMPLE_BLOCK_SIZE);
+        for (size_t i = 0; i < job->program->result_count; i++) {
+            buffers->block_ys[i] = buffers->ys[i] + job->offset;
+        }
+        execute_block(job->program, buffers->xs + job->offset, block, NULL, buffers->registers, buffers->block_ys);
+        index_samples(&buffers->index, buffers->xs + job->offset, buffers->block_ys, block);
+        TRACE_END_PHASE("sample_chunk");
+        stage_end(STAGE_EVALUATE);
+        job->offset += block;
+        if (block) {
+            return 0;
+        }
+        job->count = job->offset; // The grid ended early, draw what was sampled
+    }
+    if (!job->file) {
+        return begin_render_page(job);
+    }
+    if (job->series < job->program->result_count) {
+        write_render_block(job);
+        return 0;
+    }
+
+    end_render_page(job);
+    return 1;
+}
+
+int step_render_job(void *data) {
+    RenderJob *job = data;
+    const size_t allocations = heap_allocations();
+    const int finished = run_render_slice(job);
+    job->allocations += heap_allocations() - allocations;
+    return finished;
+}
+
+void release_render_job(RenderJob *job) {
+    if (job->program) {
+        ScratchPool *pool = scratch_pool();
+        give_program(pool, job->expressions, job->settings->recurrences, job->program);
+        give_buffers(pool, job->buffers);
+        job->program = NULL;
+        job->buffers = NULL;
+    }
+
+    pthread_mutex_lock(&idle_jobs.mutex);
+    const int kept = idle_jobs.count < IDLE_JOB_LIMIT;
+    if (kept) {
+        job->next = idle_jobs.first;
+        idle_jobs.first = job;
+        idle_jobs.count++;
+    }
+    pthread_mutex_unlock(&idle_jobs.mutex);
+    if (!kept) {
+        free_render_job(job);
+    }
+}
+
+void free_render_job(RenderJob *job) {
+    free(job->expressions);
+    free(job->output_file_name);
+    free(job);
+}
+
+/**
+ * @brief Frees the idle render jobs.
+ */
+static void free_idle_jobs(void) {
+    while (idle_jobs.first) {
+        RenderJob *job = idle_jobs.first;
+        idle_jobs.first = job->next;
+        free_render_job(job);
+    }
+    idle_jobs.count = 0;
+}
+
+/**
+ * @brief Frees the page kept in a slot of the table of kept indexes.
+ */
+static void drop_kept_page(const size_t slot) {
+    free_curve_index(&kept_indexes.indexes[slot]);
+    free(kept_indexes.expressions[slot]);
+    kept_indexes.ids[slot] = 0;
+    kept_indexes.expressions[slot] = NULL;
+    kept_indexes.capacities[slot] = 0;
+}
+
+/**
+ * @brief Keeps the curve index of a finished page for queries, replacing the page kept in its slot.
+ *
+ * The expressions are copied into the memory of the replaced page.
+ *
+ * @param id  The id of the job of the page.
+ * @param job The job, whose buffers take over the index of the replaced page.
+ */
+static void keep_index(const long id, RenderJob *job) {
+    const size_t slot = (size_t) id % KEPT_INDEX_COUNT;
+
+    pthread_mutex_lock(&kept_indexes.mutex);
+    const CurveIndex replaced = kept_indexes.indexes[slot];
+    kept_indexes.ids[slot] = id;
+    kept_indexes.indexes[slot] = job->buffers->index;
+    copy_into(&kept_indexes.expressions[slot], &kept_indexes.capacities[slot], job->expressions);
+    pthread_mutex_unlock(&kept_indexes.mutex);
+    job->buffers->index = replaced;
+}
+
+/**
+ * @brief Frees every kept curve index.
+ */
+static void free_kept_indexes(void) {
+    for (size_t slot = 0; slot < KEPT_INDEX_COUNT; slot++) {
+        if (kept_indexes.ids[slot]) {
+            drop_kept_page(slot);
+        }
+    }
+}
+
+/**
+ * @brief Parses the next field of a query as a number.
+ *
+ * @return 0 on success, 1 if the field is missing or not a number.
+ */
+static int next_number(const char **cursor, Arena *fields, double *value) {
+    char *field = next_field(cursor, fields);
+    char *endptr = field;
+    if (field) {
+        *value = strtod(field, &endptr);
+    }
+    return !field || endptr == field || *endptr != '\0';
+}
+
+/**
+ * @brief Parses the next field of a query as a page id.
+ *
+ * @return 0 on success, 1 if the field is missing or not an integer from 1 to LONG_MAX.
+ */
+static int next_id(const char **cursor, Arena *fields, long *id) {
+    char *field = next_field(cursor, fields);
+    char *endptr = field;
+    if (field) {
+        errno = 0;
+        *id = strtol(field, &endptr, 10);
+    }
+    return !field || endptr == field || *endptr != '\0' || errno == ERANGE || *id < 1;
+}
+
+/**
+ * @brief Answers a value or nearest query from the kept curve indexes.
+ *
+ * @param request The request.
+ * @param line    The number of the request, for rejecting it.
+ * @param fields  The arena the fields of the request are copied to.
+ * @return 1 if the request is not a query, 0 if it was answered.
+ */
+static int answer_query(const char *request, const long line, Arena *fields) {
+    const char *cursor = request;
+    const char *kind = next_field(&cursor, fields);
+    const int value_query = kind && strcmp(kind, VALUE_QUERY) == 0;
+    const int nearest_query = kind && strcmp(kind, NEAREST_QUERY) == 0;
+    if (!value_query && !nearest_query) {
+        return 1;
+    }
+
+    long id;
+    double page_x;
+    double page_y = 0.0;
+    int valid = next_id(&cursor, fields, &id) == 0 && next_number(&cursor, fields, &page_x) == 0 &&
+                (value_query || next_number(&cursor, fields, &page_y) == 0) && *cursor == '\0';
+
+    pthread_mutex_lock(&kept_indexes.mutex);
+    const size_t slot = valid ? (size_t) id % KEPT_INDEX_COUNT : 0;
+    valid = valid && kept_indexes.ids[slot] == id;
+    if (!valid) {
+        printf("rejected %ld %s\n", line, ERROR_QUERY_TEXT);
+    } else if (value_query) {
+        // The answer is printed in parts, which the lines of finished jobs must not split
+        const CurveIndex *index = &kept_indexes.indexes[slot];
+        flockfile(stdout);
+        printf("value %ld", id);
+        for (size_t i = 0; i < index->result_count; i++) {
+            double y;
+            if (curve_value_at(index, i, page_x, &y) == 0) {
+                printf(" %.9g", y);
+            } else {
+                printf(" -");
+            }
+        }
+        printf("\n");
+        funlockfile(stdout);
+    } else {
+        IndexHit hit;
+        if (nearest_curve_point(&kept_indexes.indexes[slot], page_x, page_y, &hit) == 0) {
+            printf("nearest %ld %zu %.9g %.9g %.3f\n", id, hit.result, hit.x, hit.y, hit.distance);
+        } else {
+            printf("nearest %ld -\n", id);
+        }
+    }
+    pthread_mutex_unlock(&kept_indexes.mutex);
+    fflush(stdout);
+    return 0;
+}
+
+/**
+ * @brief Evaluates the queries of one page in the batch together, from the first one on.
+ *
+ * The queries are gathered into blocks of SAMPLE_BLOCK_SIZE x values, evaluated by a program for the expressions
+ * of the page from the pool of the calling thread and their values scattered back to the queries. The table of
+ * kept indexes must be locked.
+ *
+ * @param batch The batch.
+ * @param first The first query of the page that is not evaluated yet.
+ */
+static void evaluate_page_queries(PointBatch *batch, const size_t first) {
+    const long id = batch->queries[first].id;
+    const size_t slot = (size_t) id % KEPT_INDEX_COUNT;
+    if (kept_indexes.ids[slot] != id) {
+        return; // Unknown page, the queries are rejected
+    }
+
+    // A program rendered by this thread may be specialised to its grid, but the queries may lie anywhere
+    ScratchPool *pool = scratch_pool();
+    Program *program = take_program(pool, kept_indexes.expressions[slot], 0);
+    widen_kernels(program);
+    const size_t result_count = program->result_count;
+    double *registers = arena_allocate(&batch->scratch, program->length * SAMPLE_BLOCK_SIZE * sizeof(double));
+    double *block_ys = arena_allocate(&batch->scratch, result_count * SAMPLE_BLOCK_SIZE * sizeof(double));
+    double **outputs = arena_allocate(&batch->scratch, result_count * sizeof(double *));
+    for (size_t r = 0; r < result_count; r++) {
+        outputs[r] = block_ys + r * SAMPLE_BLOCK_SIZE;
+    }
+
+    double xs[SAMPLE_BLOCK_SIZE];
+    size_t members[SAMPLE_BLOCK_SIZE];
+    size_t next = first;
+    while (next < batch->count) {
+        size_t count = 0;
+        for (; next < batch->count && count < SAMPLE_BLOCK_SIZE; next++) {
+            if (batch->queries[next].id == id) {
+                xs[count] = batch->queries[next].x;
+                members[count++] = next;
+            }
+        }
+        if (!count) {
+            break;
+        }
+
+        stage_begin(STAGE_EVALUATE);
+        execute_block(program, xs, count, NULL, registers, outputs);
+        stage_end(STAGE_EVALUATE);
+        for (size_t i = 0; i < count; i++) {
+            PointQuery *query = &batch->queries[members[i]];
+            query->ys = arena_allocate(&batch->scratch, result_count * sizeof(double));
+            for (size_t r = 0; r < result_count; r++) {
+                query->ys[r] = outputs[r][i];
+            }
+        }
+        batch->batch_count++;
+    }
+
+    give_program(pool, kept_indexes.expressions[slot], 0, program);
+}
+
+/**
+ * @brief Evaluates the pending point queries page by page and answers them in the order they arrived.
+ *
+ * @param batch The batch, empty afterwards.
+ */
+static void flush_point_batch(PointBatch *batch) {
+    if (!batch->count) {
+        return;
+    }
+
+    const size_t allocations = heap_allocations();
+    pthread_mutex_lock(&kept_indexes.mutex);
+    for (size_t i = 0; i < batch->count; i++) {
+        int evaluated = 0;
+        for (size_t j = 0; j < i && !evaluated; j++) {
+            evaluated = batch->queries[j].id == batch->queries[i].id;
+        }
+        if (!evaluated) {
+            evaluate_page_queries(batch, i);
+        }
+    }
+    for (size_t i = 0; i < batch->count; i++) {
+        const PointQuery *query = &batch->queries[i];
+        if (!query->ys) {
+            printf("rejected %ld %s\n", query->line, ERROR_QUERY_TEXT);
+            continue;
+        }
+        // The line is printed in parts, which the lines of finished jobs must not split
+        flockfile(stdout);
+        printf("point %ld %.17g", query->id, query->x);
+        const size_t result_count = kept_indexes.indexes[(size_t) query->id % KEPT_INDEX_COUNT].result_count;
+        for (size_t r = 0; r < result_count; r++) {
+            if (isnan(query->ys[r])) {
+                printf(" -");
+            } else {
+                printf(" %.17g", query->ys[r]);
+            }
+        }
+        printf("\n");
+        funlockfile(stdout);
+    }
+    pthread_mutex_unlock(&kept_indexes.mutex);
+    fflush(stdout);
+    reset_arena(&batch->scratch);
+
+    batch->query_count += batch->count;
+    batch->count = 0;
+    batch->allocations += heap_allocations() - allocations;
+}
+
+/**
+ * @brief Adds a point query to the batch, opening a window if it is the first one.
+ *
+ * @param request The request.
+ * @param line    The number of the request, for rejecting it.
+ * @param fields  The arena the fields of the request are copied to.
+ * @param batch   The batch, evaluated right away when it is full or the window is 0.
+ * @return 1 if the request is not a point query, 0 if it was taken or rejected.
+ */
+static int collect_point_query(const char *request, const long line, Arena *fields, PointBatch *batch) {
+    const char *cursor = request;
+    const char *kind = next_field(&cursor, fields);
+    const int point_query = kind && strcmp(kind, POINT_QUERY) == 0;
+    if (!point_query) {
+        return 1;
+    }
+
+    long id;
+    double x;
+    if (next_id(&cursor, fields, &id) != 0 || next_number(&cursor, fields, &x) != 0 || *cursor != '\0') {
+        printf("rejected %ld %s\n", line, ERROR_QUERY_TEXT);
+        fflush(stdout);
+        return 0;
+    }
+
+    if (!batch->count) {
+        batch->deadline = monotonic_seconds() + batch->window;
+    }
+    batch->queries[batch->count++] = (PointQuery) {id, x, line, NULL};
+    if (batch->count == POINT_BATCH_CAPACITY || batch->window <= 0.0) {
+        flush_point_batch(batch);
+    }
+    return 0;
+}
+
+/**
+ * @brief Waits until reading the input would not block, answering the pending point queries when their window
+ * closes first.
+ *
+ * @param fd    The descriptor of the input.
+ * @param batch The pending point queries.
+ */
+static void await_input(const int fd, PointBatch *batch) {
+    while (batch->count) {
+        const double remaining = batch->deadline - monotonic_seconds();
+        if (remaining > 0.0 && wait_input(fd, remaining)) {
+            return;
+        }
+        flush_point_batch(batch);
+    }
+}
+
+/**
+ * @brief Submits every complete request in the buffer of the reader, answering malformed ones.
+ *
+ * @param reader    The reader.
+ * @param scheduler The scheduler running the jobs, or assigning their ids if they are dispatched to workers.
+ * @param pool      The workers the jobs are dispatched to, NULL to run them in the calling thread.
+ * @param settings  The settings of the server.
+ * @param batch     The batch collecting the point queries.
+ */
+static void submit_requests(RequestReader *reader, Scheduler *scheduler, WorkerPool *pool,
+                            const ServeSettings *settings, PointBatch *batch) {
+    const char *request;
+    while ((request = next_request(reader))) {
+        if (answer_query(request, reader->line, &reader->fields) == 0 ||
+            collect_point_query(request, reader->line, &reader->fields, batch) == 0) {
+            continue;
+        }
+        JobClass job_class;
+        const size_t allocations = heap_allocations();
+        RenderJob *job = request[0] != '\0' ? parse_render_request(request, settings, &job_class, &reader->fields)
+                                             : NULL;
+        if (job) {
+            job->allocations = heap_allocations() - allocations;
+            initialize_job(&job->job, scheduler->next_id++, job_class, job);
+        }
+        if (job && pool) {
+            dispatch_job(pool, &job->job);
+        } else if (job) {
+            enqueue_job(scheduler, &job->job);
+        } else if (request[0] != '\0') {
+            printf("rejected %ld %s\n", reader->line, ERROR_REQUEST_TEXT);
+            fflush(stdout);
+        }
+    }
+}
+
+/**
+ * @brief Adds the heap allocations made for an answered render request to the statistics of the thread.
+ */
+static void count_request_allocations(const size_t allocations) {
+    run_stats.requests++;
+    run_stats.request_allocations += allocations;
+    if (allocations > run_stats.max_request_allocations) {
+        run_stats.max_request_allocations = allocations;
+    }
+    if (!allocations) {
+        run_stats.allocation_free_requests++;
+    }
+}
+
+/**
+ * @brief Answers a finished render job on the standard output and releases it.
+ *
+ * @param job The finished job, embedded in its render job.
+ */
+static void answer_job(Job *job) {
+    RenderJob *render = job->data;
+    const size_t before = heap_allocations();
+    if (render->failed) {
+        printf("failed %ld %s\n", job->id, ERROR_FILE_TEXT);
+    } else {
+        keep_index(job->id, render); // Before the answer, so the page can be queried as soon as it is announced
+        printf("done %ld %s %s %.3f\n", job->id, job_class_name(job->job_class), render->output_file_name,
+               1e3 * job->latency);
+    }
+    fflush(stdout);
+    const size_t allocations = render->allocations;
+    release_render_job(render); // The job may be taken for the next request from here on
+    count_request_allocations(allocations + heap_allocations() - before);
+}
+
+void serve(const char *input_name, const ServeSettings *settings, const int report) {
+    RequestReader reader = {0, malloc(REQUEST_BUFFER_CAPACITY), 0, REQUEST_BUFFER_CAPACITY, 0, 0, NULL, 0};
+    Scheduler scheduler;
+    PointBatch *batch = calloc(1, sizeof(PointBatch));
+    batch->window = settings->batch_window;
+    initialize_arena(&reader.fields, 0);
+    initialize_arena(&batch->scratch, 0);
+
+    if (strcmp(input_name, STANDARD_INPUT_NAME) != 0) {
+        reader.fd = open(input_name, O_RDONLY);
+        if (reader.fd < 0) {
+            free(reader.buffer);
+            error_exit(ERROR_FILE_TEXT, ERROR_FILE);
+        }
+    }
+    initialize_scheduler(&scheduler, step_render_job, settings->limits);
+
+    if (settings->workers) {
+        // The workers schedule their own jobs, this thread only reads and dispatches the requests
+        Topology topology;
+        WorkerPool pool;
+        detect_topology(&topology);
+        print_topology(&topology, stderr);
+        start_workers(&pool, settings->workers, &topology, step_render_job, settings->limits, answer_job, stderr);
+        while (!reader.eof) {
+            await_input(reader.fd, batch);
+            read_input(&reader);
+            submit_requests(&reader, &scheduler, &pool, settings, batch);
+        }
+        flush_point_batch(batch);
+        stop_workers(&pool, &scheduler);
+        free_topology(&topology);
+    } else {
+        for (;;) {
+            // Pick up what arrived since the last slice, wait for requests only when there is nothing to do
+            while (!reader.eof && (scheduler_idle(&scheduler) || input_ready(reader.fd))) {
+                if (scheduler_idle(&scheduler)) {
+                    await_input(reader.fd, batch);
+                }
+                read_input(&reader);
+                submit_requests(&reader, &scheduler, NULL, settings, batch);
+            }
+            if (scheduler_idle(&scheduler)) {
+                flush_point_batch(batch);
+                break; // The input ended and every job is done
+            }
+
+            Job *job = run_slice(&scheduler);
+            if (job) {
+                answer_job(job);
+            }
+            if (batch->count && monotonic_seconds() >= batch->deadline) {
+                flush_point_batch(batch);
+            }
+        }
+    }
+
+    if (report) {
+        print_scheduler_stats(&scheduler, stderr);
+        fprintf(stderr, "point queries %zu in %zu batches\n", batch->query_count, batch->batch_count);
+        if (heap_allocations_counted()) {
+            fprintf(stderr, "heap allocations per request: mean %.2f, max %llu, none for %llu of %llu requests, "
+                            "%zu for point queries\n",
+                    run_stats.requests ? (double) run_stats.request_allocations / (double) run_stats.requests : 0.0,
+                    run_stats.max_request_allocations, run_stats.allocation_free_requests, run_stats.requests,
+                    batch->allocations);
+        } else {
+            fprintf(stderr, "heap allocations are only counted by the instrumented build, see PC_COUNT_ALLOCATIONS\n");
+        }
+    }
+    free_arena(&batch->scratch);
+    free(batch);
+    free_scheduler(&scheduler);
+    free_kept_indexes();
+    free_idle_jobs();
+    free_scratch_pools();
+    free_arena(&reader.fields);
+    free(reader.request);
+    free(reader.buffer);
+    if (reader.fd != 0) {
+        close(reader.fd);
+    }
+}
@@ -0,0 +1,236 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include "scheduler.h"
+#include "workers.h"
+#include "compiler.h"
+#include "limits.h"
+#include "draw_utils.h"
+#include "sampler.h"
+#include "curve_index.h"
+
+/**
+ * @brief Separator of the fields of a request.
+ */
+#define REQUEST_SEPARATOR ' '
+
+/**
+ * @brief Field of a request that stands for the default limits.
+ */
+#define DEFAULT_LIMITS_FIELD "-"
+
+/**
+ * @brief First field of a query for the values of the curves at a page x coordinate.
+ */
+#define VALUE_QUERY "value"
+
+/**
+ * @brief First field of a query for the drawn sample nearest to a point of the page.
+ */
+#define NEAREST_QUERY "nearest"
+
+/**
+ * @brief First field of a query for the exact values of the curves at an x value.
+ */
+#define POINT_QUERY "point"
+
+/**
+ * @brief Default time in microseconds that point queries are collected before they are evaluated together.
+ */
+#define DEFAULT_BATCH_WINDOW 50
+
+/**
+ * @brief Maximum number of point queries evaluated together, a full batch is evaluated before its window ends.
+ */
+#define POINT_BATCH_CAPACITY 1024
+
+/**
+ * @brief Number of finished pages whose curve index is kept for queries.
+ *
+ * Page n is kept in slot n modulo KEPT_INDEX_COUNT, so a page is dropped when a page KEPT_INDEX_COUNT ids later
+ * finishes.
+ */
+#define KEPT_INDEX_COUNT 256
+
+/**
+ * @brief Input name that stands for the standard input.
+ */
+#define STANDARD_INPUT_NAME "-"
+
+/**
+ * @brief Settings applied to the program of every render job.
+ *
+ * @struct ServeSettings
+ * @member limits Per class: the maximum number of active jobs.
+ * @member recurrences 1 to evaluate sin, cos and exp of affine arguments by recurrence, see `enable_recurrences()`.
+ * @member narrow_kernels 1 to switch sin and cos to the narrow kernels, see `specialise_ranges()`.
+ * @member binary_paths 1 if the path data is written as binary tokens, so the pages are opened in binary mode.
+ * @member workers The number of worker threads, 0 to run the jobs in the thread reading the requests.
+ * @member batch_window The time in seconds that point queries are collected, 0 to evaluate every one on its own.
+ * @member output_buffer The size of the buffer of the pages in bytes, 0 for the default of stdio.
+ */
+typedef struct ServeSettings {
+    size_t limits[JOB_CLASS_COUNT];
+    int recurrences;
+    int narrow_kernels;
+    int binary_paths;
+    size_t workers;
+    double batch_window;
+    size_t output_buffer;
+} ServeSettings;
+
+/**
+ * @brief Number of idle render jobs kept for the next requests, further finished jobs are freed.
+ */
+#define IDLE_JOB_LIMIT 64
+
+/**
+ * @brief Number of programs every thread keeps for expressions that are requested again.
+ */
+#define PROGRAM_CACHE_SIZE 16
+
+struct RenderBuffers;
+
+/**
+ * @brief A render requested in the long-running mode, performed one block of samples per slice.
+ *
+ * The program is compiled in the first slice, so pending jobs only hold their request. The following slices
+ * evaluate one block of SAMPLE_BLOCK_SIZE samples each, then write the background of the page, then the curves
+ * one block each, and the last slice finishes the page.
+ *
+ * Nothing of a job is allocated per request once the server runs steadily: finished jobs are kept for the next
+ * requests with their strings, and the thread running a job takes its program and its buffers from a pool of
+ * its own, see `release_render_job()`.
+ *
+ * @struct RenderJob
+ * @member settings The settings of the server.
+ * @member output_file_name The file the page is written to.
+ * @member name_capacity The allocated size of `output_file_name`.
+ * @member expressions The expressions separated by ';'.
+ * @member expressions_capacity The allocated size of `expressions`.
+ * @member limits The limits of the graph.
+ * @member scale_x The scaling factor for the x-axis.
+ * @member scale_y The scaling factor for the y-axis.
+ * @member program The compiled program, NULL before the first slice.
+ * @member buffers The samples, registers and curve index, taken from the pool of the thread in the first slice.
+ * @member count The number of samples of the grid.
+ * @member offset The number of samples evaluated so far.
+ * @member cursor The next x value of the grid.
+ * @member file The page being written, NULL before the evaluation is complete.
+ * @member series The result whose curve is being written.
+ * @member emitted The number of samples of the current curve written so far.
+ * @member path The path state of the current curve.
+ * @member failed 1 if the page could not be written.
+ * @member allocations The heap allocations made for the job so far, see `heap_allocations()`.
+ * @member job The job submitted to the scheduler, whose data is this render job.
+ * @member next The next idle job.
+ */
+typedef struct RenderJob {
+    const ServeSettings *settings;
+    char *output_file_name;
+    size_t name_capacity;
+    char *expressions;
+    size_t expressions_capacity;
+    Limits limits;
+    double scale_x;
+    double scale_y;
+    Program *program;
+    struct RenderBuffers *buffers;
+    size_t count;
+    size_t offset;
+    double cursor;
+    FILE *file;
+    size_t series;
+    size_t emitted;
+    PathState path;
+    int failed;
+    size_t allocations;
+    Job job;
+    struct RenderJob *next;
+} RenderJob;
+
+/**
+ * @brief Parses a request of the format "<class> <out-file> <limits> <expression>".
+ *
+ * The class is "interactive" or "batch", the limits are "x_min:x_max:y_min:y_max" or "-" for the default ones,
+ * and the expression takes the rest of the line, so it may contain spaces and ';'. The expression is parsed right
+ * away, so that a malformed one is rejected with the request instead of failing the job.
+ *
+ * @param line      The request without the line break. It is not modified.
+ * @param settings  The settings of the server, referenced by the job.
+ * @param job_class Set to the class of the request.
+ * @param fields    The arena the fields of the request are copied to.
+ * @return The pending render job, an idle one if there is one, or NULL if the request is malformed.
+ */
+RenderJob *parse_render_request(const char *line, const ServeSettings *settings, JobClass *job_class, Arena *fields);
+
+/**
+ * @brief Performs the next slice of a render job, used as the step function of the scheduler.
+ *
+ * @param data The RenderJob.
+ * @return 1 if the page is written or could not be opened, 0 otherwise.
+ */
+int step_render_job(void *data);
+
+/**
+ * @brief Gives a finished render job back for the next requests.
+ *
+ * The program and the buffers go back to the pool of the calling thread, which must be the thread that ran the
+ * job, and the job to the idle jobs, unless IDLE_JOB_LIMIT of them are idle already.
+ *
+ * @param job The job.
+ */
+void release_render_job(RenderJob *job);
+
+/**
+ * @brief Frees a render job that holds no program and no buffers, together with its strings.
+ *
+ * @param job The job.
+ */
+void free_render_job(RenderJob *job);
+
+/**
+ * @brief Runs the long-running mode: renders the requests read from the input until it ends.
+ *
+ * Requests are read one per line and submitted to a priority scheduler. New requests are picked up between
+ * the slices of the running jobs, so an interactive request preempts a batch render at its next block boundary.
+ * With workers, the topology and the placement of the workers are printed on the standard error output, every
+ * request goes to the least loaded worker and every worker schedules its jobs by priority on its own.
+ * Every finished job is answered on the standard output with "done <id> <class> <out-file> <latency in ms>"
+ * or "failed <id> <reason>", every malformed request, also one with a malformed expression, with
+ * "rejected <line> <reason>".
+ *
+ * The curve index of the last KEPT_INDEX_COUNT written pages is kept, and queries against them are answered
+ * right away in the reading thread, without evaluating anything:
+ * - "value <id> <page-x>" answers "value <id> <y>..." with the value of every curve at the page x coordinate,
+ *   "-" where a curve is not drawn.
+ * - "nearest <id> <page-x> <page-y>" answers "nearest <id> <curve> <x> <y> <distance>" with the drawn sample
+ *   nearest to the point, or "nearest <id> -" if no curve is drawn.
+ * - "point <id> <x>" answers "point <id> <x> <y>..." with the exact value of every curve at x, "-" where it is NaN.
+ * Page coordinates are the coordinates of the PostScript page with its origin in the lower left corner. A query
+ * for a page that is not written yet is rejected.
+ *
+ * Point queries are coalesced: the first one opens a window of `settings->batch_window`, the reading thread
+ * keeps taking requests until it closes, and then the queries of every page are evaluated together in blocks of
+ * SAMPLE_BLOCK_SIZE through the compiled program of the page. The answers are written in the order of the
+ * queries, after the answers to the requests that arrived within the window.
+ *
+ * Every thread keeps a pool of scratch memory: an arena for parsing, the programs of its last PROGRAM_CACHE_SIZE
+ * expressions and the buffers of its finished jobs. Expressions that the thread rendered before are only parsed
+ * to check the request, not compiled again, and once the pools have grown to the largest requests, answering a
+ * request makes no heap allocation.
+ *
+ * @param input_name The file the requests are read from, "-" for the standard input.
+ * @param settings   The settings of the server.
+ * @param report     1 to print the latencies per class, the batches of point queries and the heap allocations
+ *                   per request, counted by the build with PC_COUNT_ALLOCATIONS, on the standard error output at
+ *                   the end.
+ *
+ * @note Without workers on Windows the input is only read when no job is in progress.
+ * @note On Windows the window of point queries closes as soon as no further request is buffered.
+ * @note Except on Windows, the stream of a written page is kept for the next page, so the file stays open, with
+ *       its content written, until the next page of the same buffers replaces it.
+ */
+void serve(const char *input_name, const ServeSettings *settings, int report);
+
+#endif //SERVE_H
@@ -0,0 +1,124 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#define open _open
+#define read _read
+#define close _close
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "source.h"
+
+/**
+ * @brief Reads everything from a descriptor into a growable buffer.
+ *
+ * @return 0 on success, 1 on a read error.
+ */
+static int read_all(const int fd, ExpressionSource *source) {
+    size_t capacity = SOURCE_BUFFER_CAPACITY;
+    source->text = malloc(capacity);
+    source->length = 0;
+    source->mapped_length = 0;
+
+    for (;;) {
+        if (capacity - source->length < 2) {
+            capacity *= 2;
+            source->text = realloc(source->text, capacity);
+        }
+        const long bytes = (long) read(fd, source->text + source->length,
+                                       (unsigned) (capacity - source->length - 1));
+        if (bytes < 0) {
+            free(source->text);
+            source->text = NULL;
+            return 1;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        source->length += (size_t) bytes;
+    }
+    source->text[source->length] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Maps a file privately into memory, followed by a 0 byte.
+ *
+ * @return 0 on success, 1 if the file can not be mapped.
+ */
+static int map_file(const int fd, ExpressionSource *source) {
+#ifdef _WIN32
+    (void) fd;
+    (void) source;
+    return 1;
+#else
+    struct stat status;
+    if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size == 0) {
+        return 1;
+    }
+
+    // The anonymous mapping provides the terminating 0 behind the file, even if the file ends on a page boundary
+    const size_t length = (size_t) status.st_size;
+    char *text = mmap(NULL, length + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (text == MAP_FAILED) {
+        return 1;
+    }
+    if (mmap(text, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(text, length + 1);
+        return 1;
+    }
+    source->text = text;
+    source->length = length;
+    source->mapped_length = length + 1;
+    return 0;
+#endif
+}
+
+int open_expression_source(const char *argument, ExpressionSource *source) {
+    if (argument[0] == SOURCE_FILE_PREFIX) {
+        const int fd = open(argument + 1, O_RDONLY);
+        if (fd < 0) {
+            return 1;
+        }
+        // Files that can not be mapped, like pipes or empty files, are read instead
+        const int failed = map_file(fd, source) != 0 && read_all(fd, source) != 0;
+        close(fd);
+        if (failed) {
+            return 1;
+        }
+    } else if (strcmp(argument, SOURCE_STANDARD_INPUT) == 0) {
+        if (read_all(0, source) != 0) {
+            return 1;
+        }
+    } else {
+        source->length = strlen(argument);
+        source->text = malloc(source->length + 1);
+        source->mapped_length = 0;
+        memcpy(source->text, argument, source->length + 1);
+    }
+
+    while (source->length && isspace((unsigned char) source->text[source->length - 1])) {
+        source->text[--source->length] = '\0';
+    }
+    return 0;
+}
+
+void close_expression_source(ExpressionSource *source) {
+#ifndef _WIN32
+    if (source->mapped_length) {
+        munmap(source->text, source->mapped_length);
+    }
+#endif
+    if (!source->mapped_length) {
+        free(source->text);
+    }
+    source->text = NULL;
+    source->length = 0;
+    source->mapped_length = 0;
+}
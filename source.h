@@ -0,0 +1,61 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+
+/**
+ * @brief Prefix of the expression argument that names a file holding the expressions.
+ */
+#define SOURCE_FILE_PREFIX '@'
+
+/**
+ * @brief Expression argument that stands for the standard input.
+ */
+#define SOURCE_STANDARD_INPUT "-"
+
+/**
+ * @brief Initial capacity of the buffer the standard input is read into, doubled whenever it is full.
+ */
+#define SOURCE_BUFFER_CAPACITY 65536
+
+/**
+ * @brief The text of the expressions, taken from the argument itself, a file or the standard input.
+ *
+ * A file is mapped into memory privately and writable, so the expressions can be split and lexed in place: only
+ * the pages that are written to are copied. The mapping is one byte longer than the file and the byte after
+ * the file is 0, so the text is terminated like a string without reading the file. The standard input is read
+ * into a growable buffer. Trailing whitespace such as the final line break of a file is cut off.
+ *
+ * The command line limits a single argument to 128 KiB on Linux, so large generated expressions can only be
+ * passed as a file or through the standard input.
+ *
+ * @struct ExpressionSource
+ * @member text The text, terminated by '\0' and writable.
+ * @member length The length of the text.
+ * @member mapped_length The length of the mapping, 0 if the text is allocated.
+ */
+typedef struct ExpressionSource {
+    char *text;
+    size_t length;
+    size_t mapped_length;
+} ExpressionSource;
+
+/**
+ * @brief Loads the expressions named by the expression argument.
+ *
+ * "@<path>" reads the file at path, "-" the standard input, everything else is the text itself.
+ *
+ * @param argument The expression argument.
+ * @param source   Set to the text, to be released with `close_expression_source()`.
+ * @return 0 on success, 1 if the file or the standard input can not be read.
+ */
+int open_expression_source(const char *argument, ExpressionSource *source);
+
+/**
+ * @brief Releases the text of the expressions.
+ *
+ * @param source The source, empty afterwards.
+ */
+void close_expression_source(ExpressionSource *source);
+
+#endif //SOURCE_H
@@ -0,0 +1,186 @@
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "stats.h"
+#include "timer.h"
+#include "trace.h"
+#include "err.h"
+
+THREAD_LOCAL RunStats run_stats;
+
+/**
+ * @brief Hardware counters read at the stage boundaries, valid once `enable_perf_counters()` was called.
+ */
+static PerfCounters stage_counters;
+
+/**
+ * @brief 1 in the thread that opened the hardware counters, they count only that thread.
+ */
+static THREAD_LOCAL int stage_counters_enabled;
+
+/**
+ * @brief Clock and counter readings taken at the beginning of every stage by the calling thread.
+ */
+static THREAD_LOCAL double stage_start_wall[STAGE_COUNT];
+static THREAD_LOCAL double stage_start_cpu[STAGE_COUNT];
+static THREAD_LOCAL long long stage_start_counters[STAGE_COUNT][PERF_EVENT_COUNT];
+
+const char *stage_name(const Stage stage) {
+    switch (stage) {
+        case STAGE_LEX: return "lex";
+        case STAGE_PARSE: return "parse";
+        case STAGE_COMPILE: return "compile";
+        case STAGE_EVALUATE: return "evaluate";
+        case STAGE_EMIT: return "emit";
+        case STAGE_FLUSH: return "flush";
+        default: return "unknown";
+    }
+}
+
+void stage_begin(const Stage stage) {
+    TRACE_BEGIN_PHASE(stage_name(stage));
+    if (stage_counters_enabled) {
+        read_perf_counters(&stage_counters, stage_start_counters[stage]);
+    }
+    stage_start_cpu[stage] = thread_cpu_seconds();
+    stage_start_wall[stage] = monotonic_seconds();
+}
+
+void stage_end(const Stage stage) {
+    run_stats.wall_seconds[stage] += monotonic_seconds() - stage_start_wall[stage];
+    run_stats.cpu_seconds[stage] += thread_cpu_seconds() - stage_start_cpu[stage];
+    TRACE_END_PHASE(stage_name(stage));
+    if (!stage_counters_enabled) return;
+
+    long long now[PERF_EVENT_COUNT];
+    read_perf_counters(&stage_counters, now);
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (now[i] == PERF_UNAVAILABLE || stage_start_counters[stage][i] == PERF_UNAVAILABLE) {
+            run_stats.counters[stage][i] = PERF_UNAVAILABLE;
+        } else if (run_stats.counters[stage][i] != PERF_UNAVAILABLE) {
+            run_stats.counters[stage][i] += now[i] - stage_start_counters[stage][i];
+        }
+    }
+}
+
+void merge_run_stats(RunStats *total, const RunStats *part) {
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        total->wall_seconds[s] += part->wall_seconds[s];
+        total->cpu_seconds[s] += part->cpu_seconds[s];
+    }
+    total->samples += part->samples;
+    total->nan_samples += part->nan_samples;
+    total->out_of_range_samples += part->out_of_range_samples;
+    total->segments += part->segments;
+    total->path_operators += part->path_operators;
+    total->bytes_written += part->bytes_written;
+    total->ast_nodes += part->ast_nodes;
+    total->instructions += part->instructions;
+    total->requests += part->requests;
+    total->request_allocations += part->request_allocations;
+    if (part->max_request_allocations > total->max_request_allocations) {
+        total->max_request_allocations = part->max_request_allocations;
+    }
+    total->allocation_free_requests += part->allocation_free_requests;
+}
+
+int enable_perf_counters(void) {
+    if (!stage_counters_enabled) {
+        if (open_perf_counters(&stage_counters) == 0) {
+            print_warning(WARNING_PERF_COUNTERS_TEXT);
+            return 0;
+        }
+        stage_counters_enabled = 1;
+    }
+    return stage_counters.available;
+}
+
+unsigned long long peak_rss_bytes(void) {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (unsigned long long) usage.ru_maxrss; // bytes on macOS
+#else
+    return (unsigned long long) usage.ru_maxrss * 1024; // kilobytes on Linux
+#endif
+#endif
+}
+
+void print_stats(FILE *file) {
+    double total_wall = 0.0;
+    double total_cpu = 0.0;
+
+    fprintf(file, "%-10s %12s %12s\n", "stage", "wall [ms]", "cpu [ms]");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        fprintf(file, "%-10s %12.3f %12.3f\n", stage_name(s), run_stats.wall_seconds[s] * 1e3,
+                run_stats.cpu_seconds[s] * 1e3);
+        total_wall += run_stats.wall_seconds[s];
+        total_cpu += run_stats.cpu_seconds[s];
+    }
+    fprintf(file, "%-10s %12.3f %12.3f\n", "total", total_wall * 1e3, total_cpu * 1e3);
+
+    fprintf(file, "samples %llu, nan %llu, out of range %llu, segments %llu, path operators %llu\n",
+            run_stats.samples, run_stats.nan_samples, run_stats.out_of_range_samples, run_stats.segments,
+            run_stats.path_operators);
+    fprintf(file, "bytes written %llu, ast nodes %llu, instructions %llu, peak rss %llu KiB\n",
+            run_stats.bytes_written, run_stats.ast_nodes, run_stats.instructions, peak_rss_bytes() / 1024);
+    print_perf_report(file);
+}
+
+void write_stats_json(FILE *file) {
+    fprintf(file, "{\n  \"stages\": {");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        fprintf(file, "%s\n    \"%s\": {\"wall_ns\": %.0f, \"cpu_ns\": %.0f", s ? "," : "", stage_name(s),
+                run_stats.wall_seconds[s] * 1e9, run_stats.cpu_seconds[s] * 1e9);
+        if (stage_counters_enabled) {
+            for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+                if (stage_counters.fds[i] == -1 || run_stats.counters[s][i] == PERF_UNAVAILABLE) {
+                    fprintf(file, ", \"%s\": null", perf_event_name(i));
+                } else {
+                    fprintf(file, ", \"%s\": %lld", perf_event_name(i), run_stats.counters[s][i]);
+                }
+            }
+        }
+        fprintf(file, "}");
+    }
+    fprintf(file, "\n  },\n");
+    fprintf(file, "  \"samples\": %llu,\n  \"nan_samples\": %llu,\n  \"out_of_range_samples\": %llu,\n",
+            run_stats.samples, run_stats.nan_samples, run_stats.out_of_range_samples);
+    fprintf(file, "  \"segments\": %llu,\n  \"path_operators\": %llu,\n  \"bytes_written\": %llu,\n",
+            run_stats.segments, run_stats.path_operators, run_stats.bytes_written);
+    fprintf(file, "  \"ast_nodes\": %llu,\n  \"instructions\": %llu,\n  \"peak_rss_bytes\": %llu\n}\n",
+            run_stats.ast_nodes, run_stats.instructions, peak_rss_bytes());
+}
+
+void print_perf_report(FILE *file) {
+    if (!stage_counters_enabled) return;
+
+    fprintf(file, "%-10s", "stage");
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        fprintf(file, " %16s", perf_event_name(i));
+    }
+    fprintf(file, " %8s\n", "ipc");
+
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const long long *totals = run_stats.counters[s];
+        fprintf(file, "%-10s", stage_name(s));
+        for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+            if (stage_counters.fds[i] == -1 || totals[i] == PERF_UNAVAILABLE) {
+                fprintf(file, " %16s", "n/a");
+            } else {
+                fprintf(file, " %16lld", totals[i]);
+            }
+        }
+        if (stage_counters.fds[PERF_CYCLES] != -1 && totals[PERF_CYCLES] > 0 &&
+            stage_counters.fds[PERF_INSTRUCTIONS] != -1 && totals[PERF_INSTRUCTIONS] != PERF_UNAVAILABLE) {
+            fprintf(file, " %8.2f\n", (double) totals[PERF_INSTRUCTIONS] / (double) totals[PERF_CYCLES]);
+        } else {
+            fprintf(file, " %8s\n", "n/a");
+        }
+    }
+}
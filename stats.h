@@ -0,0 +1,121 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include "perf_counters.h"
+#include "trace.h"
+
+/**
+ * @brief Stages of the pipeline that time and hardware counters are attributed to.
+ */
+typedef enum Stage {
+    STAGE_LEX, /**< Bracket check and lexer setup */
+    STAGE_PARSE, /**< Lexing and parsing into the abstract syntax tree */
+    STAGE_COMPILE, /**< Compiling the trees into a program, including constant folding and shared subexpressions */
+    STAGE_EVALUATE, /**< Evaluating the program over the sampling grid */
+    STAGE_EMIT, /**< Formatting the PostScript output */
+    STAGE_FLUSH, /**< Flushing the output to the file */
+    STAGE_COUNT
+} Stage;
+
+/**
+ * @brief Statistics of one run, collected permanently and reported with --stats.
+ *
+ * Collecting them costs two clock readings per stage and a few increments per sample, so they are always
+ * gathered. Hardware counters are only read once `enable_perf_counters()` was called, and only in the thread
+ * that called it. Every thread collects into its own copy, worker threads add theirs with `merge_run_stats()`.
+ */
+typedef struct RunStats {
+    double wall_seconds[STAGE_COUNT]; /**< Elapsed time per stage */
+    double cpu_seconds[STAGE_COUNT]; /**< Processor time of the measuring thread per stage */
+    long long counters[STAGE_COUNT][PERF_EVENT_COUNT]; /**< Hardware counters per stage */
+    unsigned long long samples; /**< Evaluated samples, counted once per curve */
+    unsigned long long nan_samples; /**< Samples where the function could not be evaluated */
+    unsigned long long out_of_range_samples; /**< Samples outside of the y limits */
+    unsigned long long segments; /**< Connected pieces of the curves */
+    unsigned long long path_operators; /**< moveto, lineto and stroke operators written for the curves */
+    unsigned long long bytes_written; /**< Size of the output file */
+    unsigned long long ast_nodes; /**< Nodes of all abstract syntax trees */
+    unsigned long long instructions; /**< Instructions of the compiled program */
+    unsigned long long requests; /**< Render requests answered by the long-running mode */
+    unsigned long long request_allocations; /**< Heap allocations made for them, see `heap_allocations()` */
+    unsigned long long max_request_allocations; /**< Most heap allocations made for one of them */
+    unsigned long long allocation_free_requests; /**< Those answered without any heap allocation */
+} RunStats;
+
+/**
+ * @brief The statistics of the current run collected by the calling thread.
+ */
+extern THREAD_LOCAL RunStats run_stats;
+
+/**
+ * @brief Adds the statistics collected by a thread to the totals, except for the hardware counters.
+ *
+ * The times per stage of several threads add up, so they are busy times rather than elapsed times.
+ * The caller serialises concurrent calls for the same totals.
+ *
+ * @param total The totals, usually the statistics of the main thread.
+ * @param part  The statistics of a finished thread.
+ */
+void merge_run_stats(RunStats *total, const RunStats *part);
+
+/**
+ * @brief Returns the name of a stage as used in reports.
+ *
+ * @param stage The stage.
+ * @return The name of the stage, e.g. "evaluate".
+ */
+const char *stage_name(Stage stage);
+
+/**
+ * @brief Marks the beginning of a stage.
+ *
+ * @param stage The stage that begins.
+ */
+void stage_begin(Stage stage);
+
+/**
+ * @brief Marks the end of a stage and adds its time and hardware counters to the totals of the stage.
+ *
+ * @param stage The stage that ends, the same as passed to the matching `stage_begin()`.
+ */
+void stage_end(Stage stage);
+
+/**
+ * @brief Opens the hardware counters read at the stage boundaries.
+ *
+ * @return The number of counters that were opened. A warning is printed if none is available.
+ */
+int enable_perf_counters(void);
+
+/**
+ * @brief Returns the peak resident set size of the process.
+ *
+ * @return The peak resident set size in bytes, 0 if it is not known on this system.
+ */
+unsigned long long peak_rss_bytes(void);
+
+/**
+ * @brief Prints the statistics of the run as a human-readable table.
+ *
+ * @param file The file the report is written to.
+ */
+void print_stats(FILE *file);
+
+/**
+ * @brief Writes the statistics of the run as a JSON object.
+ *
+ * @param file The file the report is written to.
+ */
+void write_stats_json(FILE *file);
+
+/**
+ * @brief Prints the hardware counters per stage as a table.
+ *
+ * Nothing is printed if no counter is available.
+ *
+ * @param file The file the report is written to.
+ */
+void print_perf_report(FILE *file);
+
+#endif //STATS_H
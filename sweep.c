@@ -0,0 +1,220 @@
+#include "sweep.h"
+
+void initialize_sweep(Sweep *sweep) {
+    for (int i = 0; i < PARAMETER_COUNT; i++) {
+        sweep->parameters[i] = 0.0;
+    }
+    sweep->parameter = -1;
+    sweep->from = 0.0;
+    sweep->to = 0.0;
+    sweep->frames = 1;
+}
+
+/**
+ * @brief Reads a parameter name terminated by ':' and returns its index.
+ *
+ * @param str    The string starting with the parameter name.
+ * @param endptr Set to the position of the ':' following the name.
+ * @return The index of the parameter, or -1 if the name is not a parameter or is not followed by ':'.
+ */
+static int parse_parameter_name(const char *str, const char **endptr) {
+    char name[MAX_IDENTIFIER_LENGTH];
+    size_t len = 0;
+
+    while (str[len] != ':' && str[len] != '\0') {
+        if (len + 1 >= MAX_IDENTIFIER_LENGTH) return -1;
+        name[len] = str[len];
+        len++;
+    }
+    if (str[len] != ':') return -1;
+    name[len] = '\0';
+    *endptr = str + len;
+
+    return parameter_index(name);
+}
+
+int parse_sweep(const char *sweep_str, Sweep *sweep) {
+    const char *name_end;
+    char *endptr;
+
+    const int parameter = parse_parameter_name(sweep_str, &name_end);
+    if (parameter == -1) return 1;
+
+    const double from = strtod(name_end + 1, &endptr);
+    if (*endptr != ':') return 1;
+
+    const double to = strtod(endptr + 1, &endptr);
+    if (*endptr != ':') return 1;
+
+    const long frames = strtol(endptr + 1, &endptr, 10);
+    if (*endptr != '\0' || frames < 1) return 1;
+
+    sweep->parameter = parameter;
+    sweep->from = from;
+    sweep->to = to;
+    sweep->frames = (size_t) frames;
+
+    return 0; // Success
+}
+
+int parse_parameter(const char *parameter_str, Sweep *sweep) {
+    const char *name_end;
+    char *endptr;
+
+    const int parameter = parse_parameter_name(parameter_str, &name_end);
+    if (parameter == -1) return 1;
+
+    const double value = strtod(name_end + 1, &endptr);
+    if (endptr == name_end + 1 || *endptr != '\0') return 1;
+
+    sweep->parameters[parameter] = value;
+
+    return 0; // Success
+}
+
+void sweep_frame_parameters(const Sweep *sweep, const size_t frame, double *parameters) {
+    memcpy(parameters, sweep->parameters, PARAMETER_COUNT * sizeof(double));
+    if (sweep->parameter == -1) return;
+
+    if (sweep->frames == 1) {
+        parameters[sweep->parameter] = sweep->from;
+    } else {
+        parameters[sweep->parameter] = sweep->from + (sweep->to - sweep->from) * (double) frame / (double) (sweep->frames - 1);
+    }
+}
+
+SweepCache *prepare_sweep(const Program *program, const Limits *limits) {
+    SweepCache *cache = malloc(sizeof(SweepCache));
+    cache->program = program;
+    cache->count = count_samples(limits);
+    cache->xs = malloc((cache->count ? cache->count : 1) * sizeof(double));
+    cache->columns = calloc(program->length, sizeof(double *));
+    cache->invariants = calloc(program->length, sizeof(double));
+    cache->registers = malloc(program->length * SAMPLE_BLOCK_SIZE * sizeof(double));
+
+    double cursor = limits->x_min;
+    next_sample_block(limits, &cursor, cache->xs, cache->count);
+
+    // Keep a column for every x-only value consumed by a frame-dependent instruction, and for the results
+    for (size_t i = 0; i < program->length; i++) {
+        const Instruction *instruction = &program->code[i];
+        if (!(instruction->dependency & DEPENDS_ON_PARAMETERS)) continue;
+
+        if (operand_count(instruction->code) >= 1 &&
+            program->code[instruction->left].dependency == DEPENDS_ON_X && !cache->columns[instruction->left]) {
+            cache->columns[instruction->left] = malloc((cache->count ? cache->count : 1) * sizeof(double));
+        }
+        if (operand_count(instruction->code) == 2 &&
+            program->code[instruction->right].dependency == DEPENDS_ON_X && !cache->columns[instruction->right]) {
+            cache->columns[instruction->right] = malloc((cache->count ? cache->count : 1) * sizeof(double));
+        }
+    }
+    for (size_t i = 0; i < program->result_count; i++) {
+        const size_t result = program->results[i];
+        if (program->code[result].dependency == DEPENDS_ON_X && !cache->columns[result]) {
+            cache->columns[result] = malloc((cache->count ? cache->count : 1) * sizeof(double));
+        }
+    }
+
+    // Evaluate the x-only part once for the whole grid, block by block
+    for (size_t offset = 0; offset < cache->count; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t count = cache->count - offset < SAMPLE_BLOCK_SIZE ? cache->count - offset : SAMPLE_BLOCK_SIZE;
+        double *registers = cache->registers;
+
+        for (size_t i = 0; i < program->length; i++) {
+            const Instruction *instruction = &program->code[i];
+            if (instruction->dependency & DEPENDS_ON_PARAMETERS) continue;
+
+            execute_instruction(instruction, registers + i * SAMPLE_BLOCK_SIZE,
+                                registers + instruction->left * SAMPLE_BLOCK_SIZE,
+                                registers + instruction->right * SAMPLE_BLOCK_SIZE,
+                                cache->xs + offset, NULL, count);
+            if (cache->columns[i]) {
+                memcpy(cache->columns[i] + offset, registers + i * SAMPLE_BLOCK_SIZE, count * sizeof(double));
+            }
+        }
+    }
+
+    return cache;
+}
+
+/**
+ * @brief Returns the values of an operand for the block starting at `offset`.
+ *
+ * @param cache  The sweep cache.
+ * @param slot   The slot of the operand.
+ * @param offset Index of the first sample of the block.
+ * @return Pointer to the values, either in a cached column or in the block registers.
+ */
+static const double *operand(const SweepCache *cache, const size_t slot, const size_t offset) {
+    if (cache->columns[slot]) {
+        return cache->columns[slot] + offset;
+    }
+    return cache->registers + slot * SAMPLE_BLOCK_SIZE;
+}
+
+void evaluate_sweep_frame(SweepCache *cache, const double *parameters, double *const *ys) {
+    const Program *program = cache->program;
+    int mixed = 0;
+
+    // Parameter-only and constant instructions are evaluated once per frame and broadcast into their registers
+    for (size_t i = 0; i < program->length; i++) {
+        const Instruction *instruction = &program->code[i];
+        if (instruction->dependency & DEPENDS_ON_X) continue;
+
+        const double left = cache->invariants[instruction->left];
+        const double right = cache->invariants[instruction->right];
+        execute_instruction(instruction, &cache->invariants[i], &left, &right, NULL, parameters, 1);
+        for (size_t j = 0; j < SAMPLE_BLOCK_SIZE; j++) {
+            cache->registers[i * SAMPLE_BLOCK_SIZE + j] = cache->invariants[i];
+        }
+    }
+
+    // Results that do not depend on the frame or on 'x' are copied out directly
+    for (size_t r = 0; r < program->result_count; r++) {
+        const size_t result = program->results[r];
+        if (program->code[result].dependency == DEPENDS_ON_X) {
+            memcpy(ys[r], cache->columns[result], cache->count * sizeof(double));
+        } else if (!(program->code[result].dependency & DEPENDS_ON_X)) {
+            for (size_t j = 0; j < cache->count; j++) {
+                ys[r][j] = cache->invariants[result];
+            }
+        } else {
+            mixed = 1;
+        }
+    }
+    if (!mixed) return;
+
+    // Only the mixed instructions are evaluated for every sample
+    for (size_t offset = 0; offset < cache->count; offset += SAMPLE_BLOCK_SIZE) {
+        const size_t count = cache->count - offset < SAMPLE_BLOCK_SIZE ? cache->count - offset : SAMPLE_BLOCK_SIZE;
+
+        for (size_t i = 0; i < program->length; i++) {
+            const Instruction *instruction = &program->code[i];
+            if (instruction->dependency != DEPENDS_ON_BOTH) continue;
+
+            execute_instruction(instruction, cache->registers + i * SAMPLE_BLOCK_SIZE,
+                                operand(cache, instruction->left, offset),
+                                operand(cache, instruction->right, offset),
+                                cache->xs + offset, parameters, count);
+        }
+        for (size_t r = 0; r < program->result_count; r++) {
+            const size_t result = program->results[r];
+            if (program->code[result].dependency == DEPENDS_ON_BOTH) {
+                memcpy(ys[r] + offset, cache->registers + result * SAMPLE_BLOCK_SIZE, count * sizeof(double));
+            }
+        }
+    }
+}
+
+void free_sweep_cache(SweepCache *cache) {
+    if (cache == NULL) return;
+    for (size_t i = 0; i < cache->program->length; i++) {
+        free(cache->columns[i]);
+    }
+    free(cache->columns);
+    free(cache->invariants);
+    free(cache->registers);
+    free(cache->xs);
+    free(cache);
+}
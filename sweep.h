@@ -0,0 +1,104 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "compiler.h"
+#include "sampling.h"
+
+/**
+ * @brief Describes the values of the named parameters for every frame of a render.
+ *
+ * Parameters that are not swept keep the value stored in `parameters` for every frame. If a parameter is
+ * swept, it takes `frames` evenly spaced values from `from` to `to` (both inclusive), one per frame.
+ *
+ * @struct Sweep
+ * @member parameters The fixed values of the parameters (0 unless set explicitly).
+ * @member parameter  Index of the swept parameter, or -1 if nothing is swept.
+ * @member from       The value of the swept parameter in the first frame.
+ * @member to         The value of the swept parameter in the last frame.
+ * @member frames     The number of frames, 1 if nothing is swept.
+ */
+typedef struct Sweep {
+    double parameters[PARAMETER_COUNT];
+    int parameter;
+    double from;
+    double to;
+    size_t frames;
+} Sweep;
+
+/**
+ * @brief Holds the parts of a compiled program that do not change between the frames of a sweep.
+ *
+ * The sampling grid is computed once. The x-only instructions are evaluated once over the whole grid and
+ * those needed by the rest of the program are kept as columns. Every frame then evaluates the parameter-only
+ * instructions once and only the mixed instructions for every sample.
+ */
+typedef struct SweepCache {
+    const Program *program; /**< The program being swept */
+    double *xs; /**< The x values of the sampling grid */
+    size_t count; /**< Number of samples in the grid */
+    double **columns; /**< Per instruction: its values over the whole grid if it is a cached x-only instruction, NULL otherwise */
+    double *invariants; /**< Per instruction: its value in the current frame if it does not depend on 'x' */
+    double *registers; /**< Scratch memory for one block of every instruction */
+} SweepCache;
+
+/**
+ * @brief Initializes a sweep with every parameter set to 0 and nothing swept.
+ *
+ * @param sweep A pointer to the Sweep structure to be initialized.
+ */
+void initialize_sweep(Sweep *sweep);
+
+/**
+ * @brief Parses a sweep definition in the format "name:from:to:frames", e.g. "t:0:6.28:500".
+ *
+ * @param sweep_str A string with the sweep definition.
+ * @param sweep     A pointer to the Sweep structure where the sweep will be stored.
+ * @return Returns 0 if the parsing was successful, or 1 if the format is invalid, the name is not a parameter
+ *         or the number of frames is not positive.
+ */
+int parse_sweep(const char *sweep_str, Sweep *sweep);
+
+/**
+ * @brief Parses a fixed parameter value in the format "name:value", e.g. "a:2.5".
+ *
+ * @param parameter_str A string with the parameter definition.
+ * @param sweep         A pointer to the Sweep structure where the value will be stored.
+ * @return Returns 0 if the parsing was successful, or 1 if the format is invalid or the name is not a parameter.
+ */
+int parse_parameter(const char *parameter_str, Sweep *sweep);
+
+/**
+ * @brief Computes the parameter values of one frame.
+ *
+ * @param sweep      The sweep definition.
+ * @param frame      Index of the frame, from 0 to `sweep->frames - 1`.
+ * @param parameters Output array of PARAMETER_COUNT values.
+ */
+void sweep_frame_parameters(const Sweep *sweep, size_t frame, double *parameters);
+
+/**
+ * @brief Prepares a program for being evaluated in many frames over the same sampling grid.
+ *
+ * @param program The compiled program.
+ * @param limits  The limits defining the sampling grid.
+ * @return A pointer to the newly allocated cache. The caller frees it with `free_sweep_cache()`.
+ */
+SweepCache *prepare_sweep(const Program *program, const Limits *limits);
+
+/**
+ * @brief Evaluates one frame of a sweep over the whole sampling grid.
+ *
+ * @param cache      The cache created by `prepare_sweep()`.
+ * @param parameters Array of PARAMETER_COUNT parameter values of the frame.
+ * @param ys         Per result of the program: output array for `cache->count` values.
+ */
+void evaluate_sweep_frame(SweepCache *cache, const double *parameters, double *const *ys);
+
+/**
+ * @brief Frees a cache created by `prepare_sweep()`.
+ *
+ * @param cache A pointer to the cache to be freed. NULL is ignored.
+ */
+void free_sweep_cache(SweepCache *cache);
+
+#endif //SWEEP_H
@@ -0,0 +1,38 @@
+#include "timer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+double monotonic_seconds(void) {
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double) counter.QuadPart / (double) frequency.QuadPart;
+}
+
+double thread_cpu_seconds(void) {
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    const unsigned long long kernel_time = (unsigned long long) kernel.dwHighDateTime << 32 | kernel.dwLowDateTime;
+    const unsigned long long user_time = (unsigned long long) user.dwHighDateTime << 32 | user.dwLowDateTime;
+    return (double) (kernel_time + user_time) * 1e-7; // FILETIME counts 100 ns intervals
+}
+#else
+#define _POSIX_C_SOURCE 200112L
+#include <time.h>
+
+double monotonic_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+
+double thread_cpu_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+#endif
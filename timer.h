@@ -0,0 +1,24 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+/**
+ * @brief Returns the time of a monotonic clock in seconds.
+ *
+ * The clock is not related to the wall-clock time of day and never goes backwards, so the difference of two
+ * readings is the elapsed time between them. It is used for measuring how long the stages of a render take.
+ *
+ * @return The current reading of the monotonic clock in seconds.
+ */
+double monotonic_seconds(void);
+
+/**
+ * @brief Returns the processor time consumed by the calling thread in seconds.
+ *
+ * The time includes user and system time of the thread only, so comparing it with the elapsed monotonic time
+ * shows whether a stage was computing or waiting, also while other threads compute at the same time.
+ *
+ * @return The processor time used so far by the calling thread in seconds.
+ */
+double thread_cpu_seconds(void);
+
+#endif //TIMER_H
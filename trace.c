@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include "trace.h"
+#include "timer.h"
+
+int tracing_enabled;
+
+/**
+ * @brief Monotonic time of `enable_tracing()`, the origin of all timestamps.
+ */
+static double trace_start;
+
+/**
+ * @brief The published list of the first buffer of every thread.
+ */
+static TraceBuffer *trace_threads;
+
+/**
+ * @brief The id given to the next thread that records an event.
+ */
+static int next_thread_id = 1;
+
+/**
+ * @brief The first and the current buffer of the calling thread.
+ */
+static THREAD_LOCAL TraceBuffer *thread_first_buffer;
+static THREAD_LOCAL TraceBuffer *thread_buffer;
+
+/**
+ * @brief The job of the events of the calling thread.
+ */
+static THREAD_LOCAL long thread_job;
+
+/**
+ * @brief Allocates an empty buffer.
+ *
+ * @param thread The id of the thread the buffer belongs to.
+ * @return The new buffer.
+ */
+static TraceBuffer *allocate_trace_buffer(const int thread) {
+    TraceBuffer *buffer = malloc(sizeof(TraceBuffer));
+    buffer->length = 0;
+    buffer->thread = thread;
+    buffer->next_chunk = NULL;
+    buffer->next_thread = NULL;
+    return buffer;
+}
+
+void enable_tracing(void) {
+    trace_start = monotonic_seconds();
+    tracing_enabled = 1;
+}
+
+void trace_job(const long job) {
+    thread_job = job;
+}
+
+void trace_event(const char *name, const char phase) {
+    const double now = monotonic_seconds();
+
+    if (!thread_buffer) {
+        // First event of this thread, publish its chain without taking a lock
+        thread_first_buffer = allocate_trace_buffer(__atomic_fetch_add(&next_thread_id, 1, __ATOMIC_RELAXED));
+        thread_buffer = thread_first_buffer;
+        TraceBuffer *head = __atomic_load_n(&trace_threads, __ATOMIC_RELAXED);
+        do {
+            thread_first_buffer->next_thread = head;
+        } while (!__atomic_compare_exchange_n(&trace_threads, &head, thread_first_buffer, 0, __ATOMIC_RELEASE,
+                                              __ATOMIC_RELAXED));
+    } else if (thread_buffer->length == TRACE_BUFFER_CAPACITY) {
+        thread_buffer->next_chunk = allocate_trace_buffer(thread_buffer->thread);
+        thread_buffer = thread_buffer->next_chunk;
+    }
+
+    TraceEvent *event = &thread_buffer->events[thread_buffer->length++];
+    event->name = name;
+    event->timestamp = now;
+    event->job = thread_job;
+    event->phase = phase;
+}
+
+void write_trace(FILE *file) {
+    int first = 1;
+
+    fprintf(file, "{\"traceEvents\": [");
+    for (const TraceBuffer *thread = __atomic_load_n(&trace_threads, __ATOMIC_ACQUIRE); thread;
+         thread = thread->next_thread) {
+        fprintf(file, "%s\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                "\"args\": {\"name\": \"thread %d\"}}", first ? "" : ",", thread->thread, thread->thread);
+        first = 0;
+        for (const TraceBuffer *chunk = thread; chunk; chunk = chunk->next_chunk) {
+            for (size_t i = 0; i < chunk->length; i++) {
+                const TraceEvent *event = &chunk->events[i];
+                fprintf(file, ",\n  {\"name\": \"%s\", \"cat\": \"pc\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, "
+                        "\"tid\": %d, \"args\": {\"job\": %ld}}", event->name, event->phase,
+                        (event->timestamp - trace_start) * 1e6, chunk->thread, event->job);
+            }
+        }
+    }
+    fprintf(file, "\n], \"displayTimeUnit\": \"ms\"}\n");
+}
+
+void free_trace(void) {
+    TraceBuffer *thread = trace_threads;
+    while (thread) {
+        TraceBuffer *next_thread = thread->next_thread;
+        TraceBuffer *chunk = thread;
+        while (chunk) {
+            TraceBuffer *next_chunk = chunk->next_chunk;
+            free(chunk);
+            chunk = next_chunk;
+        }
+        thread = next_thread;
+    }
+    trace_threads = NULL;
+    thread_first_buffer = NULL;
+    thread_buffer = NULL;
+}
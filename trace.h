@@ -0,0 +1,113 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+/**
+ * @brief Storage class of variables that every thread has its own copy of.
+ */
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/**
+ * @brief Number of events a trace buffer holds before the next buffer is chained to it.
+ */
+#define TRACE_BUFFER_CAPACITY 4096
+
+/**
+ * @brief Phase of a trace event, as defined by the Chrome trace-event format.
+ */
+#define TRACE_BEGIN 'B'
+#define TRACE_END 'E'
+
+/**
+ * @brief One begin or end event of the timeline.
+ *
+ * @struct TraceEvent
+ * @member name The name of the phase, a string literal that lives until the trace is written.
+ * @member timestamp The time of the event in seconds of the monotonic clock.
+ * @member job The job the event belongs to, e.g. the frame of a sweep.
+ * @member phase TRACE_BEGIN or TRACE_END.
+ */
+typedef struct TraceEvent {
+    const char *name;
+    double timestamp;
+    long job;
+    char phase;
+} TraceEvent;
+
+/**
+ * @brief Events recorded by one thread.
+ *
+ * Every thread appends only to its own buffers, so recording needs neither locks nor atomic operations.
+ * Full buffers are chained, the chain of every thread is published once in a lock-free list and merged when
+ * the trace is written.
+ *
+ * @struct TraceBuffer
+ * @member events The recorded events.
+ * @member length The number of recorded events.
+ * @member thread The id of the thread in the trace, assigned in the order the threads record their first event.
+ * @member next_chunk The next buffer of the same thread, NULL for the current one.
+ * @member next_thread The first buffer of another thread in the published list.
+ */
+typedef struct TraceBuffer {
+    TraceEvent events[TRACE_BUFFER_CAPACITY];
+    size_t length;
+    int thread;
+    struct TraceBuffer *next_chunk;
+    struct TraceBuffer *next_thread;
+} TraceBuffer;
+
+/**
+ * @brief 1 once tracing was enabled. Checked inline, so disabled tracing costs a single branch per event.
+ */
+extern int tracing_enabled;
+
+/**
+ * @brief Starts recording events. Timestamps in the trace are relative to this call.
+ */
+void enable_tracing(void);
+
+/**
+ * @brief Sets the job that the following events of the calling thread belong to.
+ *
+ * @param job The id of the job, 0 until it is set.
+ */
+void trace_job(long job);
+
+/**
+ * @brief Records an event of the calling thread.
+ *
+ * @param name The name of the phase, must be a string literal.
+ * @param phase TRACE_BEGIN or TRACE_END.
+ */
+void trace_event(const char *name, char phase);
+
+/**
+ * @brief Records the beginning of a phase if tracing is enabled.
+ */
+#define TRACE_BEGIN_PHASE(name) do { if (tracing_enabled) trace_event((name), TRACE_BEGIN); } while (0)
+
+/**
+ * @brief Records the end of a phase if tracing is enabled.
+ */
+#define TRACE_END_PHASE(name) do { if (tracing_enabled) trace_event((name), TRACE_END); } while (0)
+
+/**
+ * @brief Writes the events of all threads in the Chrome trace-event JSON format.
+ *
+ * The file can be opened in chrome://tracing or Perfetto. Must not be called while other threads still record.
+ *
+ * @param file The file the trace is written to.
+ */
+void write_trace(FILE *file);
+
+/**
+ * @brief Releases the buffers of all threads.
+ */
+void free_trace(void);
+
+#endif //TRACE_H
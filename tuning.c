@@ -0,0 +1,364 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "tuning.h"
+#include "draw_utils.h"
+#include "sampler.h"
+#include "generator.h"
+#include "workers.h"
+#include "timer.h"
+
+/**
+ * @brief Limits of the measured pages, wide enough that evaluating the samples dominates.
+ */
+#define TUNING_LIMITS "-100:100:-10:10"
+
+/**
+ * @brief Number of nodes of the generated expression of the measured corpus.
+ */
+#define TUNING_GENERATED_NODES 400
+
+/**
+ * @brief Number of measured repetitions of every candidate setting, the fastest one counts.
+ */
+#define TUNING_REPETITIONS 5
+
+/**
+ * @brief Number of pages written per CPU when measuring the workers.
+ */
+#define TUNING_PAGES_PER_CPU 2
+
+/**
+ * @brief Relative slowdown within which fewer workers are preferred over the fastest number.
+ */
+#define TUNING_WORKER_TOLERANCE 0.05
+
+/**
+ * @brief Representative expressions of the benchmark corpus, followed by a generated one.
+ */
+static const char *TUNING_CORPUS[] = {
+    "x^5-3*x^4+2*x^3-x^2+7*x-5",
+    "sin(x)*cos(2*x)+tan(x/3)-atan(x)^2",
+    "exp(-x^2/8)*sin(5*x)",
+};
+
+/**
+ * @brief Number of expressions in TUNING_CORPUS.
+ */
+#define TUNING_CORPUS_SIZE (sizeof(TUNING_CORPUS) / sizeof(TUNING_CORPUS[0]))
+
+/**
+ * @brief Number of measured programs: the corpus and the generated expression.
+ */
+#define TUNING_PROGRAM_COUNT (TUNING_CORPUS_SIZE + 1)
+
+/**
+ * @brief Candidates for the evaluation block, all multiples of RECURRENCE_RESYNC_PERIOD.
+ */
+static const size_t EVALUATION_BLOCKS[] = {32, 64, 128, 256};
+
+/**
+ * @brief Candidates for the output buffer, 0 for the default of stdio.
+ */
+static const size_t OUTPUT_BUFFERS[] = {0, 16384, 65536, 262144, 1048576};
+
+/**
+ * @brief Number of elements of a candidate array.
+ */
+#define CANDIDATE_COUNT(candidates) (sizeof(candidates) / sizeof(candidates[0]))
+
+/**
+ * @brief The programs and limits every candidate is measured with.
+ *
+ * @struct TuningCorpus
+ * @member limits The limits of the pages.
+ * @member programs The programs, specialised to the limits.
+ * @member output_buffer The output buffer of the written pages while the workers are measured.
+ */
+typedef struct TuningCorpus {
+    Limits limits;
+    Program *programs[TUNING_PROGRAM_COUNT];
+    size_t output_buffer;
+} TuningCorpus;
+
+void initialize_tuning_profile(TuningProfile *profile) {
+    profile->evaluation_block = SAMPLE_BLOCK_SIZE;
+    profile->output_buffer = 0;
+    profile->workers = 0;
+}
+
+char *tuning_profile_path(void) {
+    const char *path = getenv(TUNING_PROFILE_ENV);
+    if (path && *path) {
+        char *copy = malloc(strlen(path) + 1);
+        strcpy(copy, path);
+        return copy;
+    }
+
+#ifdef _WIN32
+    const char *home = getenv("USERPROFILE");
+#else
+    const char *home = getenv("HOME");
+#endif
+    if (!home || !*home) {
+        return NULL;
+    }
+    char *joined = malloc(strlen(home) + strlen(TUNING_PROFILE_NAME) + 2);
+    sprintf(joined, "%s/%s", home, TUNING_PROFILE_NAME);
+    return joined;
+}
+
+int load_tuning_profile(const char *path, TuningProfile *profile) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return 1;
+    }
+
+    char line[256];
+    int status = !fgets(line, sizeof(line), file) || strncmp(line, TUNING_PROFILE_HEADER,
+                                                             strlen(TUNING_PROFILE_HEADER)) != 0 ? 2 : 0;
+    while (status == 0 && fgets(line, sizeof(line), file)) {
+        char name[64];
+        unsigned long long value;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (sscanf(line, "%63s %llu", name, &value) != 2) {
+            status = 2;
+        } else if (strcmp(name, "evaluation_block") == 0) {
+            status = value == 0 || value > SAMPLE_BLOCK_SIZE ? 2 : 0;
+            profile->evaluation_block = (size_t) value;
+        } else if (strcmp(name, "output_buffer") == 0) {
+            profile->output_buffer = (size_t) value;
+        } else if (strcmp(name, "workers") == 0) {
+            profile->workers = (size_t) value;
+        }
+    }
+    fclose(file);
+    return status;
+}
+
+int write_tuning_profile(const char *path, const TuningProfile *profile) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return 1;
+    }
+    fprintf(file, "%s\n", TUNING_PROFILE_HEADER);
+    fprintf(file, "# Written by --tune, measured on this machine\n");
+    fprintf(file, "evaluation_block %zu\n", profile->evaluation_block);
+    fprintf(file, "output_buffer %zu\n", profile->output_buffer);
+    fprintf(file, "workers %zu\n", profile->workers);
+    return fclose(file) != 0;
+}
+
+/**
+ * @brief Compiles the corpus and specialises it to the limits of the measured pages.
+ */
+static void prepare_tuning_corpus(TuningCorpus *corpus) {
+    parse_limits(TUNING_LIMITS, &corpus->limits);
+    corpus->output_buffer = 0;
+    for (size_t i = 0; i < TUNING_CORPUS_SIZE; i++) {
+        corpus->programs[i] = compile_expression_text(TUNING_CORPUS[i], 0, NULL, NULL);
+    }
+
+    GeneratorOptions options;
+    Generator generator;
+    size_t nodes;
+    initialize_generator_options(&options);
+    options.nodes = TUNING_GENERATED_NODES;
+    initialize_generator(&generator, &options, 1);
+    char *generated = generate_expression(&generator, &nodes);
+    corpus->programs[TUNING_CORPUS_SIZE] = compile_expression_text(generated, 0, NULL, NULL);
+    free(generated);
+    free_generator(&generator);
+
+    for (size_t i = 0; i < TUNING_PROGRAM_COUNT; i++) {
+        specialise_ranges(corpus->programs[i], &corpus->limits, 0);
+    }
+}
+
+/**
+ * @brief Measures sampling every program of the corpus in blocks of a size.
+ *
+ * @return The fastest of TUNING_REPETITIONS runs in seconds.
+ */
+static double time_evaluation(const TuningCorpus *corpus, const size_t block) {
+    const size_t count = count_samples(&corpus->limits);
+    double *xs = malloc(count * sizeof(double));
+    double *ys = malloc(count * sizeof(double));
+    size_t length = 1;
+    for (size_t i = 0; i < TUNING_PROGRAM_COUNT; i++) {
+        length = corpus->programs[i]->length > length ? corpus->programs[i]->length : length;
+    }
+    double *registers = malloc(length * block * sizeof(double));
+    double best = -1.0;
+
+    for (int repetition = 0; repetition < TUNING_REPETITIONS; repetition++) {
+        const double start = monotonic_seconds();
+        for (size_t i = 0; i < TUNING_PROGRAM_COUNT; i++) {
+            double cursor = corpus->limits.x_min;
+            for (size_t offset = 0; offset < count; offset += block) {
+                double *block_ys = ys + offset;
+                const size_t samples = next_sample_block(&corpus->limits, &cursor, xs + offset, block);
+                execute_block(corpus->programs[i], xs + offset, samples, NULL, registers, &block_ys);
+            }
+        }
+        const double time = monotonic_seconds() - start;
+        best = best < 0.0 || time < best ? time : best;
+    }
+
+    free(registers);
+    free(ys);
+    free(xs);
+    return best;
+}
+
+/**
+ * @brief Writes the page of every program of the corpus into a temporary file.
+ *
+ * @return 0 on success, 1 if no temporary file can be created.
+ */
+static int write_corpus_pages(const TuningCorpus *corpus, const size_t first, const size_t count) {
+    for (size_t i = first; i < first + count; i++) {
+        FILE *file = tmpfile();
+        if (!file) {
+            return 1;
+        }
+        if (corpus->output_buffer) {
+            setvbuf(file, NULL, _IOFBF, corpus->output_buffer);
+        }
+        draw_graph(&corpus->limits, file, corpus->programs[i % TUNING_PROGRAM_COUNT]);
+        fclose(file);
+    }
+    return 0;
+}
+
+/**
+ * @brief Measures writing the pages of the corpus with an output buffer of a size.
+ *
+ * @return The fastest of TUNING_REPETITIONS runs in seconds, or a negative time if no file can be written.
+ */
+static double time_output(TuningCorpus *corpus, const size_t buffer) {
+    double best = -1.0;
+    corpus->output_buffer = buffer;
+    for (int repetition = 0; repetition < TUNING_REPETITIONS; repetition++) {
+        const double start = monotonic_seconds();
+        if (write_corpus_pages(corpus, 0, TUNING_PROGRAM_COUNT)) {
+            return -1.0;
+        }
+        const double time = monotonic_seconds() - start;
+        best = best < 0.0 || time < best ? time : best;
+    }
+    return best;
+}
+
+/**
+ * @brief The share of the pages written by one thread while the workers are measured.
+ *
+ * @struct TuningThread
+ * @member corpus The corpus.
+ * @member first The first page.
+ * @member count The number of pages.
+ */
+typedef struct TuningThread {
+    const TuningCorpus *corpus;
+    size_t first;
+    size_t count;
+} TuningThread;
+
+/**
+ * @brief Writes the pages of one thread.
+ */
+static void *run_tuning_thread(void *data) {
+    const TuningThread *thread = data;
+    write_corpus_pages(thread->corpus, thread->first, thread->count);
+    return NULL;
+}
+
+/**
+ * @brief Measures writing a fixed number of pages with a number of threads at once.
+ *
+ * @return The time in seconds.
+ */
+static double time_workers(const TuningCorpus *corpus, const size_t workers, const size_t pages) {
+    pthread_t *threads = malloc(workers * sizeof(pthread_t));
+    TuningThread *shares = malloc(workers * sizeof(TuningThread));
+
+    const double start = monotonic_seconds();
+    for (size_t i = 0; i < workers; i++) {
+        shares[i] = (TuningThread) {corpus, pages * i / workers, pages * (i + 1) / workers - pages * i / workers};
+        pthread_create(&threads[i], NULL, run_tuning_thread, &shares[i]);
+    }
+    for (size_t i = 0; i < workers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    const double time = monotonic_seconds() - start;
+
+    free(shares);
+    free(threads);
+    return time;
+}
+
+void tune(TuningProfile *profile, FILE *report) {
+    TuningCorpus corpus;
+    prepare_tuning_corpus(&corpus);
+    initialize_tuning_profile(profile);
+
+    double best = -1.0;
+    for (size_t i = 0; i < CANDIDATE_COUNT(EVALUATION_BLOCKS); i++) {
+        const double time = time_evaluation(&corpus, EVALUATION_BLOCKS[i]);
+        fprintf(report, "evaluation_block %8zu %10.3f ms\n", EVALUATION_BLOCKS[i], 1e3 * time);
+        if (best < 0.0 || time < best) {
+            best = time;
+            profile->evaluation_block = EVALUATION_BLOCKS[i];
+        }
+    }
+    set_evaluation_block(profile->evaluation_block);
+
+    best = -1.0;
+    for (size_t i = 0; i < CANDIDATE_COUNT(OUTPUT_BUFFERS); i++) {
+        const double time = time_output(&corpus, OUTPUT_BUFFERS[i]);
+        if (time < 0.0) {
+            break; // No temporary files, keep the default
+        }
+        fprintf(report, "output_buffer    %8zu %10.3f ms\n", OUTPUT_BUFFERS[i], 1e3 * time);
+        if (best < 0.0 || time < best) {
+            best = time;
+            profile->output_buffer = OUTPUT_BUFFERS[i];
+        }
+    }
+    corpus.output_buffer = profile->output_buffer;
+
+    // Powers of two up to one per CPU, the fewest workers that come close to the fastest win
+    Topology topology;
+    detect_topology(&topology);
+    const size_t cpu_count = topology.cpu_count ? topology.cpu_count : 1;
+    const size_t pages = TUNING_PAGES_PER_CPU * cpu_count;
+    double *times = malloc(cpu_count * sizeof(double));
+    size_t *candidates = malloc(cpu_count * sizeof(size_t));
+    size_t candidate_count = 0;
+    for (size_t workers = 1; workers < cpu_count; workers *= 2) {
+        candidates[candidate_count++] = workers;
+    }
+    candidates[candidate_count++] = cpu_count;
+
+    best = -1.0;
+    for (size_t i = 0; i < candidate_count; i++) {
+        times[i] = time_workers(&corpus, candidates[i], pages);
+        fprintf(report, "workers          %8zu %10.3f ms\n", candidates[i], 1e3 * times[i]);
+        best = best < 0.0 || times[i] < best ? times[i] : best;
+    }
+    for (size_t i = 0; i < candidate_count; i++) {
+        if (times[i] <= best * (1.0 + TUNING_WORKER_TOLERANCE)) {
+            profile->workers = candidates[i];
+            break;
+        }
+    }
+
+    free(candidates);
+    free(times);
+    free_topology(&topology);
+    for (size_t i = 0; i < TUNING_PROGRAM_COUNT; i++) {
+        free_program(corpus.programs[i]);
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+ * @brief Environment variable naming the tuning profile, overriding TUNING_PROFILE_NAME in the home directory.
+ */
+#define TUNING_PROFILE_ENV "PC_TUNING_PROFILE"
+
+/**
+ * @brief Name of the tuning profile in the home directory of the user.
+ */
+#define TUNING_PROFILE_NAME ".pc_tuning"
+
+/**
+ * @brief First line of a tuning profile, identifying its format.
+ */
+#define TUNING_PROFILE_HEADER "pc-tuning 1"
+
+/**
+ * @brief Settings measured to be the fastest on this machine.
+ *
+ * A profile only changes how fast a page is written, never its content.
+ *
+ * @struct TuningProfile
+ * @member evaluation_block The number of samples evaluated at once, see `set_evaluation_block()`.
+ * @member output_buffer The size of the buffer of the written files in bytes, 0 for the default of stdio.
+ * @member workers The number of workers of the long-running mode with --workers, 0 for one per CPU.
+ */
+typedef struct TuningProfile {
+    size_t evaluation_block;
+    size_t output_buffer;
+    size_t workers;
+} TuningProfile;
+
+/**
+ * @brief Sets the settings used without a profile.
+ *
+ * @param profile The profile.
+ */
+void initialize_tuning_profile(TuningProfile *profile);
+
+/**
+ * @brief Returns the path of the tuning profile of this machine.
+ *
+ * @return The value of TUNING_PROFILE_ENV if set, TUNING_PROFILE_NAME in the home directory otherwise, to be freed
+ *         with `free()`, or NULL if there is no home directory.
+ */
+char *tuning_profile_path(void);
+
+/**
+ * @brief Reads a tuning profile written by `write_tuning_profile()`.
+ *
+ * Settings missing from the file keep their values, unknown ones are ignored.
+ *
+ * @param path    The path of the profile.
+ * @param profile The profile, updated with the settings of the file.
+ * @return 0 on success, 1 if the file can not be opened, 2 if it is not a tuning profile or a value is invalid.
+ */
+int load_tuning_profile(const char *path, TuningProfile *profile);
+
+/**
+ * @brief Writes a tuning profile, one "<name> <value>" line per setting.
+ *
+ * @param path    The path of the profile.
+ * @param profile The profile.
+ * @return 0 on success, 1 if the file can not be written.
+ */
+int write_tuning_profile(const char *path, const TuningProfile *profile);
+
+/**
+ * @brief Measures every setting on representative expressions of the benchmark corpus and picks the fastest.
+ *
+ * The evaluation block is measured by sampling the expressions, the output buffer by writing their pages into
+ * a temporary file and the workers by writing pages with an increasing number of threads at once. Every
+ * candidate is printed with its time.
+ *
+ * @param profile Set to the fastest settings.
+ * @param report  The file the measurements are printed to.
+ */
+void tune(TuningProfile *profile, FILE *report);
+
+#endif //TUNING_H
@@ -0,0 +1,323 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#include <dirent.h>
+#endif
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "workers.h"
+
+/**
+ * @brief Directory of the NUMA nodes on Linux.
+ */
+#define NODE_DIRECTORY "/sys/devices/system/node"
+
+/**
+ * @brief Largest CPU id read from the node directory.
+ */
+#define MAX_CPU_ID 4096
+
+/**
+ * @brief Counts the online CPUs when the affinity mask is not available.
+ */
+static size_t online_cpus(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? (size_t) info.dwNumberOfProcessors : 1;
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t) count : 1;
+#endif
+}
+
+#ifdef __linux__
+/**
+ * @brief Reads the CPU list of a node, e.g. "0-3,8-11", and assigns its CPUs to the node.
+ *
+ * @param node     The node.
+ * @param cpu_node Per CPU id below MAX_CPU_ID: set to `node` for the CPUs of the list.
+ */
+static void read_node_cpus(const int node, int *cpu_node) {
+    char path[64];
+    snprintf(path, sizeof(path), NODE_DIRECTORY "/node%d/cpulist", node);
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return;
+    }
+
+    int first;
+    while (fscanf(file, "%d", &first) == 1) {
+        int last = first;
+        int separator = fgetc(file);
+        if (separator == '-') {
+            if (fscanf(file, "%d", &last) != 1) break;
+            separator = fgetc(file);
+        }
+        for (int cpu = first; cpu <= last && cpu < MAX_CPU_ID; cpu++) {
+            if (cpu >= 0) {
+                cpu_node[cpu] = node;
+            }
+        }
+        if (separator != ',') break;
+    }
+    fclose(file);
+}
+#endif
+
+void detect_topology(Topology *topology) {
+    size_t count = 0;
+    int *cpus = NULL;
+    int *nodes = NULL;
+
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        int *cpu_node = malloc(MAX_CPU_ID * sizeof(int));
+        for (int cpu = 0; cpu < MAX_CPU_ID; cpu++) {
+            cpu_node[cpu] = 0;
+        }
+        DIR *directory = opendir(NODE_DIRECTORY);
+        if (directory) {
+            const struct dirent *entry;
+            while ((entry = readdir(directory))) {
+                int node;
+                char rest;
+                if (sscanf(entry->d_name, "node%d%c", &node, &rest) == 1 && node >= 0) {
+                    read_node_cpus(node, cpu_node);
+                }
+            }
+            closedir(directory);
+        }
+
+        const size_t allowed_count = (size_t) CPU_COUNT(&allowed);
+        cpus = malloc((allowed_count ? allowed_count : 1) * sizeof(int));
+        nodes = malloc((allowed_count ? allowed_count : 1) * sizeof(int));
+        for (int cpu = 0; cpu < CPU_SETSIZE && cpu < MAX_CPU_ID && count < allowed_count; cpu++) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                cpus[count] = cpu;
+                nodes[count] = cpu_node[cpu];
+                count++;
+            }
+        }
+        free(cpu_node);
+    }
+#endif
+
+    if (count == 0) {
+        // Nothing known about the placement: every CPU on one node, not pinned
+        free(cpus);
+        free(nodes);
+        count = online_cpus();
+        cpus = malloc(count * sizeof(int));
+        nodes = malloc(count * sizeof(int));
+        for (size_t i = 0; i < count; i++) {
+            cpus[i] = -1;
+            nodes[i] = 0;
+        }
+    }
+
+    // Interleave the nodes: every CPU gets its rank within its node, then the CPUs are ordered by rank and node
+    int max_node = 0;
+    for (size_t i = 0; i < count; i++) {
+        max_node = nodes[i] > max_node ? nodes[i] : max_node;
+    }
+    const size_t node_slots = (size_t) max_node + 1;
+    size_t *node_cpus = calloc(node_slots, sizeof(size_t));
+    size_t *ranks = malloc(count * sizeof(size_t));
+    size_t max_rank = 0;
+    for (size_t i = 0; i < count; i++) {
+        ranks[i] = node_cpus[nodes[i]]++;
+        max_rank = ranks[i] > max_rank ? ranks[i] : max_rank;
+    }
+    long *slots = malloc((max_rank + 1) * node_slots * sizeof(long));
+    for (size_t k = 0; k < (max_rank + 1) * node_slots; k++) {
+        slots[k] = -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        slots[ranks[i] * node_slots + (size_t) nodes[i]] = (long) i;
+    }
+
+    topology->cpu_count = count;
+    topology->cpus = malloc(count * sizeof(int));
+    topology->nodes = malloc(count * sizeof(int));
+    topology->node_count = 0;
+    for (size_t node = 0; node < node_slots; node++) {
+        topology->node_count += node_cpus[node] > 0;
+    }
+    size_t placed = 0;
+    for (size_t k = 0; k < (max_rank + 1) * node_slots; k++) {
+        if (slots[k] >= 0) {
+            topology->cpus[placed] = cpus[slots[k]];
+            topology->nodes[placed] = nodes[slots[k]];
+            placed++;
+        }
+    }
+
+    free(slots);
+    free(ranks);
+    free(node_cpus);
+    free(cpus);
+    free(nodes);
+}
+
+void print_topology(const Topology *topology, FILE *file) {
+    fprintf(file, "topology: %zu node(s), %zu cpu(s)\n", topology->node_count, topology->cpu_count);
+    int max_node = 0;
+    for (size_t i = 0; i < topology->cpu_count; i++) {
+        max_node = topology->nodes[i] > max_node ? topology->nodes[i] : max_node;
+    }
+    for (int node = 0; node <= max_node; node++) {
+        size_t listed = 0;
+        for (size_t i = 0; i < topology->cpu_count; i++) {
+            if (topology->nodes[i] != node) continue;
+            if (listed++ == 0) {
+                fprintf(file, "node %d: cpus", node);
+            }
+            if (topology->cpus[i] >= 0) {
+                fprintf(file, " %d", topology->cpus[i]);
+            } else {
+                fprintf(file, " ?");
+            }
+        }
+        if (listed) {
+            fprintf(file, "\n");
+        }
+    }
+}
+
+void free_topology(Topology *topology) {
+    free(topology->cpus);
+    free(topology->nodes);
+    topology->cpus = NULL;
+    topology->nodes = NULL;
+}
+
+/**
+ * @brief Pins the calling thread to a CPU, does nothing if the CPU is not known or pinning is not supported.
+ */
+static void pin_thread(const int cpu) {
+#ifdef __linux__
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void) cpu;
+#endif
+}
+
+/**
+ * @brief The thread of a worker: takes over dispatched jobs and runs slices until the pool closes.
+ */
+static void *run_worker(void *argument) {
+    Worker *worker = argument;
+    WorkerPool *pool = worker->pool;
+
+    pin_thread(worker->cpu);
+    for (;;) {
+        pthread_mutex_lock(&worker->mutex);
+        while (!worker->inbox.length && !worker->closing && scheduler_idle(&worker->scheduler)) {
+            pthread_cond_wait(&worker->wake, &worker->mutex);
+        }
+        while (worker->inbox.length) {
+            enqueue_job(&worker->scheduler, pop_job(&worker->inbox));
+        }
+        const int done = worker->closing && scheduler_idle(&worker->scheduler);
+        pthread_mutex_unlock(&worker->mutex);
+        if (done) {
+            break;
+        }
+
+        Job *job = run_slice(&worker->scheduler);
+        if (job) {
+            pool->finished(job);
+            pthread_mutex_lock(&worker->mutex);
+            worker->load--;
+            pthread_mutex_unlock(&worker->mutex);
+        }
+    }
+
+    pthread_mutex_lock(&pool->stats_mutex);
+    merge_run_stats(pool->stats, &run_stats);
+    pthread_mutex_unlock(&pool->stats_mutex);
+    return NULL;
+}
+
+void start_workers(WorkerPool *pool, const size_t count, const Topology *topology, const JobStep step,
+                   const size_t *limits, const JobFinished finished, FILE *report) {
+    pool->workers = calloc(count, sizeof(Worker));
+    pool->count = count;
+    pool->next = 0;
+    pool->finished = finished;
+    pool->stats = &run_stats;
+    pthread_mutex_init(&pool->stats_mutex, NULL);
+
+    for (size_t i = 0; i < count; i++) {
+        Worker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->cpu = topology->cpus[i % topology->cpu_count];
+        worker->node = topology->nodes[i % topology->cpu_count];
+        pthread_mutex_init(&worker->mutex, NULL);
+        pthread_cond_init(&worker->wake, NULL);
+        initialize_scheduler(&worker->scheduler, step, limits);
+        if (report) {
+            fprintf(report, "worker %zu: cpu %d, node %d\n", i, worker->cpu, worker->node);
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        pthread_create(&pool->workers[i].thread, NULL, run_worker, &pool->workers[i]);
+    }
+}
+
+void dispatch_job(WorkerPool *pool, Job *job) {
+    Worker *chosen = NULL;
+    size_t chosen_load = 0;
+
+    // Least loaded worker, ties go to the one after the previous choice so equal workers take turns
+    for (size_t k = 0; k < pool->count; k++) {
+        const size_t i = (pool->next + k) % pool->count;
+        Worker *worker = &pool->workers[i];
+        pthread_mutex_lock(&worker->mutex);
+        const size_t load = worker->load;
+        pthread_mutex_unlock(&worker->mutex);
+        if (!chosen || load < chosen_load) {
+            chosen = worker;
+            chosen_load = load;
+        }
+    }
+    pool->next = (size_t) (chosen - pool->workers + 1) % pool->count;
+
+    pthread_mutex_lock(&chosen->mutex);
+    push_job(&chosen->inbox, job);
+    chosen->load++;
+    pthread_cond_signal(&chosen->wake);
+    pthread_mutex_unlock(&chosen->mutex);
+}
+
+void stop_workers(WorkerPool *pool, Scheduler *latencies) {
+    for (size_t i = 0; i < pool->count; i++) {
+        Worker *worker = &pool->workers[i];
+        pthread_mutex_lock(&worker->mutex);
+        worker->closing = 1;
+        pthread_cond_signal(&worker->wake);
+        pthread_mutex_unlock(&worker->mutex);
+    }
+    for (size_t i = 0; i < pool->count; i++) {
+        Worker *worker = &pool->workers[i];
+        pthread_join(worker->thread, NULL);
+        merge_latencies(latencies, &worker->scheduler);
+        free_scheduler(&worker->scheduler);
+        pthread_cond_destroy(&worker->wake);
+        pthread_mutex_destroy(&worker->mutex);
+    }
+    pthread_mutex_destroy(&pool->stats_mutex);
+    free(pool->workers);
+    pool->workers = NULL;
+    pool->count = 0;
+}
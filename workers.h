@@ -0,0 +1,145 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <pthread.h>
+#include "scheduler.h"
+#include "stats.h"
+
+/**
+ * @brief CPUs the process may run on and the NUMA nodes they belong to.
+ *
+ * The CPUs are ordered for placing workers: the first CPU of every node, then the second CPU of every node and
+ * so on, so that consecutive workers alternate between the sockets instead of filling one socket first.
+ *
+ * @struct Topology
+ * @member cpu_count The number of usable CPUs, at least 1.
+ * @member cpus The ids of the usable CPUs in placement order, -1 if the id is not known.
+ * @member nodes The node of every CPU in `cpus`.
+ * @member node_count The number of nodes with usable CPUs, at least 1.
+ */
+typedef struct Topology {
+    size_t cpu_count;
+    int *cpus;
+    int *nodes;
+    size_t node_count;
+} Topology;
+
+/**
+ * @brief Called by a worker for every job it finished, with the job, which it owns from then on.
+ */
+typedef void (*JobFinished)(Job *job);
+
+struct WorkerPool;
+
+/**
+ * @brief A thread pinned to one CPU that runs its own scheduler.
+ *
+ * A job stays on the worker it was dispatched to. The worker compiles, samples and writes it, so every buffer
+ * of the job is allocated and first touched by a thread on the CPU's NUMA node and stays local to it.
+ *
+ * @struct Worker
+ * @member pool The pool of the worker.
+ * @member cpu The CPU the worker is pinned to, -1 if it is not pinned.
+ * @member node The NUMA node of the CPU.
+ * @member thread The thread.
+ * @member mutex Protects `inbox`, `load` and `closing`.
+ * @member wake Signalled when a job arrives or the pool closes.
+ * @member inbox The jobs dispatched to the worker and not yet taken over by its scheduler.
+ * @member load The number of dispatched jobs that are not finished.
+ * @member closing 1 once no further job will be dispatched.
+ * @member scheduler The scheduler of the jobs of the worker, only used by its thread.
+ */
+typedef struct Worker {
+    struct WorkerPool *pool;
+    int cpu;
+    int node;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    JobQueue inbox;
+    size_t load;
+    int closing;
+    Scheduler scheduler;
+} Worker;
+
+/**
+ * @brief Workers that share the jobs of the long-running mode.
+ *
+ * @struct WorkerPool
+ * @member workers The workers.
+ * @member count The number of workers.
+ * @member next The worker that is preferred for the next job when several are equally loaded.
+ * @member finished Called for every finished job.
+ * @member stats The statistics the workers add theirs to when they end.
+ * @member stats_mutex Protects `stats`.
+ */
+typedef struct WorkerPool {
+    Worker *workers;
+    size_t count;
+    size_t next;
+    JobFinished finished;
+    RunStats *stats;
+    pthread_mutex_t stats_mutex;
+} WorkerPool;
+
+/**
+ * @brief Finds the CPUs the process may run on and their NUMA nodes.
+ *
+ * On Linux the affinity mask of the process and /sys/devices/system/node are read. Elsewhere, or if the nodes
+ * are not known, every online CPU is put on node 0.
+ *
+ * @param topology The topology to fill, freed with `free_topology()`.
+ */
+void detect_topology(Topology *topology);
+
+/**
+ * @brief Prints the nodes with their CPUs.
+ *
+ * @param topology The topology.
+ * @param file     The file the report is written to.
+ */
+void print_topology(const Topology *topology, FILE *file);
+
+/**
+ * @brief Frees the arrays of a topology.
+ *
+ * @param topology The topology.
+ */
+void free_topology(Topology *topology);
+
+/**
+ * @brief Starts the workers, pinned to the CPUs of the topology in placement order.
+ *
+ * With more workers than CPUs the CPUs are used again in the same order. The placement is printed on `report`.
+ *
+ * @param pool     The pool to start.
+ * @param count    The number of workers, at least 1.
+ * @param topology The topology.
+ * @param step     The step function of all jobs.
+ * @param limits   Per class: the maximum number of active jobs of every worker.
+ * @param finished Called by the workers for every finished job.
+ * @param report   The file the placement is written to, NULL for none.
+ */
+void start_workers(WorkerPool *pool, size_t count, const Topology *topology, JobStep step, const size_t *limits,
+                   JobFinished finished, FILE *report);
+
+/**
+ * @brief Hands a job to the least loaded worker.
+ *
+ * @param pool The pool.
+ * @param job  The job, created with `create_job()` or `initialize_job()`.
+ */
+void dispatch_job(WorkerPool *pool, Job *job);
+
+/**
+ * @brief Lets the workers finish every dispatched job and ends them.
+ *
+ * The statistics of the workers are added to the statistics of the calling thread, their latencies to
+ * `latencies`.
+ *
+ * @param pool      The pool.
+ * @param latencies The scheduler receiving the latencies of all workers.
+ */
+void stop_workers(WorkerPool *pool, Scheduler *latencies);
+
+#endif //WORKERS_H